@@ -0,0 +1,289 @@
+#ifndef COVID19_COMMON_H
+#define COVID19_COMMON_H
+
+#include "Riostream.h"
+#include "TString.h"
+#include "TObjArray.h"
+#include "TAxis.h"
+#include "TH1D.h"
+#include "TMath.h"
+#include "TSystem.h"
+#include "TROOT.h"
+
+#include <vector>
+#include <functional>
+#include <complex>
+
+using namespace  std;
+
+////////////////////////////////////////////////////////////////
+/// Code shared by the daily and total analyses (libcovid19_common)
+////////////////////////////////////////////////////////////////
+
+////////////////////////////////////
+/// Global parameters definition ///
+////////////////////////////////////
+
+// Path where the files form worldometers have been downloaded
+extern TString fDataFolder;
+
+// number of average days in the sliding window
+extern Int_t fNSmoothing;
+
+// Range of dates to be read from the input files
+extern TString fReadDataFrom;
+extern TString fReadDataTo;
+
+// Range of dates for the X axis of the histogram
+extern TString fAxisRangeFrom;
+extern TString fAxisRangeTo;
+
+// Range of dates for the fit
+extern TString fFitRangeFrom;
+extern TString fFitRangeTo;
+
+// Headless mode: no prompt, no printouts and no graphics, only the fits are performed
+extern Bool_t fHeadless;
+
+// Minimal number of deaths to start to be taken into acount
+extern Int_t DeathsMin;
+
+////////////////////////////
+/// Functions definition ///
+////////////////////////////
+
+// to change the folder of the data files
+void SetDataFolder(TString Folder="./worldometers/");
+
+// to change fNSmoothing
+void SetSmoothing(Int_t Ndays=7);
+
+// to change the range of dates to be read
+void ReadDataRange(TString DateFrom="",TString DateTo="");
+
+// to change axis range
+void SetAxisRange(TString DateFrom="",TString DateTo="");
+
+// to change the fit range
+void SetFitRange(TString DateFrom="",TString DateTo="");
+
+// to activate the headless mode (no prompt, no printouts, no graphics)
+void SetHeadless(Bool_t Headless=true);
+
+// to print the smoothing and the ranges in the terminal
+void PrintRanges();
+
+// to build a histogram with one bin per day, labeled with the dates, for the years 2020 and 2021
+TH1D *BuildDateHistogram(TString Name);
+
+// to get the histogram bin of a date (bin 1 is the 1-Jan-20), -1 if out of range, the date of a bin, and the x value of a bin
+Int_t GetDateBin(TString Date);
+TString GetBinDate(Int_t Bin);
+Double_t BinToX(Int_t Bin);
+
+// structure containing an input of data read by chunks, whatever its size: plain file, gzip (.gz) or zstd (.zst)
+// compressed file, standard input ("-") or open file descriptor ("fd:N"), the last two being possibly gzip compressed
+const size_t kStreamChunk = 1<<16;
+struct DataStream {
+    TString Source;
+    int Fd = -1;
+    Bool_t OwnFd = false;
+    void *Gz = nullptr;                     // gzFile of zlib
+    void *Zstd = nullptr;                   // ZSTD_DCtx of zstd
+    vector<char> Input;                     // compressed chunk (zstd)
+    size_t InputPos = 0;
+    size_t InputSize = 0;
+    vector<char> Buffer;                    // decompressed chunk
+    size_t Pos = 0;
+    size_t Size = 0;
+    Bool_t End = false;
+    Bool_t Error = false;
+};
+
+// to open an input of data, to read its next line (returns false at the end), and to close it
+bool OpenDataStream(DataStream &stream, TString Source);
+bool ReadDataLine(DataStream &stream, string &line);
+void CloseDataStream(DataStream &stream);
+
+// to know if a data source is the standard input or a file descriptor, or a compressed file
+Bool_t IsDataStream(TString Source);
+Bool_t IsCompressed(TString Source);
+
+// to get the data source of a country: the standard input or a file descriptor as given, or the first
+// existing file of the data folder among Country.csv, Country.csv.gz and Country.csv.zst
+// (for a column of a wide file, "File:Column", the column is kept after the file name)
+TString GetDataFileName(TString Country);
+
+// structure containing a wide data file, with one column of total deaths per region (ex: the South African provinces):
+// date,YYYYMMDD,EC,FS,...,total with dd-mm-yyyy dates, stored as one array per column
+struct WideData {
+    TString FileName;
+    vector<TString> Columns;                // names of the regions
+    vector<Int_t> Bins;                     // one entry per day, without gap, from the first to the last date of the file
+    vector<TString> Dates;
+    vector<vector<Double_t>> Values;        // total deaths, Values[icolumn][iday]
+    vector<Bool_t> Filled;                  // days missing in the file, linearly interpolated between their neighbours
+};
+
+// to read a wide data file in one pass, the missing days being filled (the number of bytes read is added to BytesRead if given)
+bool ReadWideData(TString filename, WideData &data, Long64_t *BytesRead=nullptr);
+
+// to get the dates and total deaths of a column of a wide data file, returns false if the column does not exist
+bool GetWideColumn(const WideData &data, TString Column, vector<TString> &dates, vector<Double_t> &total_deaths);
+
+// to split a source "File:Column" of a column of a wide data file, returns false if the source is not a column,
+// and to get the file of any source
+Bool_t SplitWideSource(TString Source, TString &FileName, TString &Column);
+TString GetSourceFile(TString Source);
+
+// Fonction used to read the data files, or a column of a wide data file (the number of bytes read is added to BytesRead if given)
+bool ReadData(TString filename, vector<TString> &dates, vector<Double_t> &total_deaths, Long64_t *BytesRead=nullptr);
+
+// same, the range of dates being given instead of fReadDataFrom and fReadDataTo ("": no limit)
+bool ReadData(TString filename, TString DateFrom, TString DateTo, vector<TString> &dates, vector<Double_t> &total_deaths, Long64_t *BytesRead=nullptr);
+
+// same, the total cases being read in the same parse as the deaths, with their own dates (the wide files have no cases)
+bool ReadData(TString filename, TString DateFrom, TString DateTo, vector<TString> &dates, vector<Double_t> &total_deaths,
+              vector<TString> &case_dates, vector<Double_t> &total_cases, Long64_t *BytesRead=nullptr);
+
+// to parse a line of a data file: date (Year being incremented after the 31-Dec) and total deaths, returns false if the line has no data
+bool ParseDataLine(const string &line, Int_t &Year, TString &Date, Int_t &Deaths);
+
+// same, the total cases being read as well
+bool ParseDataLine(const string &line, Int_t &Year, TString &Date, Int_t &Deaths, Int_t &Cases);
+
+// structure containing a data file read incrementally: the lines appended since the previous read are the only ones parsed,
+// as long as the beginning of the file has not been modified
+const ULong64_t kChecksumInit = 14695981039346656037ULL;
+struct DataFile {
+    TString FileName;
+    Long64_t Offset = 0;                    // number of bytes parsed, up to the end of the last complete line
+    ULong64_t Checksum = kChecksumInit;     // checksum of these bytes
+    Int_t Year = 20;                        // year of the next line
+    vector<TString> Dates;                  // all the dates of the file, without range
+    vector<Double_t> Total_Deaths;
+    vector<TString> Case_Dates;             // same for the total cases, parsed with the deaths
+    vector<Double_t> Total_Cases;
+};
+
+// results of UpdateDataFile
+enum EDataUpdates {kDataNotFound = -1, kDataUnchanged = 0, kDataAppended = 1, kDataRead = 2};
+
+// to parse the lines appended to a data file since the previous call, or the whole file if its beginning has changed
+// (the compressed files, the streams and the wide files are always fully parsed, the number of bytes parsed is added to BytesParsed if given)
+Int_t UpdateDataFile(DataFile &data, Long64_t *BytesParsed=nullptr);
+
+// to keep only the data read between two dates ("": no limit), as done by ReadData on a file
+void TrimDataRange(vector<TString> &dates, vector<Double_t> &total_deaths, TString DateFrom, TString DateTo);
+
+// to expand a country name, or a shell pattern, on the files of the data folder (compressed or not), or on the columns
+// of a wide file ("File:Pattern"), returns false if nothing matches
+Bool_t ExpandCountry(TString Pattern, vector<TString> &Countries);
+
+// fonction to smooth the data on N sucessive days
+void SmoothVector(Int_t N, vector<double> &data, vector<double> &data_err);
+
+// to compute the prefix sums used by the smoothing, and to smooth the data from these sums: average of the N last days,
+// or of the N days centred on each day (Centred, the window being cut at the edges), which does not shift the data in time
+void BuildPrefixSums(const vector<Double_t> &data, vector<Double_t> &sum, vector<Double_t> &npoints);
+void SmoothFromPrefixSums(Int_t N, const vector<Double_t> &sum, const vector<Double_t> &npoints, vector<Double_t> &smooth, vector<Double_t> &smooth_err, Bool_t Centred=false);
+
+// reporting anomalies of daily data: negative day (downward revision) or spike (backlog dump), and their corrections:
+// kept as they are, excluded (set to 0, not taken into account by the smoothing), or redistributed on the previous days
+// proportionally to their values, the day being set to its expected value: the total is conserved, the window being widened
+// to the earlier days until a deficit is absorbed, except for a deficit larger than all the previous days (Unabsorbed)
+enum EAnomalies {kAnomalyNegative, kAnomalySpike, kNAnomalies};
+enum EAnomalyModes {kAnomalyKeep, kAnomalyExclude, kAnomalyRedistribute, kNAnomalyModes};
+
+// structure containing a reporting anomaly
+struct Anomaly {
+    Int_t Index = 0;                        // index of the day in the data
+    Int_t Type = kAnomalySpike;
+    Double_t Value = 0.;                    // reported value
+    Double_t Expected = 0.;                 // median of the surrounding days
+    Double_t Score = 0.;                    // (Value-Expected)/(1.4826*MAD), the MAD being at least sqrt(Expected)
+    Int_t Mode = kAnomalyKeep;              // correction applied
+    Double_t Unabsorbed = 0.;               // part of a redistributed deficit larger than all the previous days (negative)
+};
+
+// to find the reporting anomalies of daily data, from the median and the MAD of the positive values of the Window days
+// centred on each day (the day itself excluded), in O(n*Window): the negative days, and the days above the median by more
+// than Threshold times the robust standard deviation, and more than twice the median
+void DetectAnomalies(const vector<Double_t> &data, Int_t Window, Double_t Threshold, vector<Anomaly> &anomalies);
+
+// to correct the anomalies of daily data (Mode: EAnomalyModes), the redistribution being done on the Days previous days,
+// or more for a deficit that they cannot absorb
+void CorrectAnomalies(vector<Double_t> &data, vector<Anomaly> &anomalies, Int_t Mode, Int_t Days);
+
+// to decompose daily data into a trend and multiplicative weekday factors, data[i] = trend[i]*factors[(FirstWeekday+i)%7]
+// (weekdays from 0 = Monday): the trend is the centred 7 days average of the data divided by the factors, and each factor
+// the ratio of the data to the trend on its weekday, normalised to a mean of 1. The two are iterated NIterations times, each
+// iteration in O(n) from prefix sums, only the positive data being taken into account. adjusted = data/factors
+void DecomposeWeekly(const vector<Double_t> &data, Int_t FirstWeekday, Int_t NIterations, vector<Double_t> &factors, vector<Double_t> &trend, vector<Double_t> &adjusted);
+
+// to compute in place the discrete Fourier transform of a vector whose size is a power of 2 (radix-2 FFT in O(n log n)),
+// or its inverse, normalised by 1/n
+void FFT(vector<complex<Double_t>> &data, Bool_t Inverse=false);
+
+// to get the smallest power of 2 greater or equal to N
+size_t NextPowerOfTwo(size_t N);
+
+// to compute the linear convolution of two vectors by FFT in O(n log n): result[t] = sum_k a[k]*b[t-k], t < a.size()+b.size()-1
+void Convolve(const vector<Double_t> &a, const vector<Double_t> &b, vector<Double_t> &result);
+
+// to discretise on days a gamma distribution of given mean and standard deviation: the weight of day d >= FirstDay is the
+// probability between d-0.5 and d+0.5, the distribution being cut when 99.9% of it is reached (not normalised)
+vector<Double_t> DiscretiseGamma(Double_t Mean, Double_t SD, Int_t FirstDay=0);
+
+// structure containing the spectra of a delay kernel for a given length of data, computed once to deconvolve many curves:
+// data[t] = sum_d Kernel[d]*x[t+K-1-d], the deconvolved curve x starting K-1 days before the data (K = Kernel size)
+struct Deconvolver {
+    vector<Double_t> Kernel;                // normalised to 1
+    size_t Length = 0;                      // length of the data
+    size_t Size = 0;                        // size of the FFTs, without wrapping
+    vector<complex<Double_t>> Spectrum;     // FFT of the kernel
+    vector<complex<Double_t>> Adjoint;      // FFT of the reversed kernel
+};
+
+// to compute the spectra of a deconvolver
+void InitDeconvolver(Deconvolver &deconvolver, const vector<Double_t> &kernel, size_t Length);
+
+// to deconvolve data (of the deconvolver length) by Richardson-Lucy iterations (positive result, the number of iterations
+// being the regularisation), or by a Tikhonov regularised inverse filter (Lambda relative to the maximal power of the kernel,
+// the data being mirrored and tapered at their edges against the ringing of the circular filter), each iteration or filter
+// costing a few FFTs (the result has Length+K-1 values)
+void DeconvolveRichardsonLucy(const Deconvolver &deconvolver, const vector<Double_t> &data, Int_t NIterations, vector<Double_t> &result);
+void DeconvolveTikhonov(const Deconvolver &deconvolver, const vector<Double_t> &data, Double_t Lambda, vector<Double_t> &result);
+
+// to get the wall time (steady clock) and the cpu time of the current thread, in seconds
+Double_t GetRealTime();
+Double_t GetThreadCpuTime();
+
+// to get the resident memory of the process, in kB
+Long_t GetResidentMemory();
+
+// to check that NAnalyses repeated analyses ran in constant memory: the resident memory (kB) may grow by MaxGrowth kB per
+// analysis at most, which leaves room for the allocator fluctuations but not for an object leaked by each analysis
+Bool_t CheckMemoryGrowth(TString What, Int_t NAnalyses, Long_t Start, Long_t End, Double_t MaxGrowth=0.25);
+
+// to give the ownership of an object drawn in the current pad to the pad: it is deleted when the pad is cleared
+template<class T> T *PadOwned(T *object) {
+    if(object) object->SetBit(TObject::kCanDelete);
+    return object;
+}
+
+// to run NTasks tasks on NThreads threads (0: number of cores)
+void RunParallel(Int_t NTasks, Int_t NThreads, const function<void(Int_t)> &Task);
+
+////////////////////////////
+/// Printouts coloration ///
+////////////////////////////
+
+#define ERR_MESS  std::cout<<"\e[0;3;91m -- ERROR   : "
+#define WARN_MESS std::cout<<"\e[0;3;93m -- WARNNING: "
+#define INFO_MESS std::cout<<"\e[0;3;92m -- INFO    : \e[0;3;94m"
+#define TITLE_MESS std::cout<<" \e[0;4;92m"
+#define END_MESS  "\e[0;3m"
+#define ENDL END_MESS<<std::endl
+
+#endif
@@ -1,3 +1,8 @@
+#ifndef COVID19_DAILY_H
+#define COVID19_DAILY_H
+
+#include "covid19_common.h"
+
 #include "Riostream.h"
 #include "TGraph.h"
 #include "TObjArray.h"
@@ -25,6 +30,28 @@
 #include "TRandom3.h"
 #include "TSystem.h"
 #include "TGraphErrors.h"
+#include "TTree.h"
+#include "TTreeReader.h"
+#include "TTreeReaderValue.h"
+#include "TROOT.h"
+#include "Math/MinimizerOptions.h"
+#include "Math/IFunction.h"
+#include "Math/IParamFunction.h"
+
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <cerrno>
+
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
 
 using namespace  std;
 
@@ -32,78 +59,800 @@ using namespace  std;
 /// Global parameters definition ///
 ////////////////////////////////////
 
-// number of average days in the sliding window
-Int_t fNSmoothing = 7;
+// the smoothing, the ranges of dates and the headless mode are shared with the total analysis (covid19_common.h)
 
 // Models parameters
-Bool_t fDoFullModel = true;
-Bool_t fDoD = false;
-Bool_t fDoD2 = true;
-Bool_t fDoESIR = false;
-Bool_t fDoESIR2 = true;
+extern Bool_t fDoFullModel;
+extern Bool_t fDoD;
+extern Bool_t fDoD2;
+extern Bool_t fDoESIR;
+extern Bool_t fDoESIR2;
+extern Bool_t fDoSIR;
+extern Bool_t fDoSEIRD;
+
+// Compartmental models (SIR, SEIRD), integrated numerically: mean incubation and infectious periods (days), number of
+// days over which the transmission is reduced around tm, and relative tolerance of the adaptive integration
+extern Double_t fIncubationDays;
+extern Double_t fInfectiousDays;
+extern Double_t fReductionDays;
+extern Double_t fODETolerance;
+
+// Waves detection, used to define the default fit range, t0 and the initial parameters
+extern Bool_t fDoWaveDetection;
+// Minimal prominence of a wave peak, relative to the maximum of the smoothed data
+extern Double_t fWaveMinProminence;
+
+// Reporting anomalies of the raw daily data (backlog dumps and negative days), always searched and recorded in the series
+// correction (EAnomalyModes of covid19_common.h): kept (default), excluded or redistributed on the previous days
+extern Int_t fAnomalyMode;
+// number of days of the window of the median and MAD, also used for the redistribution, and threshold of the robust score
+extern Int_t fAnomalyWindow;
+extern Double_t fAnomalyThreshold;
+
+// Weekday decomposition: the weekly reporting cycle is removed by multiplicative weekday factors before the smoothing,
+// which is then centred on each day instead of delaying the data
+extern Bool_t fDoWeekly;
+// number of iterations between the trend and the weekday factors
+extern Int_t fWeeklyIterations;
 
-// Range of dates to be read from the input files
-TString fReadDataFrom = "";
-TString fReadDataTo = "";
+// ROOT file where the analysis state is saved, to be re-plotted without refitting ("": not saved)
+extern TString fStateFile;
 
-// Range of dates for the X axis of the histogram
-TString fAxisRangeFrom = "";
-TString fAxisRangeTo = "";
+// file where the timing of each analysis is appended, as JSON lines ("": not written)
+extern TString fTimingFile;
 
-// Range of dates for the fit
-TString fFitRangeFrom = "";
-TString fFitRangeTo = "";
+// maximal relative difference between the sum of the regional fits and the national fit or data, for the regional analysis
+extern Double_t fRegionTolerance;
+
+// Analysis of the confirmed cases, read with the deaths, and estimation of the lag between the cases and the deaths
+extern Bool_t fDoCases;
+// maximal lag searched between the cases and the deaths, in days
+extern Int_t fMaxLag;
+
+// Estimation of the effective reproduction number Rt with the renewal equation
+extern Bool_t fDoRt;
+// generation interval: gamma distribution of given mean and standard deviation (days), or daily weights (used if not empty)
+extern Double_t fRtGenerationMean;
+extern Double_t fRtGenerationSD;
+extern vector<Double_t> fRtGeneration;
+// number of days on which Rt is assumed constant, and delay between the infections and the data (days)
+extern Int_t fRtWindow;
+extern Int_t fRtDelay;
+// Rt estimated on the infections deconvolved from the data instead of the data shifted by fRtDelay (if fDoDeconvolution)
+extern Bool_t fRtFromInfections;
+
+// Deconvolution of the daily deaths back to the infections, with the infection-to-death delay distribution
+extern Bool_t fDoDeconvolution;
+// delay distribution: gamma distribution of given mean and standard deviation (days), or daily weights (used if not empty)
+extern Double_t fDelayMean;
+extern Double_t fDelaySD;
+extern vector<Double_t> fDelayWeights;
+// method (EDeconvolutionMethods), and its regularisation: number of iterations for Richardson-Lucy, Lambda for Tikhonov
+extern Int_t fDeconvolutionMethod;
+extern Double_t fDeconvolutionRegularisation;
+
+// Forecast of each fit after the last data, with 95% intervals propagated from the covariance matrix, computed on demand
+// and cached per fit: number of projected days, and number of days after the last data at which the final toll is taken
+extern Bool_t fDoForecast;
+extern Int_t fForecastDays;
+extern Int_t fForecastFinalDays;
 
 ///////////////////////////////////
 /// Global variables definition ///
 ///////////////////////////////////
 
-// dummy histogram to make some tests on the defined dates
-TH1D *hDummyHist = nullptr;
-TH1D *hDaily_Deaths = nullptr;
+extern TH1D *hDaily_Deaths;
 
-// declaration of global variables used in the code for D, D2, ESIR, ESIR2
-Int_t fColors[4] = {kMagenta,kGreen,kBlue,kRed};
+// declaration of global variables used in the code for D, D2, ESIR, ESIR2, SIR, SEIRD
+enum EModels {kModelD, kModelD2, kModelESIR, kModelESIR2, kModelSIR, kModelSEIRD, kNModels};
+extern Int_t fColors[kNModels];
+extern const char *fModelNames[kNModels];
 
-// Minimal number of deaths to start to be taken into acount
-Int_t DeathsMin = 10;
+// names of the reporting anomalies and of their corrections
+extern const char *fAnomalyNames[kNAnomalies];
+extern const char *fAnomalyModeNames[kNAnomalyModes];
+
+// methods of deconvolution of the daily deaths back to the infections
+enum EDeconvolutionMethods {kRichardsonLucy, kTikhonov, kNDeconvolutionMethods};
+extern const char *fDeconvolutionNames[kNDeconvolutionMethods];
 
 // vectors containing the data
-vector<TString> vDates;
-vector<Double_t> vTotal_Deaths;
-vector<Double_t> vDaily_Deaths;
-vector<Double_t> vDaily_Deaths_error;
+extern vector<TString> vDates;
+extern vector<Double_t> vTotal_Deaths;
+extern vector<Double_t> vDaily_Deaths;
+extern vector<Double_t> vDaily_Deaths_error;
+
+// stages of the analysis of a country, timed in each analysis
+enum EStages {kStageRead, kStageSmooth, kStageFit, kStageBand, kStageDeconvolution, kStageRt, kStageDraw, kStagePicture, kNStages};
+extern const char *fStageNames[kNStages];
+
+// structure containing the wall and cpu time spent in each stage of the analysis of a country
+struct Timing {
+    Double_t RealTime[kNStages] = {};
+    Double_t CpuTime[kNStages] = {};        // cpu time of the thread running the stage
+};
+
+// structure containing the start of a timed stage
+struct StageClock {
+    Double_t Real = 0.;
+    Double_t Cpu = 0.;
+};
+
+// structure containing a wave found in the smoothed daily data (positions are indexes in the data vectors)
+struct Wave {
+    Int_t Onset = 0;            // trough before the peak
+    Int_t Peak = 0;             // maximum of the wave
+    Int_t End = 0;              // trough after the peak
+    Double_t Height = 0.;       // value at the peak
+    Double_t Prominence = 0.;   // height of the peak above the highest of the two surrounding troughs
+    Double_t Area = 0.;         // number of deaths of the wave, assuming a symmetric wave around the peak
+    Double_t RiseWidth = 0.;    // number of days between the half height on the rising edge and the peak
+};
+
+// vector containing the waves found in the current data
+extern vector<Wave> vWaves;
+
+// structure containing all the data of a country, used to run the analysis steps independently of the global vectors
+struct Series {
+    TString Country;
+    vector<TString> Dates;
+    vector<Int_t> Bins;                     // histogram bin of each date (-1 if out of the histogram range)
+    vector<Double_t> Total_Deaths;
+    vector<Double_t> Raw_Daily_Deaths;      // daily deaths before smoothing
+    vector<Double_t> Prefix_Sum;            // prefix sums of the positive daily deaths, to smooth on any window in O(n) (of the
+                                            // deaths corrected by the weekday factors for a weekly series read from a state file)
+    vector<Double_t> Prefix_NPoints;        // prefix counts of the positive daily deaths
+    Int_t NSmoothing = 0;
+    vector<Double_t> Daily_Deaths;          // smoothed daily deaths
+    vector<Double_t> Daily_Deaths_error;
+    vector<Wave> Waves;
+    Long64_t BytesRead = 0;                 // size of the data file
+    vector<Anomaly> Anomalies;              // reporting anomalies of the raw daily data, found when the series is built
+    Bool_t Weekly = false;                  // weekly cycle removed before a centred smoothing (fDoWeekly)
+    vector<Double_t> Weekday_Factors;       // 7 multiplicative factors of the raw daily data, Monday first (if Weekly)
+    Bool_t Cases = false;                   // confirmed cases instead of deaths (the vectors named deaths then contain cases)
+    Double_t Scale = 1.;                    // scale of the models amplitudes: 1 for the deaths, number of cases per death for the cases
+};
+
+// structure containing the result of the fit of one model
+struct ModelFit {
+    Int_t Model = -1;
+    Bool_t FullModel = false;
+    Int_t XMin = 0;                         // fit range, in histogram bins
+    Int_t XMax = 0;
+    vector<TString> ParNames;
+    vector<Double_t> Pars;
+    vector<Double_t> Errors;
+    vector<Double_t> Covariance;            // NPars x NPars matrix, stored line by line
+    Double_t Chi2 = 0.;
+    Int_t Ndf = 0;
+    Int_t Status = -1;
+    Bool_t Valid = false;
+    Int_t NCalls = 0;                       // number of FCN calls
+    Int_t NIterations = 0;                  // number of Migrad iterations
+    Int_t CovStatus = -1;                   // covariance matrix status (3: full and accurate Hesse matrix)
+    Double_t RealTime = 0.;                 // time spent in the fit (without the band)
+    vector<Double_t> Band;                  // fitted function on each histogram bin (index = bin-1)
+    vector<Double_t> Band_error;            // 95% confidence interval on each histogram bin
+};
+
+// number of parameters of the compartmental models: a (population x fatality ratio), R0, m (reduction of the transmission),
+// tm (days between t0 and the middle of the reduction), i0 (infectious fraction at t0) and t0
+const Int_t kNCompartmentalPars = 6;
+
+// structure containing a batch of integrations of a compartmental model, one per parameter set, stored as structure of
+// arrays (index of the set last) so that all the sets are advanced together with the same steps
+struct CompartmentalBatch {
+    Int_t Model = kModelSEIRD;
+    Int_t NSets = 0;
+    Bool_t Sensitivities = false;           // forward sensitivities integrated with the model, to get the exact gradients
+    vector<Double_t> Times;                 // output times, in days after t0, increasing
+    vector<Double_t> Pars;                  // Pars[ipar*NSets+k]: kNCompartmentalPars parameters of each set
+    vector<Double_t> Daily;                 // Daily[itime*NSets+k]: daily deaths of each set at each output time
+    vector<Double_t> Gradient;              // Gradient[(itime*kNCompartmentalPars+ipar)*NSets+k], with the sensitivities
+    Int_t NSteps = 0;                       // accepted and rejected steps of the last integration
+    Int_t NRejected = 0;
+};
+
+// structure containing the lag between the daily cases and the daily deaths, found by cross-correlation
+struct LagEstimate {
+    Int_t Lag = 0;                          // days between a case and the corresponding death
+    Double_t Ratio = 0.;                    // deaths per case, the deaths being shifted by the lag
+    Double_t Correlation = 0.;              // correlation coefficient at the lag, on the days where both series overlap
+    Bool_t Valid = false;
+};
+
+// structure containing the effective reproduction number of a series, with its 95% credible interval, on each day
+// where it can be estimated (date of the end of the window, shifted by the infection delay)
+struct RtEstimate {
+    vector<Int_t> Bins;                     // histogram bin of each estimate
+    vector<Double_t> Mean;                  // posterior mean
+    vector<Double_t> Low;                   // 2.5% and 97.5% posterior quantiles
+    vector<Double_t> High;
+    Bool_t Valid = false;
+};
+
+// structure containing the infections deconvolved from the smoothed data and from the fitted curves of a series
+struct InfectionCurves {
+    vector<Double_t> Data;                  // infections of each histogram bin (index = bin-1), 0 before the data
+    vector<vector<Double_t>> Fits;          // same for the fitted curve of each model (index of the fit in the result)
+    Int_t LastReliableBin = 0;              // the later infections are not yet seen in the deaths (right truncation): they
+                                            // are extrapolated from the last data, mirrored by the Tikhonov filter
+    Bool_t Valid = false;
+};
+
+// structure containing the projection of a fit after the last data of its series, with 95% intervals propagated from
+// the covariance matrix with the normalisation of the confidence band (the cumulative deaths start from the last total)
+struct Forecast {
+    Int_t Model = -1;
+    Int_t LastBin = 0;                      // histogram bin of the last data
+    Double_t LastTotal = 0.;                // total deaths at the last data
+    vector<Int_t> Bins;                     // projected days, from LastBin+1 (after 2021 the bins have no date)
+    vector<Double_t> Daily;                 // projected daily deaths
+    vector<Double_t> Daily_error;
+    vector<Double_t> Cumulative;            // projected total deaths
+    vector<Double_t> Cumulative_error;
+    Double_t PeakX = 0.;                    // maximum of the fitted curve from t0 to the final toll, in histogram x (between two days)
+    Double_t PeakX_error = 0.;
+    Double_t PeakHeight = 0.;
+    Double_t PeakHeight_error = 0.;
+    Int_t FinalDays = 0;
+    Double_t FinalToll = 0.;                // total deaths FinalDays after the last data
+    Double_t FinalToll_error = 0.;
+    Bool_t Valid = false;
+};
+
+// structure containing the full result of the analysis of a country, filled without any graphics
+struct AnalysisResult {
+    TString Country;
+    Series Data;
+    Int_t XMin = 0;                         // fit range, in histogram bins
+    Int_t XMax = 0;
+    vector<ModelFit> Fits;                  // one per fitted model
+    Timing Timings;
+    Series Cases;                           // confirmed cases, analysed if fDoCases
+    Int_t CasesXMin = 0;
+    Int_t CasesXMax = 0;
+    vector<ModelFit> CaseFits;
+    LagEstimate Lag;
+    RtEstimate Rt;                          // effective reproduction number, estimated if fDoRt
+    InfectionCurves Infections;             // deconvolved if fDoDeconvolution
+};
+
+// structure containing the comparison, for one model, of the sum of the regional fits with the national fit and data,
+// the numbers of deaths being integrated over the shared fit range
+struct RegionCheck {
+    Int_t Model = -1;
+    Int_t NRegions = 0;                     // regions fitted
+    Int_t NValid = 0;                       // regions with a valid fit
+    Double_t SumRegions = 0.;               // deaths of the sum of the regional fits
+    Double_t National = 0.;                 // deaths of the national fit
+    Double_t NationalData = 0.;             // deaths of the national smoothed data
+    Double_t FitDeviation = 0.;             // (SumRegions-National)/National
+    Double_t DataDeviation = 0.;            // (SumRegions-NationalData)/NationalData
+    Double_t MaxDeviation = 0.;             // maximal daily difference between the two fits, relative to the maximum of the national fit
+    Bool_t Consistent = false;
+};
+
+// structure containing the analysis of all the regions of a wide file and of the national total, on one shared fit range
+struct RegionalResult {
+    TString FileName;
+    TString NationalColumn;
+    vector<AnalysisResult> Regions;         // one per region with data
+    AnalysisResult National;
+    Int_t XMin = 0;                         // shared fit range, in histogram bins
+    Int_t XMax = 0;
+    Int_t NDataMismatches = 0;              // days where the sum of the regional totals differs from the national total
+    Double_t MaxDataMismatch = 0.;
+    vector<RegionCheck> Checks;             // one per model
+};
+
+// structure containing a joint fit of one model on several series (regions or countries) on one shared fit range:
+// some parameters (by default the time scales) are common to all the series, or partially pooled around a common value,
+// while the other ones (amplitudes, ...) stay specific to each series
+struct JointResult {
+    Int_t Model = -1;
+    Bool_t FullModel = false;
+    Int_t XMin = 0;                         // shared fit range, in histogram bins
+    Int_t XMax = 0;
+    Double_t Pooling = 0.;                  // 0: shared parameters, >0: relative spread of the pooled parameters around their common value
+    vector<TString> SharedNames;            // model parameters shared or pooled
+    vector<Double_t> SharedPars;            // their common values
+    vector<Double_t> SharedErrors;
+    vector<AnalysisResult> Results;         // one per series, the joint fit being its only fit
+    Double_t Chi2 = 0.;                     // total chi2, including the pooling penalty
+    Int_t Ndf = 0;
+    Int_t NPars = 0;                        // free parameters of the joint fit
+    Int_t Status = -1;
+    Bool_t Valid = false;
+    Int_t NCalls = 0;
+    Double_t RealTime = 0.;
+};
+
+// chi2 of a joint fit: sum of the chi2 of each series, whose model parameters are taken in the joint parameters through
+// Index, plus the pooling penalty. The gradient only evaluates the series depending on each parameter (block structure):
+// a parameter of one series costs one series, a shared one all the series, so that a gradient of N series costs about
+// as much as the gradients of N separate fits, instead of growing as N^2
+class JointChi2 : public ROOT::Math::IMultiGradFunction {
+public:
+    vector<shared_ptr<TF1>> Funcs;          // model of each series
+    vector<vector<Double_t>> X, Y, E;       // fitted points of each series
+    vector<vector<Int_t>> Index;            // joint parameter of each model parameter of each series
+    vector<vector<Int_t>> Affected;         // series depending on each joint parameter
+    vector<Bool_t> Fixed;
+    vector<pair<Int_t,Int_t>> Pooled;       // partial pooling: (parameter of a series, common value)
+    Double_t Pooling = 0.;
+    UInt_t NPars = 0;
+
+    unsigned int NDim() const override { return NPars; }
+    ROOT::Math::IBaseFunctionMultiDim *Clone() const override { return new JointChi2(*this); }
+
+    // chi2 of one series, and penalty of the pooled parameters
+    Double_t SeriesChi2(size_t iseries, const double *x) const;
+    Double_t Penalty(const double *x) const;
+
+private:
+    double DoEval(const double *x) const override;
+    double DoDerivative(const double *x, unsigned int icoord) const override;
+};
+
+// daily deaths of a compartmental model as a parametric function, with its exact gradient with respect to the parameters
+// (forward sensitivities) given to the fitter. The model is integrated once per set of parameters on a grid of half days
+// from t0 to xhigh, and interpolated between the grid points (the fitted points being on it). The instance of a fit has a
+// grid ending one day after the fit range, the later points (the dummy point of the fit) being 0; the instances of the
+// bands and the forecasts extend their grid to the latest time requested (Extend)
+class CompartmentalFunction : public ROOT::Math::IParamMultiGradFunction {
+public:
+    CompartmentalFunction(Int_t model=kModelSEIRD, Double_t xhigh=0., Bool_t extend=false) : Model(model), XHigh(xhigh), Extend(extend), Pars(kNCompartmentalPars,0.) {}
+
+    unsigned int NDim() const override { return 1; }
+    unsigned int NPar() const override { return kNCompartmentalPars; }
+    const double *Parameters() const override { return Pars.data(); }
+    void SetParameters(const double *p) override { Pars.assign(p,p+kNCompartmentalPars); }
+    ROOT::Math::IBaseFunctionMultiDim *Clone() const override { return new CompartmentalFunction(*this); }
+    void ParameterGradient(const double *x, const double *p, double *grad) const override;
+
+private:
+    double DoEvalPar(const double *x, const double *p) const override;
+    double DoParameterDerivative(const double *x, const double *p, unsigned int ipar) const override;
+
+    // to integrate the model if p differs from the parameters of the cache, or if x is after the end of its grid
+    Bool_t Update(Double_t x, const double *p, Bool_t Sensitivities) const;
+
+    Int_t Model;
+    Double_t XHigh;                         // end of the grid (at least, if Extend)
+    Bool_t Extend;                          // grid extended after XHigh to the latest time requested, else 0 after XHigh
+    vector<Double_t> Pars;
+    mutable CompartmentalBatch Cache;
+    mutable Bool_t Cached = false;
+};
+
+// functor of the TF1 of a compartmental model, each copy of the TF1 having its own cache
+struct CompartmentalFunctor {
+    CompartmentalFunction Func;
+    CompartmentalFunctor(Int_t Model, Double_t XHigh) : Func(Model,XHigh,true) {}
+    Double_t operator()(Double_t *x, Double_t *p) const { return Func(x,p); }
+};
+
+// structure containing the memoised stages of the analysis of a country in the session:
+// read -> trim and differentiate -> smooth -> fit and band per model -> render
+// each stage keeps the key of the inputs it has been computed from, and is computed again only if this key changes,
+// the stages after it being then invalidated (ex: a new axis range only redraws, a new smoothing refits)
+struct Pipeline {
+    TString ReadKey;                        // file name, modification time and size
+    DataFile File;                          // full data file, read incrementally
+    Long64_t BytesRead = 0;                 // bytes parsed at the last read
+    UInt_t ReadVersion = 0;
+
+    TString SeriesKey;                      // read version, read range and DeathsMin
+    Series Raw;                             // trimmed data and daily deaths, not smoothed
+    Bool_t RawOk = false;
+    UInt_t SeriesVersion = 0;
+
+    TString SmoothKey;                      // series version, smoothing and waves detection parameters
+    Series Smoothed;
+    UInt_t SmoothVersion = 0;
+
+    map<TString,ModelFit> Fits;             // per smooth version, model, full model and fit range
+
+    TString RenderKey;                      // inputs of the last plot
+};
+
+extern Pipeline fPipeline;
+
+// structure containing the files of an export, created once per batch, one record being then appended per country
+struct Exporter {
+    TString FileName;                       // without extension
+    Bool_t DoCSV = false;
+    Bool_t DoJSON = false;
+    Bool_t DoROOT = false;
+    ofstream FitsCSV;
+    ofstream CovarianceCSV;
+    ofstream CurvesCSV;
+    ofstream RtCSV;                         // only if fDoRt
+    ofstream InfectionsCSV;                 // only if fDoDeconvolution
+    ofstream ForecastCSV;                   // only if fDoForecast
+    ofstream JSON;
+    TFile *File = nullptr;
+    TTree *Tree = nullptr;
+    // branches of the tree, one entry per country and model
+    string Country, LastDate, Model, FitFrom, FitTo;
+    Int_t Smoothing = 0, Status = 0, Ndf = 0, NCalls = 0, FirstBin = 0;
+    Bool_t FullModel = false, Valid = false;
+    Double_t Chi2 = 0.;
+    vector<string> ParNames;
+    vector<Double_t> Pars, Errors, Covariance;
+    vector<Double_t> Data, Data_error, Fit, Band_error;     // per day, from FirstBin
+};
+
+// structure containing the render workers: forked processes that plot the results sent through pipes,
+// while the main process continues to fit the next countries
+struct RenderQueue {
+    vector<pid_t> Workers;
+    vector<int> Pipes;                      // write end of the input pipe of each worker
+    int ReadyPipe = -1;                     // read end of the pipe where the idle workers write their index
+    thread Dispatcher;                      // thread sending the queued results to the idle workers
+    mutex Mutex;
+    condition_variable Condition;
+    deque<string> Queue;                    // serialized results waiting for a worker
+    Bool_t Stop = false;
+};
+
+// helpers to write and read simple values and vectors in a binary buffer (used to send the results to the render workers)
+template<class T> void WriteBuffer(string &buffer, const T &value) {
+    buffer.append((const char*)&value,sizeof(T));
+}
+template<class T> void WriteBuffer(string &buffer, const vector<T> &values) {
+    WriteBuffer(buffer,(UInt_t)values.size());
+    if(!values.empty()) buffer.append((const char*)values.data(),values.size()*sizeof(T));
+}
+inline void WriteBuffer(string &buffer, const TString &value) {
+    WriteBuffer(buffer,(UInt_t)value.Length());
+    buffer.append(value.Data(),value.Length());
+}
+inline void WriteBuffer(string &buffer, const vector<TString> &values) {
+    WriteBuffer(buffer,(UInt_t)values.size());
+    for(auto &value : values) WriteBuffer(buffer,value);
+}
+template<class T> bool ReadBuffer(const string &buffer, size_t &pos, T &value) {
+    if(pos+sizeof(T) > buffer.size()) return false;
+    memcpy(&value,buffer.data()+pos,sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+template<class T> bool ReadBuffer(const string &buffer, size_t &pos, vector<T> &values) {
+    UInt_t Size;
+    if(!ReadBuffer(buffer,pos,Size) || pos+(size_t)Size*sizeof(T) > buffer.size()) return false;
+    values.resize(Size);
+    if(Size) memcpy(values.data(),buffer.data()+pos,Size*sizeof(T));
+    pos += Size*sizeof(T);
+    return true;
+}
+inline bool ReadBuffer(const string &buffer, size_t &pos, TString &value) {
+    UInt_t Size;
+    if(!ReadBuffer(buffer,pos,Size) || pos+Size > buffer.size()) return false;
+    value = TString(buffer.data()+pos,Size);
+    pos += Size;
+    return true;
+}
+inline bool ReadBuffer(const string &buffer, size_t &pos, vector<TString> &values) {
+    UInt_t Size;
+    if(!ReadBuffer(buffer,pos,Size)) return false;
+    values.resize(Size);
+    for(auto &value : values) if(!ReadBuffer(buffer,pos,value)) return false;
+    return true;
+}
 
 ////////////////////////////
 /// Functions definition ///
 ////////////////////////////
 
+// Main fonction that plots the data and process the fits
+void Analyse(TString theCountry);
+
 // to print all the parameters in the terminal
 void PrintParameters(TString country_name);
 
 // to define the models we want to fit
-void SetModels(Bool_t DoD=false, Bool_t DoD2=true, Bool_t DoESIR=false, Bool_t DoESIR2=true, Bool_t FullModel=true);
+void SetModels(Bool_t DoD=false, Bool_t DoD2=true, Bool_t DoESIR=false, Bool_t DoESIR2=true, Bool_t FullModel=true, Bool_t DoSIR=false, Bool_t DoSEIRD=false);
+
+// to define the periods of the compartmental models (days): incubation (SEIRD), infectious, and reduction of the
+// transmission around tm, and the relative tolerance of their integration
+void SetCompartmental(Double_t IncubationDays=5.2, Double_t InfectiousDays=7., Double_t ReductionDays=7., Double_t Tolerance=1e-6);
+
+// to activate the waves detection, used for the default fit range, t0 and initial parameters
+void SetWaveDetection(Bool_t DoWaves=true, Double_t MinProminence=0.2);
+
+// to choose the correction of the reporting anomalies (kAnomalyKeep, kAnomalyExclude or kAnomalyRedistribute), the window
+// of the median and MAD (days) and the threshold of the robust score
+void SetAnomalies(Int_t Mode=kAnomalyRedistribute, Int_t Window=21, Double_t Threshold=6.);
+
+// to activate the weekday decomposition: the weekly reporting cycle is removed before a centred smoothing
+void SetWeeklyDecomposition(Bool_t DoWeekly=true, Int_t NIterations=3);
+
+// to read, smooth and fit the data of a country without any graphics, returns false if the data are not available
+Bool_t AnalyseData(TString theCountry, AnalysisResult &result);
+
+// to read, smooth and fit the data of a country through the memoised stages of fPipeline, only the stages whose inputs
+// have changed being computed again (their names are added to Computed if given), returns false if the data are not available
+Bool_t RunPipeline(TString theCountry, AnalysisResult &result, vector<TString> *Computed=nullptr);
+
+// to forget the memoised stages, the next analysis computing everything again
+void ResetPipeline();
+
+// to plot the result of an analysis (the drawing and picture times are added to timing if given)
+void DrawResult(const AnalysisResult &result, Timing *timing=nullptr);
+
+// to print the result of a fit in the terminal
+void PrintFit(const ModelFit &fit);
+
+// to activate the analysis of the confirmed cases, and the estimation of their lag with the deaths (searched up to MaxLag days)
+void SetCases(Bool_t DoCases=true, Int_t MaxLag=60);
+
+// to estimate the lag and ratio between the cases and the deaths by a cross-correlation of the smoothed daily data,
+// computed by FFT in O(n log n) (returns false if the correlation is not positive)
+Bool_t EstimateLag(const Series &cases, const Series &deaths, LagEstimate &lag, Int_t MaxLag=60);
+
+// to smooth and fit the cases of a result (already read in result.Cases) and to estimate their lag with the deaths
+// (the fits are taken in Fits, by key, if given, and added to it)
+void AnalyseCases(AnalysisResult &result, map<TString,ModelFit> *Fits=nullptr);
+
+// to get the cases of a result as a result on its own, to be plotted, printed or exported as the deaths
+AnalysisResult GetCasesResult(const AnalysisResult &result);
+
+// to print the lag and the fits of the cases
+void PrintCases(const AnalysisResult &result);
 
-// to change fNSmoothing
-void SetSmoothing(Int_t Ndays=7);
+// to activate the estimation of Rt, with a gamma generation interval (mean and standard deviation in days), Rt being
+// constant on Window days, and the data being delayed by Delay days with respect to the infections (or deconvolved
+// back to the infections if FromInfections and the deconvolution is activated)
+void SetRt(Bool_t DoRt=true, Double_t GenerationMean=6.5, Double_t GenerationSD=4., Int_t Window=7, Int_t Delay=0, Bool_t FromInfections=false);
 
-// to change the range of dates to be read
-void ReadDataRange(TString DateFrom="",TString DateTo="");
+// to give the generation interval as daily weights (day 1, day 2, ...), normalised to 1 ({}: back to the gamma distribution)
+void SetGenerationInterval(vector<Double_t> Weights);
 
-// to change axis range
-void SetAxisRange(TString DateFrom="",TString DateTo="");
+// to get the daily weights of the generation interval (index = days, the weight of day 0 being 0)
+vector<Double_t> GetGenerationInterval();
 
-// to change the fit range
-void SetFitRange(TString DateFrom="",TString DateTo="");
+// to estimate Rt on the smoothed daily data of a series with the renewal equation (Cori et al.): the infection pressure
+// sum_k w[k]*I[t-k] is computed by FFT convolution in O(n log n), and the gamma posterior of Rt on each window from prefix
+// sums in O(n) (returns false if Rt cannot be estimated)
+Bool_t EstimateRt(const Series &series, RtEstimate &rt);
+
+// same on a daily incidence without gap starting at the bin First, delayed by Delay days with respect to the infections
+Bool_t EstimateRt(const vector<Double_t> &Incidence, Int_t First, Int_t Delay, RtEstimate &rt);
+
+// to estimate the Rt of a result, on its infections if fRtFromInfections and they have been deconvolved, else on its data
+Bool_t EstimateRt(AnalysisResult &result);
+
+// to print the last estimates of Rt, and to plot Rt with its credible interval
+void PrintRt(const AnalysisResult &result);
+void DrawRt(const AnalysisResult &result);
+
+// to activate the deconvolution of the daily deaths back to the infections, with a gamma infection-to-death delay
+// (mean and standard deviation in days), by Richardson-Lucy (Regularisation = number of iterations) or Tikhonov
+// (Regularisation = Lambda, relative to the maximal power of the delay spectrum), the default regularisation being 50 iterations
+// or Lambda = 0.01
+void SetDeconvolution(Bool_t DoDeconvolution=true, Double_t DelayMean=23., Double_t DelaySD=10., Int_t Method=kRichardsonLucy, Double_t Regularisation=-1.);
+
+// to give the infection-to-death delay as daily weights (day 0, day 1, ...), normalised to 1 ({}: back to the gamma distribution)
+void SetDelayDistribution(vector<Double_t> Weights);
+
+// to get the daily weights of the infection-to-death delay (index = days)
+vector<Double_t> GetDelayDistribution();
+
+// to deconvolve the smoothed data and the fitted curves of a result back to the infections, the delay spectra being
+// computed once for all the fits (returns false if the data cannot be deconvolved)
+Bool_t DeconvolveResult(AnalysisResult &result);
+
+// to print the peaks of the infection curves, and to plot them
+void PrintInfections(const AnalysisResult &result);
+void DrawInfections(const AnalysisResult &result);
+
+// to activate the forecasts of the fits: NDays projected days, and final toll FinalDays after the last data
+void SetForecast(Bool_t DoForecast=true, Int_t NDays=30, Int_t FinalDays=365);
+
+// to project a fit after the last data of its series: the derivatives of the curve with respect to the parameters are
+// computed once on all the days (central differences, exact sensitivities for the compartmental models), and give the
+// errors of the daily and cumulative deaths, of the peak and of the final toll (thread safe, returns false if not valid)
+Bool_t ComputeForecast(const ModelFit &fit, const Series &series, Int_t NDays, Int_t FinalDays, Forecast &forecast);
+
+// same, the forecasts being cached by fit and last data: the next calls for the same fit only copy the cached forecast,
+// the least recently used forecast being evicted when the cache is full
+Bool_t GetForecast(const ModelFit &fit, const Series &series, Forecast &forecast, Int_t NDays=30, Int_t FinalDays=365);
+
+// to forget the cached forecasts, to get their number, and to set the maximum number of cached forecasts (at least 1)
+void ClearForecasts();
+size_t GetNForecasts();
+void SetForecastCacheSize(size_t Size=10000);
+
+// to print the forecasts of the fits of a result (fForecastDays, fForecastFinalDays), and to write a forecast in JSON
+void PrintForecast(const AnalysisResult &result);
+void WriteForecastJSON(ostream &json, const Forecast &forecast);
 
 // Init histograms
 void InitHistograms();
 
-// Fonction used to read the data files
+// Fonction used to read the data files in the global vectors
 bool ReadData(TString filename);
 
-// fonction to smooth the data on N sucessive days
-void SmoothVector(Int_t N, vector<double> &data, vector<double> &data_err);
+// to read the data of a country and to calculate the daily deaths (not smoothed)
+bool LoadSeries(TString theCountry, Series &series);
+
+// same for the deaths and the cases, read in the same parse (returns false if the deaths are not available, the cases being then empty)
+bool LoadSeries(TString theCountry, Series &deaths, Series &cases);
+
+// to build the cases series of a country from its dates and total cases, the amplitudes of the models being scaled by the number
+// of cases per death (returns false if there is no case)
+bool BuildCaseSeries(TString theCountry, const vector<TString> &dates, const vector<Double_t> &total_cases, const Series &deaths, Series &cases);
+
+// to calculate the daily deaths (not smoothed) from the dates and total deaths of a series (used for data already in memory)
+bool BuildSeries(Series &series);
+
+// to smooth the daily deaths of a country on N days, and to search the waves (if fDoWeekly, the weekday factors are
+// removed first, and the smoothing is centred)
+void SmoothSeries(Series &series, Int_t N);
+
+// to count the reporting anomalies of a series between two histogram bins
+Int_t CountAnomalies(const Series &series, Int_t XMin, Int_t XMax);
+
+// to print the reporting anomalies of a result, with a warning for each fit not valid with anomalies in its range
+void PrintAnomalies(const AnalysisResult &result);
+
+// to get the weekday (0 = Monday) of a histogram bin
+Int_t GetBinWeekday(Int_t Bin);
+
+// to print the weekday factors of a series
+void PrintWeekdayFactors(const Series &series);
+
+// to get the axis range and the fit range (in histogram bins) for a country
+void GetAxisRange(const Series &series, Int_t &DateMin, Int_t &DateMax);
+void GetFitRange(const Series &series, TString DateFrom, TString DateTo, Int_t &XMin, Int_t &XMax);
+
+// fonction to find the waves (onsets, peaks and troughs) in the smoothed data, in O(n log n)
+void DetectWaves(const vector<Double_t> &data, vector<Wave> &waves, Double_t MinProminence);
+
+// fonction to estimate the D model parameters (a, b, c) of a detected wave for a given t0, returns false if the wave is not available
+Bool_t GetWaveParameters(const Series &series, size_t iwave, Double_t t0, Double_t &a, Double_t &b, Double_t &c);
+
+// to move the initial parameters of a function inside their limits
+void ClampParameters(TF1 *func);
+
+// to build the function of a model, with its initial parameters and limits
+TF1 *InitModel(Int_t Model, Bool_t FullModel, TString Name, Double_t t0, const Series &series);
+
+// to get the list of models to be fitted
+vector<Int_t> GetModels();
+
+// to know if a model is integrated numerically (SIR, SEIRD) instead of being a closed-form function
+Bool_t IsCompartmental(Int_t Model);
+
+// to get the options of the compartmental models as a key of the memoised fits ("" for the other models)
+TString GetCompartmentalKey(Int_t Model);
+
+// to integrate a batch of parameter sets of a compartmental model with an adaptive Dormand-Prince 5(4) method, the
+// transmission beta(t) = R0/T_inf*(1-m/(1+exp(-(t-tm)/T_red))) decreasing by a factor (1-m) around tm. The daily deaths are
+// a/T_inf*i(t), i being the infectious fraction, and their derivatives with respect to all the parameters are integrated
+// with the model if batch.Sensitivities (returns false if the model or the parameters are not valid)
+Bool_t IntegrateCompartmental(CompartmentalBatch &batch);
+
+// to integrate in one batch the scenarios of a compartmental fit where the reduction m of the transmission is replaced by
+// each of Reductions, the curves being given on all the histogram bins (index = bin-1)
+Bool_t CompartmentalScenarios(const ModelFit &fit, const vector<Double_t> &Reductions, vector<vector<Double_t>> &Curves);
+
+// to define the minimizer used by a fitter
+void ConfigureMinimizer(ROOT::Fit::Fitter &fitter);
+
+// to fill the data to be fitted in a given range of bins
+void FillFitData(const Series &series, Int_t XMin, Int_t XMax, ROOT::Fit::BinData &data);
+
+// to fit a model without any graphics (thread safe), optionally starting from the parameters of a previous fit,
+// and computing the confidence band on all the histogram bins (the fit and band times are added to timing if given)
+Bool_t FitModel(Int_t Model, const Series &series, Int_t XMin, Int_t XMax, ModelFit &fit, const ModelFit *start=nullptr, Bool_t ComputeBand=false, Timing *timing=nullptr);
+
+// same, the full or simple version of the model being given instead of fDoFullModel (used when each analysis has its own options)
+Bool_t FitModel(Int_t Model, Bool_t FullModel, const Series &series, Int_t XMin, Int_t XMax, ModelFit &fit, const ModelFit *start=nullptr, Bool_t ComputeBand=false, Timing *timing=nullptr);
+
+// to scan the fit parameters as a function of the smoothing and of the fit range, for one or several countries
+void Scan(TString theCountry, vector<Int_t> Smoothings, vector<TString> FitFrom={}, vector<TString> FitTo={}, Int_t NThreads=0);
+void Scan(vector<TString> Countries, vector<Int_t> Smoothings, vector<TString> FitFrom={}, vector<TString> FitTo={}, Int_t NThreads=0);
+
+// to start the timing of a stage, and to add the time spent since the start to a stage
+StageClock StartStage();
+void StopStage(Timing &timing, Int_t Stage, const StageClock &start);
+
+// to print the timing and the fitter counters of an analysis, and their aggregate over a batch
+void PrintTiming(const AnalysisResult &result);
+void PrintTimingSummary(const vector<AnalysisResult> &Results, Double_t RealTime);
+
+// to append the timing of each analysis in a file (JSON lines), and the aggregate over the batch
+void SetTimingFile(TString FileName="Timings/covid19_daily_timing.jsonl");
+void WriteTimings(const vector<AnalysisResult> &Results, TString FileName);
+
+// to save the analysis state (data, fits, covariances and bands) of each analysis or batch in a ROOT file
+void SetStateFile(TString FileName="States/covid19_daily_state.root");
+
+// to write the analysis state of a list of results in a ROOT file, and to read it back (the cases, their fits and their
+// lag being stored as a second entry of the country)
+bool SaveState(const vector<AnalysisResult> &Results, TString FileName);
+bool LoadState(TString FileName, vector<AnalysisResult> &Results);
+
+// to plot again the results saved in a state file (all the countries if none is given), without reading the data nor fitting
+void Replot(TString FileName, vector<TString> Countries={}, Int_t NRenderWorkers=0);
+
+// to write a vector of values as a JSON array
+TString ToJSON(const vector<Double_t> &values);
+
+// to create the export files (Format: any of csv, json, root), to append the result of a country, and to close the files
+bool OpenExporter(Exporter &exporter, TString FileName, TString Format);
+void WriteResult(Exporter &exporter, const AnalysisResult &result);
+void CloseExporter(Exporter &exporter);
+
+// to sample the data and a fitted curve of a result on each day of the axis range (from DateMin), and to write a result as one JSON object
+void SampleResult(const AnalysisResult &result, Int_t &DateMin, vector<TString> &Dates, vector<Double_t> &Data, vector<Double_t> &Data_error);
+void SampleCurve(const vector<Double_t> &band, Int_t DateMin, Int_t NDays, vector<Double_t> &curve);
+void WriteResultJSON(ostream &json, const AnalysisResult &result);
+
+// to export the results of a batch of countries, without any graphics (returns the number of exported countries)
+void ExportResults(const vector<AnalysisResult> &Results, TString FileName="Exports/covid19_daily", TString Format="csv,json,root");
+Int_t Export(vector<TString> Countries, TString FileName="Exports/covid19_daily", TString Format="csv,json,root", Int_t NThreads=0);
+
+// to convert an analysis result in a binary buffer, and back
+void SerializeResult(const AnalysisResult &result, string &buffer);
+bool DeserializeResult(const string &buffer, AnalysisResult &result);
+
+// to write and read a full buffer in a pipe, returns false if the pipe is closed
+bool WriteAll(int fd, const char *data, size_t size);
+bool ReadAll(int fd, char *data, size_t size);
+
+// to start the render workers (0: half of the cores), to queue a result to be plotted, and to wait for all the plots
+bool StartRenderQueue(RenderQueue &queue, Int_t NWorkers=0);
+void QueueRender(RenderQueue &queue, const AnalysisResult &result);
+void StopRenderQueue(RenderQueue &queue);
+
+// main loop of a render worker process
+void RenderWorker(Int_t iworker, int input, int ready);
+
+// to analyse a list of countries, the fits running on NThreads threads while the plots are done by NRenderWorkers processes
+// (returns the number of analysed countries)
+Int_t Analyse(vector<TString> Countries, Int_t NThreads=0, Int_t NRenderWorkers=0);
+
+// to analyse all the regions of a wide file (ex: the South African provinces) and its national total in one run:
+// the fits are done concurrently on NThreads threads, on the fit range of the national total, and the sum of the
+// regional fits is compared with the national fit and data (the comparison is printed, and plotted if not headless)
+// (returns the number of models with inconsistent regional fits, -1 if the data are not available)
+Int_t AnalyseRegions(TString WideFile="South_Africa_and-Provinces_Deaths", Int_t NThreads=0);
+
+// to change fRegionTolerance
+void SetRegionTolerance(Double_t Tolerance=0.1);
+
+// same as AnalyseRegions without any printout nor graphics, returns false if the file or its national column are not available
+Bool_t AnalyseRegionsData(TString WideFile, RegionalResult &result, Int_t NThreads=0);
+
+// to compare the sum of the regional fits with the national fit and data, to print the comparison, and to plot it
+void CheckRegions(RegionalResult &result);
+void PrintRegions(const RegionalResult &result);
+void DrawRegions(const RegionalResult &result);
+
+// to get the names of the time scale parameters of a model (R0 for the compartmental models, the same names for the full and
+// simple variants), shared by default in a joint fit
+vector<TString> GetTimeScales(Int_t Model);
+
+// to fit jointly a model on the series of joint.Results (already smoothed) on the range joint.XMin-XMax, the parameters
+// of Shared (comma separated names, "": the time scales) being common to all the series (Pooling=0), or pooled around a
+// common value with a relative spread Pooling, and computing the confidence band of each series (thread safe, no graphics)
+Bool_t FitJoint(JointResult &joint, Int_t Model, Bool_t FullModel, TString Shared="", Double_t Pooling=0., Bool_t ComputeBand=true);
+
+// to read, smooth and fit jointly a list of countries, or of columns of a wide file ("File:Column", shell patterns being
+// expanded), on the fit range of the first one, returns false if less than two series are available
+Bool_t AnalyseJointData(vector<TString> Countries, Int_t Model, TString Shared, Double_t Pooling, JointResult &joint);
+
+// same, the joint fit being printed, and plotted if not headless (returns false if the fit is not valid)
+Bool_t AnalyseJoint(vector<TString> Countries, Int_t Model=kModelD2, TString Shared="", Double_t Pooling=0.);
+
+// to print and to plot a joint fit
+void PrintJoint(const JointResult &joint);
+void DrawJoint(const JointResult &joint);
 
 // Fit Functions definition
 Double_t FuncD(Double_t*xx,Double_t*pp);
@@ -114,13 +863,4 @@ Double_t FuncESIR(Double_t*xx,Double_t*pp);
 Double_t FuncESIR2(Double_t*xx,Double_t*pp);
 Double_t FuncESIR2Full(Double_t*xx,Double_t*pp);
 
-////////////////////////////
-/// Printouts coloration ///
-////////////////////////////
-
-#define ERR_MESS  std::cout<<"\e[0;3;91m -- ERROR   : "
-#define WARN_MESS std::cout<<"\e[0;3;93m -- WARNNING: "
-#define INFO_MESS std::cout<<"\e[0;3;92m -- INFO    : \e[0;3;94m"
-#define TITLE_MESS std::cout<<" \e[0;4;92m"
-#define END_MESS  "\e[0;3m"
-#define ENDL END_MESS<<std::endl
+#endif
@@ -1,3 +1,8 @@
+#ifndef COVID19_TOTAL_H
+#define COVID19_TOTAL_H
+
+#include "covid19_common.h"
+
 #include "Riostream.h"
 #include "TGraph.h"
 #include "TObjArray.h"
@@ -24,6 +29,7 @@
 #include "HFitInterface.h"
 #include "TRandom3.h"
 #include "TSystem.h"
+#include "TROOT.h"
 
 using namespace  std;
 
@@ -31,89 +37,52 @@ using namespace  std;
 /// Global parameters definition ///
 ////////////////////////////////////
 
-// number of average days in the sliding window
-Int_t fNSmoothing = 7;
+// the smoothing, the ranges of dates and the headless mode are shared with the daily analysis (covid19_common.h)
 
 // Models parameters
-Bool_t fDoFullModel = true;
-Bool_t fDoD = false;
-Bool_t fDoD2 = true;
-Bool_t fUseOffset = false;
-
-// Range of dates to be read from the input files
-TString fReadDataFrom = "";
-TString fReadDataTo = "";
-
-// Range of dates for the X axis of the histogram
-TString fAxisRangeFrom = "";
-TString fAxisRangeTo = "";
-
-// Range of dates for the fit
-TString fFitRangeFrom = "";
-TString fFitRangeTo = "";
+extern Bool_t fDoFullModel;
+extern Bool_t fDoD;
+extern Bool_t fDoD2;
+extern Bool_t fUseOffset;
 
 ///////////////////////////////////
 /// Global variables definition ///
 ///////////////////////////////////
 
 // dummy histogram to make some tests on the defined dates
-TH1D *hDummyHist = nullptr;
-TH1D *hTotal_Deaths = nullptr;
+extern TH1D *hDummyHist;
+extern TH1D *hTotal_Deaths;
 
 // declaration of global variables used in the code for D, D2, ESIR, ESIR2
-Int_t fColors[4] = {kMagenta,kGreen,kBlue,kRed};
-
-// Minimal number of deaths to start to be taken into acount
-Int_t DeathsMin = 10;
+extern Int_t fColors[4];
 
 // vectors containing the data
-vector<TString> vDates;
-vector<Double_t> vTotal_Deaths;
-vector<Double_t> vTotal_Deaths_error;
+extern vector<TString> vDates;
+extern vector<Double_t> vTotal_Deaths;
+extern vector<Double_t> vTotal_Deaths_error;
 
 ////////////////////////////
 /// Functions definition ///
 ////////////////////////////
 
+// Main fonction that plots the data and process the fits
+void Analyse(TString theCountry);
+
 // to print all the parameters in the terminal
 void PrintParameters(TString country_name);
 
 // to define the models we want to fit
 void SetModels(Bool_t DoD=false, Bool_t DoD2=true, Bool_t FullModel=true, Bool_t UseOffset=false);
 
-// to change fNSmoothing
-void SetSmoothing(Int_t Ndays=7);
-
-// to change the range of dates to be read
-void ReadDataRange(TString DateFrom="",TString DateTo="");
-
-// to change axis range
-void SetAxisRange(TString DateFrom="",TString DateTo="");
-
-// to change the fit range
-void SetFitRange(TString DateFrom="",TString DateTo="");
-
 // Init histograms
 void InitHistograms();
 
-// Fonction used to read the data files
+// Fonction used to read the data files in the global vectors
 bool ReadData(TString filename);
 
-// fonction to smooth the data on N sucessive days
-void SmoothVector(Int_t N, vector<double> &data, vector<double> &data_err);
-
 // Fit Functions definition
 Double_t FuncD(Double_t*xx,Double_t*pp);
 Double_t FuncD2(Double_t*xx,Double_t*pp);
 Double_t FuncD2Full(Double_t*xx,Double_t*pp);
 
-////////////////////////////
-/// Printouts coloration ///
-////////////////////////////
-
-#define ERR_MESS  std::cout<<"\e[0;3;91m -- ERROR   : "
-#define WARN_MESS std::cout<<"\e[0;3;93m -- WARNNING: "
-#define INFO_MESS std::cout<<"\e[0;3;92m -- INFO    : \e[0;3;94m"
-#define TITLE_MESS std::cout<<" \e[0;4;92m"
-#define END_MESS  "\e[0;3m"
-#define ENDL END_MESS<<std::endl
+#endif
@@ -0,0 +1,416 @@
+#include "covid19_daily.h"
+
+#include "TError.h"
+
+///****************************************************************************************************************
+///                                  Command line interface of the daily analysis
+///****************************************************************************************************************
+/// covid19_analyse [options] Country1 [Country2 ...]
+///             => a country is the name of a csv file of the data folder, without the extension, the file being possibly
+///                compressed (Country.csv.gz or Country.csv.zst)
+///             => '-' reads the data of one country on the standard input (possibly gzip compressed): zcat archive.csv.gz | covid19_analyse -
+///             => shell patterns are expanded on the data folder: covid19_analyse --jobs 8 'South*' 'B*'
+///             => all the options of the ROOT macro are available, see PrintUsage
+///             => --regions: the names are wide files (one column per region), all their regions and their total being fitted
+///                together and compared: covid19_analyse --regions South_Africa_and-Provinces_Deaths
+///             => --cases: the confirmed cases, read in the same parse as the deaths, are fitted as well, and the lag between
+///                the cases and the deaths is estimated
+///             => --rt: the effective reproduction number is estimated with the renewal equation, and exported with its
+///                credible interval for each country (--export with csv and/or json)
+///             => --joint: all the names are fitted jointly, the time scales (or the --shared parameters) being common to all
+///                the series: covid19_analyse --joint --models D2 'South_Africa_and-Provinces_Deaths:[A-Z]*'
+///
+/// Exit codes:
+///             0: all the countries have been analysed
+///             1: some countries have been skipped (no data), some regional fits are inconsistent with the national one,
+///                or some joint fits are not valid
+///             2: error in the command line
+///             3: no country has been analysed
+///****************************************************************************************************************
+
+enum EExitCodes {kExitOk = 0, kExitPartial = 1, kExitUsage = 2, kExitNoData = 3};
+
+// to print the command line options
+void PrintUsage(const char *Program)
+{
+    cout << "Usage: " << Program << " [options] Country1 [Country2 ...]" << endl;
+    cout << "       " << Program << " [options] -        (data read on the standard input, possibly gzip compressed)" << endl;
+    cout << endl;
+    cout << "  --models LIST          models to fit, among D,D2,ESIR,ESIR2,SIR,SEIRD (default: D2,ESIR2)" << endl;
+    cout << "  --simple-models        fit the simple models instead of the full ones" << endl;
+    cout << "  --periods INC,INF,RED  incubation, infectious and transmission reduction periods of SIR,SEIRD, in days (default: 5.2,7,7)" << endl;
+    cout << "  --ode-tolerance X      relative tolerance of the integration of SIR,SEIRD (default: 1e-6)" << endl;
+    cout << "  --smoothing N          number of days of the sliding window (default: 7)" << endl;
+    cout << "  --read-from DATE       first date to be read, ex: 1-Aug-20 (default: all)" << endl;
+    cout << "  --read-to DATE         last date to be read (default: all)" << endl;
+    cout << "  --axis-from DATE       first date of the histogram axis (default: adapted to the data)" << endl;
+    cout << "  --axis-to DATE         last date of the histogram axis" << endl;
+    cout << "  --fit-from DATE        first date of the fit (default: adapted to the axis range or to the waves)" << endl;
+    cout << "  --fit-to DATE          last date of the fit" << endl;
+    cout << "  --deaths-min N         minimal number of deaths to start to take the data into account (default: 10)" << endl;
+    cout << "  --no-waves             no waves detection" << endl;
+    cout << "  --anomalies MODE       correction of the reporting anomalies: keep, exclude or redistribute (default: keep)" << endl;
+    cout << "  --anomaly-window N     number of days of the median and MAD of the anomalies search (default: 21)" << endl;
+    cout << "  --anomaly-threshold X  robust score above which a day is a spike (default: 6)" << endl;
+    cout << "  --weekly               remove the weekly reporting cycle (weekday factors) before a centred smoothing" << endl;
+    cout << "  --data-dir DIR         folder of the data files (default: ./worldometers/)" << endl;
+    cout << "  --jobs N               number of fitting threads, 0: all the cores (default: 0)" << endl;
+    cout << "  --render-workers N     number of plotting processes, 0: half of the cores (default: 0)" << endl;
+    cout << "  --no-plots             only fit, no picture is produced" << endl;
+    cout << "  --cases                fit the confirmed cases as well, and estimate their lag with the deaths" << endl;
+    cout << "  --max-lag N            maximal lag between the cases and the deaths, in days (default: 60)" << endl;
+    cout << "  --rt                   estimate the effective reproduction number Rt with the renewal equation" << endl;
+    cout << "  --generation MEAN,SD   gamma generation interval, in days (default: 6.5,4)" << endl;
+    cout << "  --generation-weights L daily weights of the generation interval (day 1, day 2, ...), instead of the gamma" << endl;
+    cout << "  --rt-window N          number of days on which Rt is assumed constant (default: 7)" << endl;
+    cout << "  --rt-delay N           delay between the infections and the data, in days (default: 0)" << endl;
+    cout << "  --rt-from-infections   estimate Rt on the deconvolved infections instead of the delayed data (with --infections)" << endl;
+    cout << "  --infections           deconvolve the data and the fits back to the infections with the infection-to-death delay" << endl;
+    cout << "  --delay MEAN,SD        gamma infection-to-death delay, in days (default: 23,10)" << endl;
+    cout << "  --delay-weights L      daily weights of the infection-to-death delay (day 0, day 1, ...), instead of the gamma" << endl;
+    cout << "  --deconvolution M      deconvolution method, rl (Richardson-Lucy) or tikhonov (default: rl)" << endl;
+    cout << "  --regularisation X     number of Richardson-Lucy iterations, or Tikhonov lambda (default: 50, or 0.01)" << endl;
+    cout << "  --forecast N           project the fits over N days after the last data, with the peak and the final toll" << endl;
+    cout << "  --final-days N         days after the last data at which the final toll is taken (default: 365)" << endl;
+    cout << "  --regions              the names are wide files: all their regions and their total are fitted and compared" << endl;
+    cout << "  --region-tolerance X   maximal relative difference between the sum of the regions and the total (default: 0.1)" << endl;
+    cout << "  --joint                all the countries (or regions, File:Column) are fitted jointly, with shared time scales" << endl;
+    cout << "  --shared LIST          parameters shared by the joint fit, ex: b1,b2 (default: the time scales of the model)" << endl;
+    cout << "  --pooling X            relative spread of the shared parameters around their common value, 0: fully shared (default: 0)" << endl;
+    cout << "  --export FILE          export the results in FILE.* instead of plotting them" << endl;
+    cout << "  --format LIST          export formats, among csv,json,root (default: csv,json,root)" << endl;
+    cout << "  --state FILE           save the analysis state in the ROOT file FILE" << endl;
+    cout << "  --timing FILE          append the timing of each country and of the batch in FILE (JSON lines)" << endl;
+    cout << "  -h, --help             print this message" << endl;
+    cout << endl;
+    cout << "Exit codes: 0 all analysed, 1 some countries skipped, inconsistent regions or invalid joint fits, 2 command line error, 3 nothing analysed" << endl;
+}
+
+// to read an integer option, returns false if the value is not a number
+Bool_t GetIntOption(TString Option, TString Value, Int_t &Result)
+{
+    if(!Value.IsDigit()) {
+        ERR_MESS << Option << " needs a positive integer, got '" << Value << "'" << ENDL;
+        return false;
+    }
+    Result = Value.Atoi();
+    return true;
+}
+
+// to read a date option, returns false if the date is not in the histogram range
+Bool_t GetDateOption(TString Option, TString Value, TString &Result)
+{
+    if(GetDateBin(Value) == -1) {
+        ERR_MESS << Option << " needs a date between 1-Jan-20 and 31-Dec-21, got '" << Value << "'" << ENDL;
+        return false;
+    }
+    Result = Value;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    // minimal ROOT initialisation: no application, no graphics window, only the warnings and errors are printed
+    gROOT->SetBatch(true);
+    gErrorIgnoreLevel = kWarning;
+
+    Int_t NThreads = 0;
+    Int_t NRenderWorkers = 0;
+    Bool_t DoPlots = true;
+    Bool_t DoRegions = false;
+    Double_t RegionTolerance = fRegionTolerance;
+    Bool_t DoJoint = false;
+    Bool_t DoCases = false;
+    Int_t MaxLag = fMaxLag;
+    Bool_t DoRt = false;
+    Double_t GenerationMean = fRtGenerationMean, GenerationSD = fRtGenerationSD;
+    vector<Double_t> GenerationWeights;
+    Int_t RtWindow = fRtWindow, RtDelay = fRtDelay;
+    Bool_t RtFromInfections = false;
+    Bool_t DoInfections = false;
+    Double_t DelayMean = fDelayMean, DelaySD = fDelaySD;
+    vector<Double_t> DelayWeights;
+    Int_t DeconvolutionMethod = kRichardsonLucy;
+    Double_t Regularisation = -1.;
+    Int_t ForecastDays = 0;
+    Int_t ForecastFinalDays = fForecastFinalDays;
+    TString Shared = "";
+    Double_t Pooling = 0.;
+    TString ExportFile = "";
+    TString ExportFormat = "csv,json,root";
+    TString StateFile = "";
+    TString TimingFile = "";
+
+    Bool_t DoModels[kNModels] = {false,true,false,true};
+    Bool_t FullModel = true;
+    Double_t IncubationDays = fIncubationDays, InfectiousDays = fInfectiousDays, ReductionDays = fReductionDays;
+    Double_t ODETolerance = fODETolerance;
+    Int_t NSmoothing = fNSmoothing;
+    TString ReadFrom = "", ReadTo = "", AxisFrom = "", AxisTo = "", FitFrom = "", FitTo = "";
+    Bool_t DoWaves = fDoWaveDetection;
+    Bool_t DoWeekly = false;
+    Int_t AnomalyMode = fAnomalyMode, AnomalyWindow = fAnomalyWindow;
+    Double_t AnomalyThreshold = fAnomalyThreshold;
+
+    vector<TString> Patterns;
+
+    for(int iarg=1 ; iarg<argc ; iarg++) {
+        TString Option = argv[iarg];
+
+        if(Option == "-h" || Option == "--help") {
+            PrintUsage(argv[0]);
+            return kExitOk;
+        }
+        if(!Option.BeginsWith("--")) {
+            Patterns.push_back(Option);
+            continue;
+        }
+
+        // the value can be given as --option=value or as --option value
+        TString Value = "";
+        Bool_t HasValue = false;
+        if(Option.Contains("=")) {
+            Value = Option(Option.Index("=")+1,Option.Length());
+            Option = Option(0,Option.Index("="));
+            HasValue = true;
+        }
+
+        if(Option == "--simple-models") FullModel = false;
+        else if(Option == "--no-waves") DoWaves = false;
+        else if(Option == "--weekly") DoWeekly = true;
+        else if(Option == "--no-plots") DoPlots = false;
+        else if(Option == "--regions") DoRegions = true;
+        else if(Option == "--joint") DoJoint = true;
+        else if(Option == "--cases") DoCases = true;
+        else if(Option == "--rt") DoRt = true;
+        else if(Option == "--rt-from-infections") RtFromInfections = true;
+        else if(Option == "--infections") DoInfections = true;
+        else {
+            if(!HasValue) {
+                if(iarg+1 >= argc) {
+                    ERR_MESS << Option << " needs a value" << ENDL;
+                    return kExitUsage;
+                }
+                Value = argv[++iarg];
+            }
+
+            Bool_t Ok = true;
+            if(Option == "--models") {
+                for(int imodel=0 ; imodel<kNModels ; imodel++) DoModels[imodel] = false;
+                TObjArray *arr = Value.Tokenize(",");
+                for(int i=0 ; i<arr->GetEntries() ; i++) {
+                    TString Model = arr->At(i)->GetName();
+                    Model.ToUpper();
+                    if(Model == "D") DoModels[kModelD] = true;
+                    else if(Model == "D2") DoModels[kModelD2] = true;
+                    else if(Model == "ESIR") DoModels[kModelESIR] = true;
+                    else if(Model == "ESIR2") DoModels[kModelESIR2] = true;
+                    else if(Model == "SIR") DoModels[kModelSIR] = true;
+                    else if(Model == "SEIRD") DoModels[kModelSEIRD] = true;
+                    else {
+                        ERR_MESS << "Unknown model '" << Model << "', the models are D,D2,ESIR,ESIR2,SIR,SEIRD" << ENDL;
+                        Ok = false;
+                    }
+                }
+                delete arr;
+            }
+            else if(Option == "--smoothing") Ok = GetIntOption(Option,Value,NSmoothing);
+            else if(Option == "--read-from") Ok = GetDateOption(Option,Value,ReadFrom);
+            else if(Option == "--read-to") Ok = GetDateOption(Option,Value,ReadTo);
+            else if(Option == "--axis-from") Ok = GetDateOption(Option,Value,AxisFrom);
+            else if(Option == "--axis-to") Ok = GetDateOption(Option,Value,AxisTo);
+            else if(Option == "--fit-from") Ok = GetDateOption(Option,Value,FitFrom);
+            else if(Option == "--fit-to") Ok = GetDateOption(Option,Value,FitTo);
+            else if(Option == "--deaths-min") Ok = GetIntOption(Option,Value,DeathsMin);
+            else if(Option == "--jobs") Ok = GetIntOption(Option,Value,NThreads);
+            else if(Option == "--render-workers") Ok = GetIntOption(Option,Value,NRenderWorkers);
+            else if(Option == "--max-lag") Ok = GetIntOption(Option,Value,MaxLag);
+            else if(Option == "--forecast") {
+                Ok = GetIntOption(Option,Value,ForecastDays) && ForecastDays>0;
+                if(Ok == false && ForecastDays == 0) ERR_MESS << Option << " needs at least one day" << ENDL;
+            }
+            else if(Option == "--final-days") {
+                Ok = GetIntOption(Option,Value,ForecastFinalDays) && ForecastFinalDays>0;
+                if(Ok == false && ForecastFinalDays == 0) ERR_MESS << Option << " needs at least one day" << ENDL;
+            }
+            else if(Option == "--rt-window") {
+                Ok = GetIntOption(Option,Value,RtWindow) && RtWindow>0;
+                if(Ok == false && RtWindow == 0) ERR_MESS << Option << " needs at least one day" << ENDL;
+            }
+            else if(Option == "--rt-delay") Ok = GetIntOption(Option,Value,RtDelay);
+            else if(Option == "--generation" || Option == "--generation-weights" || Option == "--delay" || Option == "--delay-weights") {
+                vector<Double_t> Values;
+                TObjArray *arr = Value.Tokenize(",");
+                for(int i=0 ; i<arr->GetEntries() ; i++) {
+                    TString Number = arr->At(i)->GetName();
+                    if(!Number.IsFloat() || Number.Atof()<0) Ok = false;
+                    Values.push_back(Number.Atof());
+                }
+                delete arr;
+                Bool_t Generation = Option.BeginsWith("--generation");
+                if(!Option.EndsWith("-weights")) {
+                    Ok = Ok && Values.size()==2 && Values.at(0)>0 && Values.at(1)>0;
+                    if(Ok) {
+                        (Generation ? GenerationMean : DelayMean) = Values.at(0);
+                        (Generation ? GenerationSD : DelaySD) = Values.at(1);
+                    }
+                    else ERR_MESS << Option << " needs two positive numbers MEAN,SD, got '" << Value << "'" << ENDL;
+                }
+                else {
+                    Ok = Ok && !Values.empty();
+                    if(Ok) (Generation ? GenerationWeights : DelayWeights) = Values;
+                    else ERR_MESS << Option << " needs a list of positive numbers, got '" << Value << "'" << ENDL;
+                }
+            }
+            else if(Option == "--periods") {
+                vector<Double_t> Values;
+                TObjArray *arr = Value.Tokenize(",");
+                for(int i=0 ; i<arr->GetEntries() ; i++) {
+                    TString Number = arr->At(i)->GetName();
+                    if(!Number.IsFloat() || Number.Atof()<=0) Ok = false;
+                    Values.push_back(Number.Atof());
+                }
+                delete arr;
+                Ok = Ok && Values.size()==3;
+                if(Ok) {
+                    IncubationDays = Values.at(0);
+                    InfectiousDays = Values.at(1);
+                    ReductionDays = Values.at(2);
+                }
+                else ERR_MESS << Option << " needs three positive numbers INCUBATION,INFECTIOUS,REDUCTION, got '" << Value << "'" << ENDL;
+            }
+            else if(Option == "--ode-tolerance") {
+                ODETolerance = Value.Atof();
+                Ok = Value.IsFloat() && ODETolerance>0 && ODETolerance<1e-2;
+                if(!Ok) ERR_MESS << Option << " needs a number between 0 and 0.01, got '" << Value << "'" << ENDL;
+            }
+            else if(Option == "--anomalies") {
+                Value.ToLower();
+                if(Value == "keep") AnomalyMode = kAnomalyKeep;
+                else if(Value == "exclude") AnomalyMode = kAnomalyExclude;
+                else if(Value == "redistribute") AnomalyMode = kAnomalyRedistribute;
+                else {
+                    ERR_MESS << "Unknown anomalies correction '" << Value << "', the corrections are keep,exclude,redistribute" << ENDL;
+                    Ok = false;
+                }
+            }
+            else if(Option == "--anomaly-window") {
+                Ok = GetIntOption(Option,Value,AnomalyWindow) && AnomalyWindow>=5;
+                if(Ok == false && AnomalyWindow<5) ERR_MESS << Option << " needs at least 5 days" << ENDL;
+            }
+            else if(Option == "--anomaly-threshold") {
+                AnomalyThreshold = Value.Atof();
+                Ok = Value.IsFloat() && AnomalyThreshold>0;
+                if(!Ok) ERR_MESS << Option << " needs a positive number, got '" << Value << "'" << ENDL;
+            }
+            else if(Option == "--deconvolution") {
+                Value.ToLower();
+                if(Value == "rl" || Value == "richardson-lucy") DeconvolutionMethod = kRichardsonLucy;
+                else if(Value == "tikhonov") DeconvolutionMethod = kTikhonov;
+                else {
+                    ERR_MESS << "Unknown deconvolution method '" << Value << "', the methods are rl,tikhonov" << ENDL;
+                    Ok = false;
+                }
+            }
+            else if(Option == "--regularisation") {
+                Regularisation = Value.Atof();
+                Ok = Value.IsFloat() && Regularisation>0;
+                if(!Ok) ERR_MESS << Option << " needs a positive number, got '" << Value << "'" << ENDL;
+            }
+            else if(Option == "--region-tolerance") {
+                RegionTolerance = Value.Atof();
+                Ok = Value.IsFloat() && RegionTolerance>0;
+                if(!Ok) ERR_MESS << Option << " needs a positive number, got '" << Value << "'" << ENDL;
+            }
+            else if(Option == "--pooling") {
+                Pooling = Value.Atof();
+                Ok = Value.IsFloat() && Pooling>=0;
+                if(!Ok) ERR_MESS << Option << " needs a positive number or 0, got '" << Value << "'" << ENDL;
+            }
+            else if(Option == "--shared") Shared = Value;
+            else if(Option == "--data-dir") fDataFolder = Value;
+            else if(Option == "--export") ExportFile = Value;
+            else if(Option == "--format") ExportFormat = Value;
+            else if(Option == "--state") StateFile = Value;
+            else if(Option == "--timing") TimingFile = Value;
+            else {
+                ERR_MESS << "Unknown option " << Option << ", see " << argv[0] << " --help" << ENDL;
+                Ok = false;
+            }
+            if(!Ok) return kExitUsage;
+        }
+    }
+
+    if(Patterns.empty()) {
+        ERR_MESS << "No country given" << ENDL;
+        PrintUsage(argv[0]);
+        return kExitUsage;
+    }
+
+    // the options are then set as with the ROOT macro
+    SetModels(DoModels[kModelD],DoModels[kModelD2],DoModels[kModelESIR],DoModels[kModelESIR2],FullModel,DoModels[kModelSIR],DoModels[kModelSEIRD]);
+    if(IncubationDays != fIncubationDays || InfectiousDays != fInfectiousDays || ReductionDays != fReductionDays || ODETolerance != fODETolerance)
+        SetCompartmental(IncubationDays,InfectiousDays,ReductionDays,ODETolerance);
+    SetSmoothing(NSmoothing);
+    ReadDataRange(ReadFrom,ReadTo);
+    SetAxisRange(AxisFrom,AxisTo);
+    SetFitRange(FitFrom,FitTo);
+    SetWaveDetection(DoWaves,fWaveMinProminence);
+    if(DoWeekly) SetWeeklyDecomposition(true,fWeeklyIterations);
+    if(AnomalyMode != fAnomalyMode || AnomalyWindow != fAnomalyWindow || AnomalyThreshold != fAnomalyThreshold) SetAnomalies(AnomalyMode,AnomalyWindow,AnomalyThreshold);
+    if(DoCases) SetCases(true,MaxLag);
+    if(DoInfections) {
+        if(!DelayWeights.empty()) fDelayWeights = DelayWeights;
+        SetDeconvolution(true,DelayMean,DelaySD,DeconvolutionMethod,Regularisation);
+    }
+    if(DoRt) {
+        if(!GenerationWeights.empty()) fRtGeneration = GenerationWeights;
+        SetRt(true,GenerationMean,GenerationSD,RtWindow,RtDelay,RtFromInfections);
+    }
+    if(ForecastDays>0) SetForecast(true,ForecastDays,ForecastFinalDays);
+    if(StateFile!="") SetStateFile(StateFile);
+    if(TimingFile!="") SetTimingFile(TimingFile);
+    if(!DoPlots || ExportFile!="") SetHeadless(true);
+
+    if(GetModels().empty()) {
+        ERR_MESS << "No model selected" << ENDL;
+        return kExitUsage;
+    }
+
+    // regional analysis: one run per wide file
+    if(DoRegions) {
+        fRegionTolerance = RegionTolerance;
+        Int_t NAnalysed = 0, NInconsistent = 0;
+        for(auto &pattern : Patterns) {
+            Int_t Result = AnalyseRegions(pattern,NThreads);
+            if(Result >= 0) NAnalysed++;
+            if(Result > 0) NInconsistent++;
+        }
+        if(NAnalysed == 0) return kExitNoData;
+        if(NAnalysed < (Int_t)Patterns.size() || NInconsistent) return kExitPartial;
+        return kExitOk;
+    }
+
+    // joint analysis: one joint fit of all the names per model
+    if(DoJoint) {
+        Int_t NValid = 0;
+        vector<Int_t> Models = GetModels();
+        for(auto model : Models) if(AnalyseJoint(Patterns,model,Shared,Pooling)) NValid++;
+        if(NValid == 0) return kExitNoData;
+        if(NValid < (Int_t)Models.size()) return kExitPartial;
+        return kExitOk;
+    }
+
+    vector<TString> Countries;
+    Bool_t AllFound = true;
+    for(auto &pattern : Patterns) AllFound &= ExpandCountry(pattern,Countries);
+
+    Int_t NAnalysed = 0;
+    if(ExportFile!="") NAnalysed = Export(Countries,ExportFile,ExportFormat,NThreads);
+    else NAnalysed = Analyse(Countries,NThreads,NRenderWorkers);
+
+    if(NAnalysed == 0) return kExitNoData;
+    if(!AllFound || NAnalysed < (Int_t)Countries.size()) return kExitPartial;
+
+    return kExitOk;
+}
@@ -0,0 +1,300 @@
+#include "covid19_daily.h"
+
+#include "TError.h"
+#include "TStopwatch.h"
+#include "TDatime.h"
+
+#include <zlib.h>
+
+///****************************************************************************************************************
+///                                  Benchmarks of the daily analysis
+///****************************************************************************************************************
+/// covid19_benchmark [--country NAME] [--data-dir DIR] [--output FILE] [--label TEXT] [--min-time SEC] [--jobs N] [--no-full-set]
+/// covid19_benchmark --memory-check N [--country NAME] [--data-dir DIR]
+///             => micro-benchmarks: ReadData, SmoothVector, the fit functions, one fit of each model and the confidence band
+///             => end-to-end benchmarks: analysis and plot of one country, analysis of all the countries of the data folder
+///             => one JSON object per benchmark and per line is appended to the output file (default: Benchmarks/covid19_benchmark.jsonl),
+///                the label (ex: the commit hash) being used to compare the results between commits
+///             => --memory-check: analyses and plots the country N times, and fails (exit code 1) if the resident memory grows
+///                by more than 0.25 kB per analysis (ctest: memory_check_daily)
+///****************************************************************************************************************
+
+// minimal time spent in each benchmark, the body being repeated up to this time
+Double_t fBenchMinTime = 0.5;
+
+// structure containing the result of one benchmark, the times being given per iteration
+struct Benchmark {
+    TString Name;
+    TString Unit;                           // what is counted in the items (rows, points, fits...)
+    Long64_t Iterations = 0;
+    Double_t RealTime = 0.;
+    Double_t CpuTime = 0.;
+    Double_t ItemsPerIteration = 0.;
+};
+
+// to repeat a benchmark body during at least fBenchMinTime seconds
+Benchmark RunBenchmark(TString Name, TString Unit, Double_t ItemsPerIteration, const function<void()> &Body)
+{
+    Benchmark bench;
+    bench.Name = Name;
+    bench.Unit = Unit;
+    bench.ItemsPerIteration = ItemsPerIteration;
+
+    // one first call, not measured, to fill the caches
+    Body();
+
+    TStopwatch watch;
+    watch.Start(true);
+    do {
+        watch.Continue();
+        Body();
+        watch.Stop();
+        bench.Iterations++;
+    }
+    while(watch.RealTime() < fBenchMinTime);
+
+    bench.RealTime = watch.RealTime()/bench.Iterations;
+    bench.CpuTime = watch.CpuTime()/bench.Iterations;
+
+    INFO_MESS << Form("%-24s %10.4g ms/iteration %12.4g %s/s  (%lld iterations)",Name.Data(),1e3*bench.RealTime,
+                      bench.ItemsPerIteration/bench.RealTime,Unit.Data(),bench.Iterations) << ENDL;
+
+    return bench;
+}
+
+// to check that repeated analyses and plots of a country run in constant memory, returns false if the memory grows
+Bool_t MemoryCheck(TString Country, Int_t NAnalyses)
+{
+    // the first analyses are not taken into account: canvas, histograms and ROOT internal caches are created there
+    const Int_t NWarmUp = 10;
+
+    AnalysisResult result;
+    for(int i=0 ; i<NWarmUp ; i++) {
+        if(AnalyseData(Country,result) == false) {
+            ERR_MESS << "No data for " << Country << " in " << fDataFolder << ENDL;
+            return false;
+        }
+        DrawResult(result);
+    }
+
+    Long_t Start = GetResidentMemory();
+    for(int i=0 ; i<NAnalyses ; i++) {
+        AnalyseData(Country,result);
+        DrawResult(result);
+    }
+    Long_t End = GetResidentMemory();
+
+    return CheckMemoryGrowth(Country,NAnalyses,Start,End);
+}
+
+// to write the benchmarks as JSON lines
+void WriteBenchmarks(const vector<Benchmark> &Benchmarks, TString FileName, TString Label, TString Country)
+{
+    gSystem->mkdir(gSystem->DirName(FileName),true);
+    ofstream file(FileName.Data(),ios::app);
+    if(!file) {
+        ERR_MESS << "Cannot write " << FileName << ENDL;
+        return;
+    }
+
+    TDatime Now;
+    for(auto &bench : Benchmarks) {
+        file << "{\"label\":\"" << Label << "\",\"date\":\"" << Now.AsSQLString() << "\",\"host\":\"" << gSystem->HostName() << "\"";
+        file << ",\"country\":\"" << Country << "\",\"smoothing\":" << fNSmoothing << ",\"full_model\":" << (fDoFullModel ? "true" : "false");
+        file << ",\"name\":\"" << bench.Name << "\",\"unit\":\"" << bench.Unit << "\",\"iterations\":" << bench.Iterations;
+        file << TString::Format(",\"real_time\":%.6g,\"cpu_time\":%.6g,\"items_per_second\":%.6g}",bench.RealTime,bench.CpuTime,
+                                bench.ItemsPerIteration/bench.RealTime) << endl;
+    }
+
+    INFO_MESS << Benchmarks.size() << " benchmarks written in " << FileName << ENDL;
+}
+
+int main(int argc, char **argv)
+{
+    gROOT->SetBatch(true);
+    gErrorIgnoreLevel = kWarning;
+
+    TString Country = "South_Africa";
+    TString OutputFile = "Benchmarks/covid19_benchmark.jsonl";
+    TString Label = "";
+    Int_t NThreads = 1;
+    Bool_t DoFullSet = true;
+    Int_t NMemoryCheck = 0;
+
+    for(int iarg=1 ; iarg<argc ; iarg++) {
+        TString Option = argv[iarg];
+        if(Option == "--no-full-set") DoFullSet = false;
+        else if(iarg+1<argc && Option == "--country") Country = argv[++iarg];
+        else if(iarg+1<argc && Option == "--data-dir") fDataFolder = argv[++iarg];
+        else if(iarg+1<argc && Option == "--output") OutputFile = argv[++iarg];
+        else if(iarg+1<argc && Option == "--label") Label = argv[++iarg];
+        else if(iarg+1<argc && Option == "--min-time") fBenchMinTime = atof(argv[++iarg]);
+        else if(iarg+1<argc && Option == "--jobs") NThreads = atoi(argv[++iarg]);
+        else if(iarg+1<argc && Option == "--memory-check") NMemoryCheck = atoi(argv[++iarg]);
+        else {
+            cout << "Usage: " << argv[0] << " [--country NAME] [--data-dir DIR] [--output FILE] [--label TEXT] [--min-time SEC] [--jobs N] [--no-full-set]" << endl;
+            cout << "       " << argv[0] << " --memory-check N [--country NAME] [--data-dir DIR]" << endl;
+            return (Option == "-h" || Option == "--help") ? 0 : 2;
+        }
+    }
+
+    // no printouts from the analysis, only the benchmarks results
+    SetHeadless(true);
+
+    if(NMemoryCheck>0) return MemoryCheck(Country,NMemoryCheck) ? 0 : 1;
+
+    vector<Benchmark> Benchmarks;
+
+    // reference data set
+    Series series;
+    if(LoadSeries(Country,series) == false) {
+        ERR_MESS << "No data for " << Country << " in " << fDataFolder << ENDL;
+        return 3;
+    }
+    SmoothSeries(series,fNSmoothing);
+    Int_t XMin, XMax;
+    GetFitRange(series,fFitRangeFrom,fFitRangeTo,XMin,XMax);
+
+    TITLE_MESS << "Micro-benchmarks on " << Country << " (" << series.Dates.size() << " days)" << ENDL;
+
+    // reading of the data file
+    TString FileName = GetDataFileName(Country);
+    vector<TString> Dates;
+    vector<Double_t> Total_Deaths;
+    Benchmarks.push_back(RunBenchmark("ReadData","rows",series.Dates.size(),[&]() {
+        ReadData(FileName,Dates,Total_Deaths);
+    }));
+
+    // reading of the same data compressed with gzip, to be compared with the plain file
+    if(!IsCompressed(FileName)) {
+        TString GzFileName = Form("%s/covid19_benchmark_%d.csv.gz",gSystem->TempDirectory(),gSystem->GetPid());
+        ifstream Plain(FileName,ios::binary);
+        string Content((istreambuf_iterator<char>(Plain)),istreambuf_iterator<char>());
+        gzFile Gz = gzopen(GzFileName.Data(),"wb");
+        Bool_t Written = false;
+        if(Gz) {
+            Written = (gzwrite(Gz,Content.data(),Content.size()) == (int)Content.size());
+            Written &= (gzclose(Gz) == Z_OK);
+        }
+        if(Written) {
+            Benchmarks.push_back(RunBenchmark("ReadData_gzip","rows",series.Dates.size(),[&]() {
+                ReadData(GzFileName,Dates,Total_Deaths);
+            }));
+        }
+        gSystem->Unlink(GzFileName);
+    }
+
+    // smoothing of the daily deaths
+    vector<Double_t> Data, Data_error;
+    Benchmarks.push_back(RunBenchmark("SmoothVector","points",series.Raw_Daily_Deaths.size(),[&]() {
+        Data = series.Raw_Daily_Deaths;
+        Data_error.clear();
+        SmoothVector(fNSmoothing,Data,Data_error);
+    }));
+
+    // evaluation of the fit functions on all the histogram bins, with their initial parameters
+    Int_t NBins = GetDateBin("31-Dec-21");
+    vector<Double_t> X(NBins);
+    for(int ibin=1 ; ibin<=NBins ; ibin++) X.at(ibin-1) = BinToX(ibin);
+
+    struct FuncBench { const char *Name; Int_t Model; Bool_t FullModel; Double_t (*Func)(Double_t*,Double_t*); };
+    FuncBench Funcs[] = {{"FuncD",kModelD,false,FuncD},{"FuncD2",kModelD2,false,FuncD2},{"FuncD2Full",kModelD2,true,FuncD2Full},
+                         {"FuncESIR",kModelESIR,false,FuncESIR},{"FuncESIR2",kModelESIR2,false,FuncESIR2},{"FuncESIR2Full",kModelESIR2,true,FuncESIR2Full}};
+    for(auto &func : Funcs) {
+        unique_ptr<TF1> model(InitModel(func.Model,func.FullModel,Form("bench_%s",func.Name),XMin,series));
+        if(model == nullptr) continue;
+        vector<Double_t> Pars(model->GetParameters(),model->GetParameters()+model->GetNpar());
+        Double_t Sum = 0.;
+        Benchmarks.push_back(RunBenchmark(func.Name,"points",NBins,[&]() {
+            for(int i=0 ; i<NBins ; i++) Sum += func.Func(&X.at(i),Pars.data());
+        }));
+        // the sum is used to avoid the evaluation to be optimised away
+        if(!isfinite(Sum)) WARN_MESS << func.Name << " is not finite on the histogram range" << ENDL;
+    }
+
+    // integration of the compartmental models with their sensitivities, for one parameter set and for a batch of sets
+    // advanced together (structure of arrays), the reduction of the transmission being spread between the sets
+    for(auto Model : {kModelSIR,kModelSEIRD}) {
+        unique_ptr<TF1> model(InitModel(Model,false,Form("bench_%s",fModelNames[Model]),XMin,series));
+        if(model == nullptr) continue;
+        for(int NSets : {1,64}) {
+            CompartmentalBatch batch;
+            batch.Model = Model;
+            batch.NSets = NSets;
+            batch.Sensitivities = true;
+            for(int ibin=1 ; ibin<=NBins ; ibin++) batch.Times.push_back(X.at(ibin-1)-XMin);
+            batch.Pars.resize(kNCompartmentalPars*NSets);
+            for(int ipar=0 ; ipar<kNCompartmentalPars ; ipar++) {
+                for(int k=0 ; k<NSets ; k++) batch.Pars.at(ipar*NSets+k) = (ipar == 2) ? 0.9*k/NSets : model->GetParameter(ipar);
+            }
+            Bool_t Ok = true;
+            Benchmarks.push_back(RunBenchmark(Form("Integrate_%s_%dsets",fModelNames[Model],NSets),"points",NBins*NSets,[&]() {
+                Ok &= IntegrateCompartmental(batch);
+            }));
+            if(!Ok) WARN_MESS << fModelNames[Model] << " integration of " << NSets << " sets failed" << ENDL;
+        }
+    }
+
+    // one fit of each model, with the current full model option, and the same fit with the confidence band
+    for(int Model=0 ; Model<kNModels ; Model++) {
+        ModelFit fit;
+        Benchmark FitBench = RunBenchmark(Form("Fit_%s",fModelNames[Model]),"fits",1,[&]() {
+            FitModel(Model,series,XMin,XMax,fit);
+        });
+        Benchmarks.push_back(FitBench);
+        if(!fit.Valid) WARN_MESS << fModelNames[Model] << " fit not valid (status " << fit.Status << ")" << ENDL;
+
+        Benchmark BandBench = RunBenchmark(Form("FitBand_%s",fModelNames[Model]),"fits",1,[&]() {
+            FitModel(Model,series,XMin,XMax,fit,nullptr,true);
+        });
+        Benchmarks.push_back(BandBench);
+
+        // cost of the confidence band alone, as the difference with the fit without band
+        Benchmark Band;
+        Band.Name = Form("Band_%s",fModelNames[Model]);
+        Band.Unit = "points";
+        Band.Iterations = BandBench.Iterations;
+        Band.RealTime = max(1e-9,BandBench.RealTime-FitBench.RealTime);
+        Band.CpuTime = max(1e-9,BandBench.CpuTime-FitBench.CpuTime);
+        Band.ItemsPerIteration = NBins;
+        INFO_MESS << Form("%-24s %10.4g ms/iteration %12.4g %s/s",Band.Name.Data(),1e3*Band.RealTime,
+                          Band.ItemsPerIteration/Band.RealTime,Band.Unit.Data()) << ENDL;
+        Benchmarks.push_back(Band);
+
+        // projection of the fit, computed, and then taken from the cache
+        Forecast forecast;
+        Benchmarks.push_back(RunBenchmark(Form("Forecast_%s",fModelNames[Model]),"forecasts",1,[&]() {
+            ComputeForecast(fit,series,fForecastDays,fForecastFinalDays,forecast);
+        }));
+        Benchmarks.push_back(RunBenchmark(Form("ForecastCached_%s",fModelNames[Model]),"forecasts",1,[&]() {
+            GetForecast(fit,series,forecast,fForecastDays,fForecastFinalDays);
+        }));
+    }
+
+    TITLE_MESS << "End-to-end benchmarks" << ENDL;
+
+    // full analysis of one country, without and with the plot
+    AnalysisResult result;
+    Benchmarks.push_back(RunBenchmark("AnalyseData","countries",1,[&]() {
+        AnalyseData(Country,result);
+    }));
+    Benchmarks.push_back(RunBenchmark("DrawResult","plots",1,[&]() {
+        DrawResult(result);
+    }));
+
+    // analysis of all the countries of the data folder, on NThreads threads
+    if(DoFullSet) {
+        vector<TString> Countries;
+        ExpandCountry("*",Countries);
+        vector<AnalysisResult> Results(Countries.size());
+        Benchmarks.push_back(RunBenchmark(Form("AnalyseAll_%dthreads",NThreads),"countries",Countries.size(),[&]() {
+            RunParallel(Countries.size(),NThreads,[&](Int_t icountry) {
+                AnalyseData(Countries.at(icountry),Results.at(icountry));
+            });
+        }));
+    }
+
+    WriteBenchmarks(Benchmarks,OutputFile,Label,Country);
+
+    return 0;
+}
@@ -0,0 +1,1205 @@
+#include "covid19_common.h"
+
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+#include <cerrno>
+#include <cstring>
+#include <time.h>
+
+#include <glob.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <set>
+#include <fnmatch.h>
+
+#include <zlib.h>
+#ifdef COVID19_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+////////////////////////////////////
+/// Global parameters definition ///
+////////////////////////////////////
+
+TString fDataFolder = "./worldometers/";
+
+Int_t fNSmoothing = 7;
+
+TString fReadDataFrom = "";
+TString fReadDataTo = "";
+
+TString fAxisRangeFrom = "";
+TString fAxisRangeTo = "";
+
+TString fFitRangeFrom = "";
+TString fFitRangeTo = "";
+
+Bool_t fHeadless = false;
+
+Int_t DeathsMin = 10;
+
+void SetDataFolder(TString Folder) {
+    fDataFolder = Folder;
+
+    INFO_MESS << "Data read from " << fDataFolder << ENDL;
+}
+
+void SetSmoothing(Int_t Ndays) {
+    fNSmoothing = Ndays;
+
+    INFO_MESS << "Smoothing set to " << fNSmoothing << "days" << ENDL;
+}
+
+void ReadDataRange(TString DateFrom,TString DateTo) {
+
+    if(DateFrom!="" && GetDateBin(DateFrom)==-1) {
+        WARN_MESS << DateFrom << "not found in the histogram date range, ignored" << ENDL;
+        DateFrom = "";
+    }
+    if(DateTo!="" && GetDateBin(DateTo)==-1) {
+        WARN_MESS << DateTo << "not found in the histogram date range, ignored" << ENDL;
+        DateTo = "";
+    }
+
+    fReadDataFrom = DateFrom;
+    fReadDataTo = DateTo;
+
+    if(fReadDataFrom=="" && fReadDataTo=="") INFO_MESS << "Read all the available data" << ENDL;
+    else if(fReadDataFrom=="") INFO_MESS << "Read all data up to " << fReadDataTo << ENDL;
+    else if(fReadDataTo=="") INFO_MESS << "Read all data from " << fReadDataFrom << ENDL;
+    else INFO_MESS << "Read data from " << fReadDataFrom << " to " << fReadDataTo << ENDL;
+}
+
+void SetAxisRange(TString DateFrom,TString DateTo) {
+
+    if(DateFrom!="" && GetDateBin(DateFrom)==-1) {
+        WARN_MESS << DateFrom << "not found in the histogram date range, ignored" << ENDL;
+        DateFrom = "";
+    }
+    if(DateTo!="" && GetDateBin(DateTo)==-1) {
+        WARN_MESS << DateTo << "not found in the histogram date range, ignored" << ENDL;
+        DateTo = "";
+    }
+
+    fAxisRangeFrom = DateFrom;
+    fAxisRangeTo = DateTo;
+
+    if(fAxisRangeFrom=="" && fAxisRangeTo=="") INFO_MESS << "Axis range adapted to the data" << ENDL;
+    else if(fAxisRangeFrom=="") INFO_MESS << "Axis range up to " << fAxisRangeTo << ENDL;
+    else if(fAxisRangeTo=="") INFO_MESS << "Axis range up from " << fAxisRangeFrom << ENDL;
+    else INFO_MESS << "Axis range from " << fAxisRangeFrom << " to " << fAxisRangeTo << ENDL;
+}
+
+void SetFitRange(TString DateFrom,TString DateTo) {
+
+    if(DateFrom!="" && GetDateBin(DateFrom)==-1) {
+        WARN_MESS << DateFrom << "not found in the histogram date range, ignored" << ENDL;
+        DateFrom = "";
+    }
+    if(DateTo!="" && GetDateBin(DateTo)==-1) {
+        WARN_MESS << DateTo << "not found in the histogram date range, ignored" << ENDL;
+        DateTo = "";
+    }
+
+    fFitRangeFrom = DateFrom;
+    fFitRangeTo = DateTo;
+
+    if(fFitRangeFrom=="" && fFitRangeTo=="") INFO_MESS << "Fit range adapted to axis range" << ENDL;
+    else if(fFitRangeFrom=="") INFO_MESS << "Fit range up to " << fFitRangeTo << ENDL;
+    else if(fFitRangeTo=="") INFO_MESS << "Fit range up from " << fFitRangeFrom << ENDL;
+    else INFO_MESS << "Fit range from " << fFitRangeFrom << " to " << fFitRangeTo << ENDL;
+}
+
+void SetHeadless(Bool_t Headless) {
+    fHeadless = Headless;
+
+    // no graphics window is opened in headless mode, even if a plot is requested
+    gROOT->SetBatch(fHeadless);
+
+    if(fHeadless) INFO_MESS << "Headless mode activated: no prompt, no printouts and no graphics" << ENDL;
+    else INFO_MESS << "Headless mode deactivated" << ENDL;
+}
+
+void PrintRanges() {
+
+    INFO_MESS << "Smoothing set to " << fNSmoothing << "days" << ENDL;
+
+    if(fReadDataFrom=="" && fReadDataTo=="") INFO_MESS << "Read all the available data" << ENDL;
+    else if(fReadDataFrom=="") INFO_MESS << "Read all data up to " << fReadDataTo << ENDL;
+    else if(fReadDataTo=="") INFO_MESS << "Read all data from " << fReadDataFrom << ENDL;
+    else INFO_MESS << "Read data from " << fReadDataFrom << " to " << fReadDataTo << ENDL;
+
+    if(fAxisRangeFrom=="" && fAxisRangeTo=="") INFO_MESS << "Axis range adapted to the data" << ENDL;
+    else if(fAxisRangeFrom=="") INFO_MESS << "Axis range up to " << fAxisRangeTo << ENDL;
+    else if(fAxisRangeTo=="") INFO_MESS << "Axis range up from " << fAxisRangeFrom << ENDL;
+    else INFO_MESS << "Axis range from " << fAxisRangeFrom << " to " << fAxisRangeTo << ENDL;
+
+    if(fFitRangeFrom=="" && fFitRangeTo=="") INFO_MESS << "Fit range adapted to axis range" << ENDL;
+    else if(fFitRangeFrom=="") INFO_MESS << "Fit range up to " << fFitRangeTo << ENDL;
+    else if(fFitRangeTo=="") INFO_MESS << "Fit range up from " << fFitRangeFrom << ENDL;
+    else INFO_MESS << "Fit range from " << fFitRangeFrom << " to " << fFitRangeTo << ENDL;
+}
+
+TH1D *BuildDateHistogram(TString Name) {
+
+    // definitions of the used histograms, for the years 2020 and 2021
+    vector<TString> vdates;
+
+    // definition of the string dates, to be used for gaphical plot of the dates
+    TString Mounth_str[12] = {"Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"};
+    Int_t NDaysPerMounth[12] = {31,29,31,30,31,30,31,31,30,31,30,31};
+
+    // Here, we define the names of the bins of the histogram to use the dates
+    for(int year=20 ; year<=21 ; year++) {
+        for(int i=0 ; i<12 ; i++) {
+            if(year==21 && i==1) NDaysPerMounth[i] = 28;
+            for(int j=0 ; j<NDaysPerMounth[i] ; j++) {
+                TString Label = Form("%d-%s-%d",j+1,Mounth_str[i].Data(),year);
+                vdates.push_back(Label);
+            }
+        }
+    }
+
+    // now we define the histogram and we define the axis properties
+    TH1D *hist = new TH1D(Name,Name,vdates.size(),0,vdates.size());
+
+    for(size_t ibin=0 ; ibin<vdates.size() ; ibin++) hist->GetXaxis()->SetBinLabel(ibin+1,vdates.at(ibin));
+
+    hist->GetYaxis()->CenterTitle();
+    hist->GetXaxis()->SetLabelSize(0.04);
+    hist->GetXaxis()->SetTitleOffset(1.);
+    hist->GetXaxis()->SetTitleFont(132);
+    hist->GetXaxis()->SetLabelFont(132);
+
+    hist->GetYaxis()->SetLabelSize(0.05);
+    hist->GetYaxis()->SetTitleSize(0.05);
+    hist->GetYaxis()->SetTitleOffset(1.15);
+    hist->GetYaxis()->SetTickSize(0.01);
+    hist->GetXaxis()->SetTickSize(0.01);
+    hist->GetYaxis()->SetTitleFont(132);
+    hist->GetYaxis()->SetLabelFont(132);
+
+    hist->SetDirectory(nullptr);
+    hist->SetMarkerStyle(20);
+    hist->SetMarkerColor(kBlack);
+    hist->SetLineColor(kBlack);
+
+    return hist;
+}
+
+Int_t GetDateBin(TString Date)
+{
+    // same calendar as the one defined in BuildDateHistogram: bin 1 is the 1-Jan-20, for the years 2020 and 2021
+    const char *Mounth_str[12] = {"Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"};
+    Int_t NDaysPerMounth[12] = {31,28,31,30,31,30,31,31,30,31,30,31};
+
+    Int_t Day=0, Year=0;
+    char Mounth[4] = "";
+    if(sscanf(Date.Data(),"%d-%3s-%d",&Day,Mounth,&Year) != 3) return -1;
+    if(Year<20 || Year>21) return -1;
+
+    Int_t Bin = 0;
+    for(int year=20 ; year<Year ; year++) Bin += (year%4==0) ? 366 : 365;
+    for(int i=0 ; i<12 ; i++) {
+        Int_t NDays = NDaysPerMounth[i] + ((i==1 && Year%4==0) ? 1 : 0);
+        if(strcmp(Mounth,Mounth_str[i]) == 0) {
+            if(Day<1 || Day>NDays) return -1;
+            return Bin + Day;
+        }
+        Bin += NDays;
+    }
+
+    return -1;
+}
+
+TString GetBinDate(Int_t Bin)
+{
+    // inverse of GetDateBin, same calendar as the one defined in BuildDateHistogram
+    const char *Mounth_str[12] = {"Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"};
+    Int_t NDaysPerMounth[12] = {31,28,31,30,31,30,31,31,30,31,30,31};
+
+    if(Bin<1) return "";
+    for(int year=20 ; year<=21 ; year++) {
+        for(int i=0 ; i<12 ; i++) {
+            Int_t NDays = NDaysPerMounth[i] + ((i==1 && year%4==0) ? 1 : 0);
+            if(Bin<=NDays) return TString::Format("%d-%s-%d",Bin,Mounth_str[i],year);
+            Bin -= NDays;
+        }
+    }
+
+    return "";
+}
+
+Double_t BinToX(Int_t Bin)
+{
+    // the histograms have one bin per day, starting at 0
+    return Bin - 0.5;
+}
+
+bool ReadData(TString filename, vector<TString> &dates, vector<Double_t> &total_deaths, Long64_t *BytesRead)
+{
+    return ReadData(filename,fReadDataFrom,fReadDataTo,dates,total_deaths,BytesRead);
+}
+
+bool ReadData(TString filename, TString DateFrom, TString DateTo, vector<TString> &dates, vector<Double_t> &total_deaths, Long64_t *BytesRead)
+{
+    vector<TString> case_dates;
+    vector<Double_t> total_cases;
+    return ReadData(filename,DateFrom,DateTo,dates,total_deaths,case_dates,total_cases,BytesRead);
+}
+
+bool ReadData(TString filename, TString DateFrom, TString DateTo, vector<TString> &dates, vector<Double_t> &total_deaths,
+              vector<TString> &case_dates, vector<Double_t> &total_cases, Long64_t *BytesRead)
+{
+    case_dates.clear();
+    total_cases.clear();
+
+    // a column of a wide data file is read with all the other columns
+    TString WideFile, Column;
+    if(SplitWideSource(filename,WideFile,Column)) {
+        WideData wide;
+        if(!ReadWideData(WideFile,wide,BytesRead)) return false;
+        if(!GetWideColumn(wide,Column,dates,total_deaths)) {
+            ERR_MESS << "No column " << Column << " in " << WideFile << ENDL;
+            return false;
+        }
+        TrimDataRange(dates,total_deaths,DateFrom,DateTo);
+        return true;
+    }
+
+    // The selected file (or stream) is opended, and if not found, return with an error message
+    DataStream file;
+    if(!OpenDataStream(file,filename)) {
+        cout<<filename<<" not found"<<endl;
+        return false;
+    }
+
+    // The vectors containing data are cleared from previous use
+    dates.clear();
+    total_deaths.clear();
+
+    string line;
+
+    // the first line is not used, we read it first to skip this line
+    ReadDataLine(file,line);
+    if(BytesRead) *BytesRead += line.size()+1;
+
+    Int_t Current_Year = 20;
+
+    // the range is compared on the bins of the dates, as in TrimDataRange: any spelling of the dates is accepted ("01-Aug-20"),
+    // and a range starting before the first line or ending after the last one is cut to the data
+    Int_t BinFrom = (DateFrom=="") ? 0 : GetDateBin(DateFrom);
+    Int_t BinTo = (DateTo=="") ? 0 : GetDateBin(DateTo);
+
+    // then we look on all the lines of the file, puting each line in the string: line
+    while(ReadDataLine(file,line)) {
+        if(BytesRead) *BytesRead += line.size()+1;
+
+        TString Date;
+        Int_t Deaths, Cases;
+        if(!ParseDataLine(line,Current_Year,Date,Deaths,Cases)) continue;
+
+        Int_t Bin = GetDateBin(Date);
+        if(BinFrom && Bin < BinFrom) continue;
+        // after the last date that has been asked to be taken into acount, we stop reading the file
+        if(BinTo && Bin > BinTo) break;
+
+        // if the death number is well defined, we push this info (date + deaths) in the associated vectors
+        if(Deaths) {
+            dates.push_back(Date);
+            total_deaths.push_back(Deaths);
+        }
+        // same for the cases, which start before the deaths
+        if(Cases) {
+            case_dates.push_back(Date);
+            total_cases.push_back(Cases);
+        }
+    }
+
+    bool Ok = !file.Error;
+    if(!Ok) ERR_MESS << "Error while reading " << filename << ENDL;
+    CloseDataStream(file);
+
+    return Ok;
+}
+
+Bool_t IsDataStream(TString Source)
+{
+    return (Source == "-" || Source.BeginsWith("fd:"));
+}
+
+Bool_t IsCompressed(TString Source)
+{
+    return (Source.EndsWith(".gz") || Source.EndsWith(".zst"));
+}
+
+TString GetDataFileName(TString Country)
+{
+    if(IsDataStream(Country)) return Country;
+
+    TString WideFile, Column;
+    if(SplitWideSource(Country,WideFile,Column)) return GetDataFileName(WideFile) + ":" + Column;
+
+    TString FileName = Form("%s/%s.csv",fDataFolder.Data(),Country.Data());
+    for(auto Extension : {"",".gz",".zst"}) {
+        if(!gSystem->AccessPathName(FileName+Extension)) return FileName+Extension;
+    }
+    return FileName;
+}
+
+bool OpenDataStream(DataStream &stream, TString Source)
+{
+    stream = DataStream();
+    stream.Source = Source;
+    stream.Buffer.resize(kStreamChunk);
+
+    // the standard input and the file descriptors are read through zlib, which reads them as they are if not compressed
+    if(IsDataStream(Source)) {
+        int Fd = (Source == "-") ? 0 : TString(Source(3,Source.Length())).Atoi();
+        int Copy = dup(Fd);
+        if(Copy < 0) return false;
+        stream.Gz = gzdopen(Copy,"rb");
+        if(stream.Gz == nullptr) {
+            close(Copy);
+            return false;
+        }
+        gzbuffer((gzFile)stream.Gz,2*kStreamChunk);
+        return true;
+    }
+
+    if(Source.EndsWith(".gz")) {
+        stream.Gz = gzopen(Source.Data(),"rb");
+        if(stream.Gz == nullptr) return false;
+        gzbuffer((gzFile)stream.Gz,2*kStreamChunk);
+        return true;
+    }
+
+#ifndef COVID19_WITH_ZSTD
+    if(Source.EndsWith(".zst")) {
+        ERR_MESS << "Cannot read " << Source << ": the libraries have been built without zstd" << ENDL;
+        return false;
+    }
+#endif
+
+    stream.Fd = open(Source.Data(),O_RDONLY);
+    if(stream.Fd < 0) return false;
+    stream.OwnFd = true;
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(stream.Fd,0,0,POSIX_FADV_SEQUENTIAL);
+#endif
+
+#ifdef COVID19_WITH_ZSTD
+    if(Source.EndsWith(".zst")) {
+        stream.Zstd = ZSTD_createDCtx();
+        stream.Input.resize(ZSTD_DStreamInSize());
+    }
+#endif
+
+    return true;
+}
+
+// to fill the buffer of a stream with the next decompressed chunk, returns false at the end or on error
+static bool FillDataStream(DataStream &stream)
+{
+    stream.Pos = 0;
+    stream.Size = 0;
+    if(stream.End) return false;
+
+    if(stream.Gz) {
+        int N = gzread((gzFile)stream.Gz,stream.Buffer.data(),stream.Buffer.size());
+        if(N < 0) stream.Error = true;
+        if(N <= 0) stream.End = true;
+        else stream.Size = N;
+        return (N > 0);
+    }
+
+#ifdef COVID19_WITH_ZSTD
+    if(stream.Zstd) {
+        // the compressed chunks are read until some decompressed data are available
+        while(stream.Size == 0) {
+            if(stream.InputPos == stream.InputSize) {
+                ssize_t N = read(stream.Fd,stream.Input.data(),stream.Input.size());
+                if(N < 0 && errno == EINTR) continue;
+                if(N < 0) stream.Error = true;
+                if(N <= 0) {
+                    stream.End = true;
+                    return false;
+                }
+                stream.InputPos = 0;
+                stream.InputSize = N;
+            }
+            ZSTD_inBuffer In = {stream.Input.data(),stream.InputSize,stream.InputPos};
+            ZSTD_outBuffer Out = {stream.Buffer.data(),stream.Buffer.size(),0};
+            size_t Result = ZSTD_decompressStream((ZSTD_DCtx*)stream.Zstd,&Out,&In);
+            if(ZSTD_isError(Result)) {
+                ERR_MESS << "zstd error in " << stream.Source << ": " << ZSTD_getErrorName(Result) << ENDL;
+                stream.Error = true;
+                stream.End = true;
+                return false;
+            }
+            stream.InputPos = In.pos;
+            stream.Size = Out.pos;
+        }
+        return true;
+    }
+#endif
+
+    while(true) {
+        ssize_t N = read(stream.Fd,stream.Buffer.data(),stream.Buffer.size());
+        if(N < 0 && errno == EINTR) continue;
+        if(N < 0) stream.Error = true;
+        if(N <= 0) stream.End = true;
+        else stream.Size = N;
+        return (N > 0);
+    }
+}
+
+bool ReadDataLine(DataStream &stream, string &line)
+{
+    line.clear();
+    while(true) {
+        if(stream.Pos == stream.Size && !FillDataStream(stream)) return !line.empty();
+
+        const char *Begin = stream.Buffer.data()+stream.Pos;
+        const char *End = (const char*)memchr(Begin,'\n',stream.Size-stream.Pos);
+        if(End) {
+            line.append(Begin,End-Begin);
+            stream.Pos += End-Begin+1;
+            return true;
+        }
+        // the line continues in the next chunk
+        line.append(Begin,stream.Size-stream.Pos);
+        stream.Pos = stream.Size;
+    }
+}
+
+void CloseDataStream(DataStream &stream)
+{
+    if(stream.Gz) gzclose((gzFile)stream.Gz);
+#ifdef COVID19_WITH_ZSTD
+    if(stream.Zstd) ZSTD_freeDCtx((ZSTD_DCtx*)stream.Zstd);
+#endif
+    if(stream.OwnFd && stream.Fd >= 0) close(stream.Fd);
+    stream.Gz = nullptr;
+    stream.Zstd = nullptr;
+    stream.Fd = -1;
+}
+
+bool ParseDataLine(const string &line, Int_t &Year, TString &Date, Int_t &Deaths)
+{
+    Int_t Cases;
+    return ParseDataLine(line,Year,Date,Deaths,Cases);
+}
+
+bool ParseDataLine(const string &line, Int_t &Year, TString &Date, Int_t &Deaths, Int_t &Cases)
+{
+    // The string line, is then copied in a ROOT string (TString), on which specific methods can be used to easily play with the string
+    TString Buffer = line;
+
+    // The array arr will contain all the elements all the line separated by the separator
+    // as a function of the sofware used to write the data, the separator can be either ; or ,
+    // To not ignore posible empty lines, we separate ;; (or ,,) with a space to obtain an empty value in the array
+    TObjArray *arr = nullptr;
+    if(Buffer.Contains(";")) {
+        Buffer.Append(";");
+        Buffer.ReplaceAll(";;","; ;");
+        Buffer.ReplaceAll(";;","; ;");
+
+        arr = Buffer.Tokenize(";");
+    }
+    else if(Buffer.Contains(",")) {
+        Buffer.Append(",");
+        Buffer.ReplaceAll(",,",", ,");
+        Buffer.ReplaceAll(",,",", ,");
+
+        arr = Buffer.Tokenize(",");
+    }
+    else return false;
+
+    // The 2nd value of the array (index 1), corresponds to the date
+    Date = (TString)arr->At(1)->GetName();
+    TObjArray *arr2 = Date.Tokenize("$");
+    Date = arr2->First()->GetName();
+    delete arr2;
+    Date.ReplaceAll(" ","-");
+
+    // To extact the day and mounth, we again cut the date in a new array, "temp"
+    TObjArray *temp = Date.Tokenize("-");
+    // the mounth number is stored
+    TString Mounth = (TString)temp->At(0)->GetName();
+    // and then the Day number
+    Int_t Day = ((TString)temp->At(1)->GetName()).Atoi();
+    // The date, in string format, is then stored in our prefered format
+    Date = Form("%d-%s-%d",Day,Mounth.Data(),Year);
+    // The array temp is no more necessary, we delete it to free
+    delete temp;
+
+    if(Date.BeginsWith("31-Dec")) Year++;
+
+    // Then, the total number of cases and deaths are stored
+    Cases = ((TString)arr->At(2)->GetName()).Atoi();
+    Deaths = ((TString)arr->At(3)->GetName()).Atoi();
+
+    // The array arr is no more necessary, we delete it to free
+    delete arr;
+
+    return true;
+}
+
+// 64 bits FNV-1a checksum, continued from a previous value
+static ULong64_t UpdateChecksum(ULong64_t Checksum, const char *data, size_t size)
+{
+    for(size_t i=0 ; i<size ; i++) {
+        Checksum ^= (unsigned char)data[i];
+        Checksum *= 1099511628211ULL;
+    }
+    return Checksum;
+}
+
+Int_t UpdateDataFile(DataFile &data, Long64_t *BytesParsed)
+{
+    // the compressed files and the streams cannot be read from an offset, they are fully parsed, as the wide files
+    TString WideFile, Column;
+    if(IsDataStream(data.FileName) || IsCompressed(data.FileName) || SplitWideSource(data.FileName,WideFile,Column)) {
+        if(!ReadData(data.FileName,"","",data.Dates,data.Total_Deaths,data.Case_Dates,data.Total_Cases,BytesParsed)) return kDataNotFound;
+        return kDataRead;
+    }
+
+    ifstream file(data.FileName,ios::binary);
+    if(!file) {
+        cout<<data.FileName<<" not found"<<endl;
+        return kDataNotFound;
+    }
+    file.seekg(0,ios::end);
+    Long64_t Size = file.tellg();
+    file.seekg(0,ios::beg);
+
+    // the beginning of the file, parsed at the previous call, is compared with its checksum: if it has changed
+    // (historical revision, or new file), the whole file is parsed again
+    Bool_t Append = (data.Offset>0 && Size>=data.Offset);
+    if(Append) {
+        ULong64_t Checksum = kChecksumInit;
+        vector<char> Block(1<<16);
+        Long64_t Remaining = data.Offset;
+        while(Remaining>0 && file) {
+            file.read(Block.data(),min<Long64_t>(Remaining,Block.size()));
+            Checksum = UpdateChecksum(Checksum,Block.data(),file.gcount());
+            Remaining -= file.gcount();
+        }
+        Append = (Remaining==0 && Checksum == data.Checksum);
+    }
+    if(!Append) {
+        DataFile Empty;
+        Empty.FileName = data.FileName;
+        data = Empty;
+        file.clear();
+        file.seekg(0,ios::beg);
+    }
+
+    // only the complete lines are parsed, a line being written by the scraper is parsed at the next call
+    string Tail(Size-data.Offset,'\0');
+    file.read(&Tail[0],Tail.size());
+    Tail.resize(file.gcount());
+    size_t End = Tail.rfind('\n');
+    if(End == string::npos) return (Append) ? kDataUnchanged : kDataRead;
+    Tail.resize(End+1);
+
+    size_t Pos = 0;
+    // the first line of the file is not used
+    if(data.Offset == 0) Pos = Tail.find('\n')+1;
+    while(Pos < Tail.size()) {
+        size_t Next = Tail.find('\n',Pos);
+        TString Date;
+        Int_t Deaths, Cases;
+        if(ParseDataLine(Tail.substr(Pos,Next-Pos),data.Year,Date,Deaths,Cases)) {
+            if(Deaths) {
+                data.Dates.push_back(Date);
+                data.Total_Deaths.push_back(Deaths);
+            }
+            if(Cases) {
+                data.Case_Dates.push_back(Date);
+                data.Total_Cases.push_back(Cases);
+            }
+        }
+        Pos = Next+1;
+    }
+
+    data.Checksum = UpdateChecksum(data.Checksum,Tail.data(),Tail.size());
+    data.Offset += Tail.size();
+    if(BytesParsed) *BytesParsed += Tail.size();
+
+    if(!Append) return kDataRead;
+    return (Tail.empty()) ? kDataUnchanged : kDataAppended;
+}
+
+void TrimDataRange(vector<TString> &dates, vector<Double_t> &total_deaths, TString DateFrom, TString DateTo)
+{
+    Int_t BinFrom = (DateFrom=="") ? 0 : GetDateBin(DateFrom);
+    Int_t BinTo = (DateTo=="") ? 0 : GetDateBin(DateTo);
+
+    size_t NKept = 0;
+    for(size_t i=0 ; i<dates.size() ; i++) {
+        Int_t Bin = GetDateBin(dates.at(i));
+        if(BinFrom && Bin < BinFrom) continue;
+        if(BinTo && Bin > BinTo) break;
+        dates.at(NKept) = dates.at(i);
+        total_deaths.at(NKept) = total_deaths.at(i);
+        NKept++;
+    }
+    dates.resize(NKept);
+    total_deaths.resize(NKept);
+}
+
+Bool_t SplitWideSource(TString Source, TString &FileName, TString &Column)
+{
+    Int_t Pos = Source.Last(':');
+    if(IsDataStream(Source) || Pos <= 0 || Pos == Source.Length()-1) return false;
+    FileName = Source(0,Pos);
+    Column = Source(Pos+1,Source.Length());
+    return !Column.Contains("/");
+}
+
+TString GetSourceFile(TString Source)
+{
+    TString FileName, Column;
+    if(SplitWideSource(Source,FileName,Column)) return FileName;
+    return Source;
+}
+
+bool ReadWideData(TString filename, WideData &data, Long64_t *BytesRead)
+{
+    const char *Mounth_str[12] = {"Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"};
+
+    data = WideData();
+    data.FileName = filename;
+
+    DataStream file;
+    if(!OpenDataStream(file,filename)) {
+        cout<<filename<<" not found"<<endl;
+        return false;
+    }
+
+    // to cut a line in its fields, the trailing commas giving empty fields
+    vector<string> Fields;
+    auto Split = [&Fields](const string &line) {
+        Fields.clear();
+        size_t Begin = 0;
+        while(true) {
+            size_t End = line.find(',',Begin);
+            Fields.push_back(line.substr(Begin,(End==string::npos) ? string::npos : End-Begin));
+            if(End == string::npos) break;
+            Begin = End+1;
+        }
+        while(!Fields.empty() && (Fields.back().empty() || Fields.back() == "\r")) Fields.pop_back();
+    };
+
+    // the first line gives the names of the columns, after the date and the YYYYMMDD date
+    string line;
+    ReadDataLine(file,line);
+    if(BytesRead) *BytesRead += line.size()+1;
+    Split(line);
+    for(size_t ifield=2 ; ifield<Fields.size() ; ifield++) data.Columns.push_back(TString(Fields.at(ifield)).Strip(TString::kBoth));
+    Int_t NColumns = data.Columns.size();
+    data.Values.resize(NColumns);
+
+    vector<Double_t> Row(NColumns,0.);
+    Int_t NSkipped = 0;
+    while(ReadDataLine(file,line)) {
+        if(BytesRead) *BytesRead += line.size()+1;
+        Split(line);
+        if(Fields.size()<2) continue;
+
+        Int_t Day=0, Mounth=0, Year=0;
+        if(sscanf(Fields.at(0).c_str(),"%d-%d-%d",&Day,&Mounth,&Year) != 3 || Mounth<1 || Mounth>12) {
+            NSkipped++;
+            continue;
+        }
+        TString Date = Form("%d-%s-%d",Day,Mounth_str[Mounth-1],Year%100);
+        Int_t Bin = GetDateBin(Date);
+        // the dates out of the calendar, or not after the previous one, are not used
+        if(Bin == -1 || (!data.Bins.empty() && Bin <= data.Bins.back())) {
+            NSkipped++;
+            continue;
+        }
+
+        // a missing value keeps the value of the previous day
+        for(int icol=0 ; icol<NColumns ; icol++) {
+            size_t ifield = icol+2;
+            if(ifield < Fields.size() && !TString(Fields.at(ifield)).Strip(TString::kBoth).IsNull()) Row.at(icol) = atof(Fields.at(ifield).c_str());
+        }
+
+        // the missing days are filled by a linear interpolation of the totals between the two known days
+        if(!data.Bins.empty() && Bin > data.Bins.back()+1) {
+            Int_t LastBin = data.Bins.back();
+            size_t LastDay = data.Bins.size()-1;
+            for(int bin=LastBin+1 ; bin<Bin ; bin++) {
+                data.Bins.push_back(bin);
+                data.Dates.push_back(GetBinDate(bin));
+                data.Filled.push_back(true);
+                Double_t Fraction = (Double_t)(bin-LastBin)/(Bin-LastBin);
+                for(int icol=0 ; icol<NColumns ; icol++) {
+                    Double_t Last = data.Values.at(icol).at(LastDay);
+                    data.Values.at(icol).push_back(Last + Fraction*(Row.at(icol)-Last));
+                }
+            }
+        }
+
+        data.Bins.push_back(Bin);
+        data.Dates.push_back(Date);
+        data.Filled.push_back(false);
+        for(int icol=0 ; icol<NColumns ; icol++) data.Values.at(icol).push_back(Row.at(icol));
+    }
+
+    bool Ok = !file.Error;
+    CloseDataStream(file);
+    if(!Ok) ERR_MESS << "Error while reading " << filename << ENDL;
+    if(NSkipped) WARN_MESS << NSkipped << " lines of " << filename << " not used (wrong date, or out of the 2020-2021 calendar)" << ENDL;
+
+    return Ok;
+}
+
+bool GetWideColumn(const WideData &data, TString Column, vector<TString> &dates, vector<Double_t> &total_deaths)
+{
+    dates.clear();
+    total_deaths.clear();
+
+    auto it = find(data.Columns.begin(),data.Columns.end(),Column);
+    if(it == data.Columns.end()) return false;
+    const vector<Double_t> &Values = data.Values.at(it-data.Columns.begin());
+
+    // as in ReadData, the days without deaths are not used
+    for(size_t iday=0 ; iday<Values.size() ; iday++) {
+        if(Values.at(iday) == 0) continue;
+        dates.push_back(data.Dates.at(iday));
+        total_deaths.push_back(Values.at(iday));
+    }
+    return true;
+}
+
+Bool_t ExpandCountry(TString Pattern, vector<TString> &Countries)
+{
+    if(!Pattern.Contains("*") && !Pattern.Contains("?") && !Pattern.Contains("[")) {
+        Countries.push_back(Pattern);
+        return true;
+    }
+
+    // pattern on the columns of a wide file
+    TString WideFile, Column;
+    if(SplitWideSource(Pattern,WideFile,Column)) {
+        WideData wide;
+        Int_t NFound = 0;
+        if(ReadWideData(GetDataFileName(WideFile),wide)) {
+            for(auto &column : wide.Columns) {
+                if(fnmatch(Column,column,0) != 0) continue;
+                Countries.push_back(WideFile + ":" + column);
+                NFound++;
+            }
+        }
+        if(NFound == 0) WARN_MESS << "No column matching " << Pattern << ENDL;
+        return NFound>0;
+    }
+
+    // the compressed data files are also taken into account, a country being added once
+    glob_t Files;
+    TString FilePattern = Form("%s/%s.csv",fDataFolder.Data(),Pattern.Data());
+    Int_t Flags = 0;
+    for(auto Extension : {"",".gz",".zst"}) {
+        if(glob(FilePattern+Extension,Flags,nullptr,&Files) == 0) Flags = GLOB_APPEND;
+    }
+    Int_t NFound = 0;
+    if(Flags) {
+        set<TString> Found;
+        for(size_t ifile=0 ; ifile<Files.gl_pathc ; ifile++) {
+            TString Country = gSystem->BaseName(Files.gl_pathv[ifile]);
+            Country.Remove(Country.Index(".csv"));
+            if(!Found.insert(Country).second) continue;
+            Countries.push_back(Country);
+            NFound++;
+        }
+    }
+    globfree(&Files);
+
+    if(NFound == 0) WARN_MESS << "No data file matching " << FilePattern << ENDL;
+
+    return NFound>0;
+}
+
+void SmoothVector(Int_t N, vector<double> &data, vector<double> &data_err)
+{
+    vector<Double_t> Sum, NPoints, vSmooth, vSmooth_err;
+
+    BuildPrefixSums(data,Sum,NPoints);
+    SmoothFromPrefixSums(N,Sum,NPoints,vSmooth,vSmooth_err);
+
+    for(size_t i=0 ; i<data.size() ; i++) data.at(i) = vSmooth.at(i);
+    data_err.insert(data_err.end(),vSmooth_err.begin(),vSmooth_err.end());
+}
+
+void BuildPrefixSums(const vector<Double_t> &data, vector<Double_t> &sum, vector<Double_t> &npoints)
+{
+    // only the positive values are taken into account in the smoothing
+    sum.assign(data.size()+1,0.);
+    npoints.assign(data.size()+1,0.);
+    for(size_t i=0 ; i<data.size() ; i++) {
+        sum.at(i+1) = sum.at(i) + ((data.at(i)>0) ? data.at(i) : 0.);
+        npoints.at(i+1) = npoints.at(i) + ((data.at(i)>0) ? 1. : 0.);
+    }
+}
+
+void SmoothFromPrefixSums(Int_t N, const vector<Double_t> &sum, const vector<Double_t> &npoints, vector<Double_t> &smooth, vector<Double_t> &smooth_err, Bool_t Centred)
+{
+    size_t Size = sum.size()-1;
+    smooth.assign(Size,0.);
+    smooth_err.assign(Size,0.);
+
+    // each point is the average of the N last days (including the current one), with an error of sqrt(2*N_deaths) for each day
+    // in the centred mode, the window goes from (N-1)/2 days before to N/2 days after, and is cut at the edges
+    if(N<1) return;
+    for(size_t i=((Centred) ? 0 : N) ; i<Size ; i++) {
+        size_t First = (Centred) ? max(0,(Int_t)i-(N-1)/2) : i+1-N;
+        size_t Last = (Centred) ? min(Size-1,i+N/2) : i;
+        Double_t Tot = sum.at(Last+1) - sum.at(First);
+        Double_t NPoints = npoints.at(Last+1) - npoints.at(First);
+
+        if(NPoints>0 && Tot>0.) {
+            smooth.at(i) = Tot/NPoints;
+            smooth_err.at(i) = sqrt(2*Tot)/NPoints;
+        }
+    }
+}
+
+void DetectAnomalies(const vector<Double_t> &data, Int_t Window, Double_t Threshold, vector<Anomaly> &anomalies)
+{
+    anomalies.clear();
+    Int_t Size = data.size();
+    Int_t HalfWindow = max(1,Window/2);
+
+    vector<Double_t> Values, Deviations;
+    for(int i=0 ; i<Size ; i++) {
+        Values.clear();
+        for(int j=max(0,i-HalfWindow) ; j<=min(Size-1,i+HalfWindow) ; j++) if(j != i && data.at(j)>0) Values.push_back(data.at(j));
+        if(Values.size()<5 && data.at(i)>=0) continue;
+
+        // median and median absolute deviation, by partial sorts of the small window
+        Double_t Median = 0., MAD = 0.;
+        if(!Values.empty()) {
+            nth_element(Values.begin(),Values.begin()+Values.size()/2,Values.end());
+            Median = Values.at(Values.size()/2);
+            Deviations.clear();
+            for(auto value : Values) Deviations.push_back(fabs(value-Median));
+            nth_element(Deviations.begin(),Deviations.begin()+Deviations.size()/2,Deviations.end());
+            MAD = Deviations.at(Deviations.size()/2);
+        }
+        // the counting fluctuations are the minimal spread, for the days with few deaths
+        Double_t Sigma = max(1.4826*MAD,sqrt(max(1.,Median)));
+
+        Anomaly anomaly;
+        anomaly.Index = i;
+        anomaly.Value = data.at(i);
+        anomaly.Expected = Median;
+        anomaly.Score = (data.at(i)-Median)/Sigma;
+        if(data.at(i)<0) anomaly.Type = kAnomalyNegative;
+        else if(anomaly.Score>Threshold && data.at(i)>2*Median) anomaly.Type = kAnomalySpike;
+        else continue;
+        anomalies.push_back(anomaly);
+    }
+}
+
+void CorrectAnomalies(vector<Double_t> &data, vector<Anomaly> &anomalies, Int_t Mode, Int_t Days)
+{
+    for(auto &anomaly : anomalies) {
+        anomaly.Mode = Mode;
+        Int_t i = anomaly.Index;
+        if(Mode == kAnomalyExclude) data.at(i) = 0.;
+        else if(Mode == kAnomalyRedistribute) {
+            // the excess (or the deficit of a negative day) is spread on the previous days, proportionally to their values
+            Double_t Target = (anomaly.Type == kAnomalyNegative) ? 0. : anomaly.Expected;
+            Double_t Excess = data.at(i)-Target;
+            Int_t First = max(0,i-Days);
+            Double_t Sum = 0.;
+            for(int j=First ; j<i ; j++) if(data.at(j)>0) Sum += data.at(j);
+            // a deficit larger than the deaths of the window is absorbed by doubling the window on the earlier days
+            while(Sum+Excess<0. && First>0) {
+                Int_t Previous = First;
+                First = max(0,First-max(1,i-First));
+                for(int j=First ; j<Previous ; j++) if(data.at(j)>0) Sum += data.at(j);
+            }
+            if(Sum<=0.) {
+                // nothing to redistribute on: the day is excluded
+                data.at(i) = 0.;
+                anomaly.Mode = kAnomalyExclude;
+                continue;
+            }
+            // only a deficit larger than all the previous days cannot be absorbed
+            Double_t Scale = max(0.,1.+Excess/Sum);
+            anomaly.Unabsorbed = min(0.,Sum+Excess);
+            for(int j=First ; j<i ; j++) if(data.at(j)>0) data.at(j) *= Scale;
+            data.at(i) = Target;
+        }
+    }
+}
+
+void DecomposeWeekly(const vector<Double_t> &data, Int_t FirstWeekday, Int_t NIterations, vector<Double_t> &factors, vector<Double_t> &trend, vector<Double_t> &adjusted)
+{
+    size_t Size = data.size();
+    factors.assign(7,1.);
+    adjusted = data;
+    trend.assign(Size,0.);
+
+    auto Weekday = [&](size_t i) { return ((FirstWeekday+(Int_t)i)%7+7)%7; };
+
+    vector<Double_t> Sum, NPoints, Trend_err;
+    for(int iteration=0 ; iteration<max(1,NIterations) ; iteration++) {
+        // trend: centred average on a full week of the data corrected by the current factors
+        for(size_t i=0 ; i<Size ; i++) adjusted.at(i) = data.at(i)/factors.at(Weekday(i));
+        BuildPrefixSums(adjusted,Sum,NPoints);
+        SmoothFromPrefixSums(7,Sum,NPoints,trend,Trend_err,true);
+
+        // factors: ratio of the data to the trend on each weekday, only on the days where the week is complete
+        Double_t DataSum[7] = {}, TrendSum[7] = {};
+        for(size_t i=3 ; i+3<Size ; i++) {
+            if(data.at(i)<=0 || trend.at(i)<=0) continue;
+            DataSum[Weekday(i)] += data.at(i);
+            TrendSum[Weekday(i)] += trend.at(i);
+        }
+        Double_t Mean = 0.;
+        for(int day=0 ; day<7 ; day++) {
+            factors.at(day) = (DataSum[day]>0 && TrendSum[day]>0) ? DataSum[day]/TrendSum[day] : 1.;
+            Mean += factors.at(day)/7.;
+        }
+        for(auto &factor : factors) factor /= Mean;
+    }
+
+    for(size_t i=0 ; i<Size ; i++) adjusted.at(i) = data.at(i)/factors.at(Weekday(i));
+}
+
+void FFT(vector<complex<Double_t>> &data, Bool_t Inverse)
+{
+    size_t N = data.size();
+    if(N < 2) return;
+
+    // bit reversal permutation
+    for(size_t i=1, j=0 ; i<N ; i++) {
+        size_t bit = N>>1;
+        for( ; j&bit ; bit>>=1) j ^= bit;
+        j ^= bit;
+        if(i<j) swap(data.at(i),data.at(j));
+    }
+
+    // butterflies on blocks of increasing length
+    for(size_t Length=2 ; Length<=N ; Length<<=1) {
+        Double_t Angle = 2*TMath::Pi()/Length*((Inverse) ? 1 : -1);
+        complex<Double_t> Root(cos(Angle),sin(Angle));
+        for(size_t i=0 ; i<N ; i+=Length) {
+            complex<Double_t> w(1.,0.);
+            for(size_t j=0 ; j<Length/2 ; j++) {
+                complex<Double_t> u = data[i+j];
+                complex<Double_t> v = data[i+j+Length/2]*w;
+                data[i+j] = u+v;
+                data[i+j+Length/2] = u-v;
+                w *= Root;
+            }
+        }
+    }
+
+    if(Inverse) for(auto &value : data) value /= (Double_t)N;
+}
+
+size_t NextPowerOfTwo(size_t N)
+{
+    size_t Power = 1;
+    while(Power < N) Power <<= 1;
+    return Power;
+}
+
+void Convolve(const vector<Double_t> &a, const vector<Double_t> &b, vector<Double_t> &result)
+{
+    result.clear();
+    if(a.empty() || b.empty()) return;
+
+    // zero padding to the full length of the convolution, so that the circular convolution does not wrap
+    size_t Length = a.size()+b.size()-1;
+    size_t N = NextPowerOfTwo(Length);
+    vector<complex<Double_t>> fa(N), fb(N);
+    for(size_t i=0 ; i<a.size() ; i++) fa.at(i) = a.at(i);
+    for(size_t i=0 ; i<b.size() ; i++) fb.at(i) = b.at(i);
+    FFT(fa);
+    FFT(fb);
+    for(size_t i=0 ; i<N ; i++) fa.at(i) *= fb.at(i);
+    FFT(fa,true);
+
+    result.resize(Length);
+    for(size_t i=0 ; i<Length ; i++) result.at(i) = fa.at(i).real();
+}
+
+vector<Double_t> DiscretiseGamma(Double_t Mean, Double_t SD, Int_t FirstDay)
+{
+    vector<Double_t> Weights(max(0,FirstDay),0.);
+    if(Mean<=0. || SD<=0.) return Weights;
+
+    Double_t Shape = pow(Mean/SD,2);
+    Double_t Scale = SD*SD/Mean;
+    Double_t Previous = (FirstDay>0) ? TMath::Gamma(Shape,(FirstDay-0.5)/Scale) : 0.;
+    for(int day=max(0,FirstDay) ; day<=FirstDay+1000 && Previous<0.999 ; day++) {
+        Double_t Cumulated = TMath::Gamma(Shape,(day+0.5)/Scale);
+        Weights.push_back(Cumulated-Previous);
+        Previous = Cumulated;
+    }
+
+    return Weights;
+}
+
+void InitDeconvolver(Deconvolver &deconvolver, const vector<Double_t> &kernel, size_t Length)
+{
+    deconvolver = Deconvolver();
+    deconvolver.Length = Length;
+    deconvolver.Kernel = kernel;
+    if(kernel.empty() || Length == 0) return;
+
+    Double_t Sum = 0.;
+    for(auto weight : kernel) Sum += weight;
+    if(Sum>0.) for(auto &weight : deconvolver.Kernel) weight /= Sum;
+
+    // the curve has Length+K-1 values, its convolution with the kernel Length+2K-2
+    size_t K = kernel.size();
+    deconvolver.Size = NextPowerOfTwo(Length+2*K-2);
+    deconvolver.Spectrum.assign(deconvolver.Size,0.);
+    deconvolver.Adjoint.assign(deconvolver.Size,0.);
+    for(size_t i=0 ; i<K ; i++) {
+        deconvolver.Spectrum.at(i) = deconvolver.Kernel.at(i);
+        deconvolver.Adjoint.at(i) = deconvolver.Kernel.at(K-1-i);
+    }
+    FFT(deconvolver.Spectrum);
+    FFT(deconvolver.Adjoint);
+}
+
+// circular convolution of a vector (padded to the deconvolver size) with one of the kernel spectra
+static void ConvolveSpectrum(const vector<Double_t> &values, const vector<complex<Double_t>> &Spectrum, vector<complex<Double_t>> &result)
+{
+    result.assign(Spectrum.size(),0.);
+    for(size_t i=0 ; i<values.size() && i<result.size() ; i++) result.at(i) = values.at(i);
+    FFT(result);
+    for(size_t i=0 ; i<result.size() ; i++) result.at(i) *= Spectrum.at(i);
+    FFT(result,true);
+}
+
+void DeconvolveRichardsonLucy(const Deconvolver &deconvolver, const vector<Double_t> &data, Int_t NIterations, vector<Double_t> &result)
+{
+    size_t N = deconvolver.Length;
+    size_t K = deconvolver.Kernel.size();
+    result.clear();
+    if(K == 0 || data.size() != N) return;
+
+    // the iterations start from a flat curve, of the mean of the data
+    Double_t Mean = 0.;
+    for(auto value : data) Mean += max(0.,value)/N;
+    result.assign(N+K-1,max(Mean,1e-9));
+
+    vector<complex<Double_t>> Work;
+    vector<Double_t> Ratio(N);
+    for(int iteration=0 ; iteration<NIterations ; iteration++) {
+        // ratio of the data to the convolution of the current curve
+        ConvolveSpectrum(result,deconvolver.Spectrum,Work);
+        for(size_t t=0 ; t<N ; t++) {
+            Double_t Predicted = Work.at(t+K-1).real();
+            Ratio.at(t) = (Predicted>1e-12) ? max(0.,data.at(t))/Predicted : 0.;
+        }
+        // correction by the correlation of the ratio with the kernel, the kernel being normalised
+        ConvolveSpectrum(Ratio,deconvolver.Adjoint,Work);
+        for(size_t j=0 ; j<result.size() ; j++) result.at(j) *= max(0.,Work.at(j).real());
+    }
+}
+
+void DeconvolveTikhonov(const Deconvolver &deconvolver, const vector<Double_t> &data, Double_t Lambda, vector<Double_t> &result)
+{
+    size_t N = deconvolver.Length;
+    size_t K = deconvolver.Kernel.size();
+    result.clear();
+    if(K == 0 || data.size() != N) return;
+
+    // the data are placed at K-1, the curve starting K-1 days before them. The inverse filter being circular, the padding
+    // after the data (which wraps to the days before them) is filled with the mirrored end of the data then the mirrored start,
+    // both tapered to 0 by a cosine: without it, the jumps from the edges of the data to 0 ring over a kernel length
+    vector<complex<Double_t>> Work(deconvolver.Size,0.);
+    for(size_t t=0 ; t<N ; t++) Work.at(t+K-1) = data.at(t);
+    size_t Gap = deconvolver.Size-N, EndGap = Gap/2, StartGap = Gap-EndGap;
+    for(size_t i=0 ; i<EndGap ; i++) {
+        Double_t Taper = 0.5*(1.+cos(TMath::Pi()*(i+1)/(EndGap+1)));
+        Work.at(N+K-1+i) = Taper*data.at((i<N) ? N-1-i : 0);
+    }
+    for(size_t i=0 ; i<StartGap ; i++) {
+        Double_t Taper = 0.5*(1.+cos(TMath::Pi()*(i+1)/(StartGap+1)));
+        Work.at((deconvolver.Size+K-2-i)%deconvolver.Size) = Taper*data.at(min(i,N-1));
+    }
+    FFT(Work);
+
+    Double_t MaxPower = 0.;
+    for(auto &value : deconvolver.Spectrum) MaxPower = max(MaxPower,norm(value));
+    Double_t Regularisation = Lambda*MaxPower;
+    for(size_t i=0 ; i<Work.size() ; i++) {
+        const complex<Double_t> &k = deconvolver.Spectrum.at(i);
+        Work.at(i) *= conj(k)/(norm(k)+Regularisation);
+    }
+    FFT(Work,true);
+
+    // the negative values, due to the oscillations of the filter, are removed
+    result.resize(N+K-1);
+    for(size_t j=0 ; j<result.size() ; j++) result.at(j) = max(0.,Work.at(j).real());
+}
+
+Double_t GetRealTime()
+{
+    return chrono::duration<Double_t>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Double_t GetThreadCpuTime()
+{
+    // cpu time of the calling thread only, to time the stages of analyses running in parallel threads
+    timespec Time;
+    if(clock_gettime(CLOCK_THREAD_CPUTIME_ID,&Time) != 0) return 0.;
+    return Time.tv_sec + 1e-9*Time.tv_nsec;
+}
+
+Long_t GetResidentMemory()
+{
+    ProcInfo_t info;
+    gSystem->GetProcInfo(&info);
+    return info.fMemResident;
+}
+
+Bool_t CheckMemoryGrowth(TString What, Int_t NAnalyses, Long_t Start, Long_t End, Double_t MaxGrowth)
+{
+    Double_t Growth = (Double_t)(End-Start)/max(1,NAnalyses);
+    Bool_t Ok = Growth <= MaxGrowth;
+    TString Text = Form("Memory check: %d analyses of %s, resident memory %ld kB -> %ld kB (%.2f kB per analysis, %.2f kB allowed)",
+                        NAnalyses,What.Data(),Start,End,Growth,MaxGrowth);
+    if(Ok) INFO_MESS << Text << ENDL;
+    else ERR_MESS << Text << ENDL;
+
+    return Ok;
+}
+
+void RunParallel(Int_t NTasks, Int_t NThreads, const function<void(Int_t)> &Task)
+{
+    if(NThreads<=0) NThreads = thread::hardware_concurrency();
+    NThreads = max(1,min(NThreads,NTasks));
+
+    if(NThreads == 1) {
+        for(int itask=0 ; itask<NTasks ; itask++) Task(itask);
+        return;
+    }
+
+    // the tasks are distributed dynamically to the threads, each thread taking the next available one
+    ROOT::EnableThreadSafety();
+    atomic<Int_t> NextTask(0);
+    vector<thread> Threads;
+    for(int ithread=0 ; ithread<NThreads ; ithread++) {
+        Threads.emplace_back([&]() {
+            for(Int_t itask = NextTask++ ; itask<NTasks ; itask = NextTask++) Task(itask);
+        });
+    }
+    for(auto &th : Threads) th.join();
+}
@@ -0,0 +1,10 @@
+#ifdef __CLING__
+
+#pragma link off all globals;
+#pragma link off all classes;
+#pragma link off all functions;
+
+// options, calendar, reading and smoothing shared by the daily and total analyses
+#pragma link C++ defined_in "covid19_common.h";
+
+#endif
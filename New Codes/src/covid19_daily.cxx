@@ -0,0 +1,4666 @@
+#include "covid19_daily.h"
+
+////////////////////////////////////
+/// Global parameters definition ///
+////////////////////////////////////
+
+Bool_t fDoFullModel = true;
+Bool_t fDoD = false;
+Bool_t fDoD2 = true;
+Bool_t fDoESIR = false;
+Bool_t fDoESIR2 = true;
+Bool_t fDoSIR = false;
+Bool_t fDoSEIRD = false;
+
+Double_t fIncubationDays = 5.2;
+Double_t fInfectiousDays = 7.;
+Double_t fReductionDays = 7.;
+Double_t fODETolerance = 1e-6;
+
+Bool_t fDoWaveDetection = true;
+Double_t fWaveMinProminence = 0.2;
+
+Int_t fAnomalyMode = kAnomalyKeep;
+Int_t fAnomalyWindow = 21;
+Double_t fAnomalyThreshold = 6.;
+
+Bool_t fDoWeekly = false;
+Int_t fWeeklyIterations = 3;
+
+TString fStateFile = "";
+
+TString fTimingFile = "";
+
+Double_t fRegionTolerance = 0.1;
+
+Bool_t fDoCases = false;
+Int_t fMaxLag = 60;
+
+Bool_t fDoRt = false;
+Double_t fRtGenerationMean = 6.5;
+Double_t fRtGenerationSD = 4.;
+vector<Double_t> fRtGeneration;
+Int_t fRtWindow = 7;
+Int_t fRtDelay = 0;
+Bool_t fRtFromInfections = false;
+
+Bool_t fDoDeconvolution = false;
+Double_t fDelayMean = 23.;
+Double_t fDelaySD = 10.;
+vector<Double_t> fDelayWeights;
+Int_t fDeconvolutionMethod = kRichardsonLucy;
+Double_t fDeconvolutionRegularisation = 50.;
+
+Bool_t fDoForecast = false;
+Int_t fForecastDays = 30;
+Int_t fForecastFinalDays = 365;
+
+///////////////////////////////////
+/// Global variables definition ///
+///////////////////////////////////
+
+TH1D *hDaily_Deaths = nullptr;
+
+Int_t fColors[kNModels] = {kMagenta,kGreen,kBlue,kRed,kOrange+1,kCyan+2};
+const char *fModelNames[kNModels] = {"D'","D'2","ESIR","ESIR2","SIR","SEIRD"};
+const char *fAnomalyNames[kNAnomalies] = {"negative","spike"};
+const char *fAnomalyModeNames[kNAnomalyModes] = {"kept","excluded","redistributed"};
+const char *fDeconvolutionNames[kNDeconvolutionMethods] = {"Richardson-Lucy","Tikhonov"};
+const char *fStageNames[kNStages] = {"read","smooth","fit","band","deconvolution","rt","draw","picture"};
+
+vector<TString> vDates;
+vector<Double_t> vTotal_Deaths;
+vector<Double_t> vDaily_Deaths;
+vector<Double_t> vDaily_Deaths_error;
+
+vector<Wave> vWaves;
+
+Pipeline fPipeline;
+
+// Main fonction that plots the data and process the fits
+void
+Analyse(TString theCountry) {
+
+    AnalysisResult result;
+    vector<TString> Computed;
+
+    // in headless mode, only the fits are performed: no prompt, no printouts and no graphics
+    if(fHeadless) {
+        if(RunPipeline(theCountry,result) == false) return;
+        if(fStateFile!="") SaveState({result},fStateFile);
+        if(fTimingFile!="") WriteTimings({result},fTimingFile);
+        return;
+    }
+
+    // to print the program's configuration in the terminal
+    PrintParameters(theCountry);
+
+    // now, the data are read and smoothed, and the models are fitted, only the stages whose parameters have changed
+    // since the previous analysis being done again
+    if(RunPipeline(theCountry,result,&Computed) == false) return;
+    if(fStateFile!="") SaveState({result},fStateFile);
+
+    // the data are copied in the global vectors, to be available in the session after the analysis
+    vDates = result.Data.Dates;
+    vTotal_Deaths = result.Data.Total_Deaths;
+    vDaily_Deaths = result.Data.Daily_Deaths;
+    vDaily_Deaths_error = result.Data.Daily_Deaths_error;
+    vWaves = result.Data.Waves;
+
+    for(size_t iwave=0 ; iwave<vWaves.size() ; iwave++) {
+        INFO_MESS << "Wave " << iwave+1 << ": onset " << vDates.at(vWaves.at(iwave).Onset) << ", peak " << vDates.at(vWaves.at(iwave).Peak);
+        cout << " (" << Form("%.1f",vWaves.at(iwave).Height) << " deaths/day), end " << vDates.at(vWaves.at(iwave).End) << ENDL;
+    }
+
+    PrintWeekdayFactors(result.Data);
+    PrintWeekdayFactors(result.Cases);
+    for(auto &fit : result.Fits) PrintFit(fit);
+    PrintAnomalies(result);
+    if(!result.Cases.Dates.empty()) PrintCases(result);
+    if(fDoRt) PrintRt(result);
+    if(fDoDeconvolution) PrintInfections(result);
+    if(fDoForecast) PrintForecast(result);
+
+    // the plot is done again only if something has changed, or if the canvas has been closed
+    TString RenderKey = Form("%s|%u|%s|%s",theCountry.Data(),fPipeline.SmoothVersion,fAxisRangeFrom.Data(),fAxisRangeTo.Data());
+    for(auto &fit : result.Fits) RenderKey += Form("|%d_%d_%d_%d%s",fit.Model,fit.FullModel,fit.XMin,fit.XMax,GetCompartmentalKey(fit.Model).Data());
+    for(auto &fit : result.CaseFits) RenderKey += Form("|cases_%d_%d_%d_%d%s",fit.Model,fit.FullModel,fit.XMin,fit.XMax,GetCompartmentalKey(fit.Model).Data());
+    if(result.Rt.Valid) RenderKey += Form("|rt_%g_%g_%zu_%d_%d_%d",fRtGenerationMean,fRtGenerationSD,fRtGeneration.size(),fRtWindow,fRtDelay,fRtFromInfections);
+    if(result.Infections.Valid) RenderKey += Form("|infections_%g_%g_%zu_%d_%g",fDelayMean,fDelaySD,fDelayWeights.size(),fDeconvolutionMethod,fDeconvolutionRegularisation);
+    Bool_t Closed = gROOT->GetListOfCanvases()->FindObject("daily") == nullptr;
+    if(!result.Cases.Dates.empty()) Closed |= gROOT->GetListOfCanvases()->FindObject("cases") == nullptr;
+    if(result.Rt.Valid) Closed |= gROOT->GetListOfCanvases()->FindObject("rt") == nullptr;
+    if(result.Infections.Valid) Closed |= gROOT->GetListOfCanvases()->FindObject("infections") == nullptr;
+    if(RenderKey != fPipeline.RenderKey || Closed) {
+        DrawResult(result,&result.Timings);
+        if(!result.Cases.Dates.empty()) DrawResult(GetCasesResult(result),&result.Timings);
+        if(result.Rt.Valid) DrawRt(result);
+        if(result.Infections.Valid) DrawInfections(result);
+        fPipeline.RenderKey = RenderKey;
+        Computed.push_back("render");
+    }
+
+    if(Computed.empty()) INFO_MESS << "Nothing has changed since the previous analysis" << ENDL;
+    else {
+        TString Stages = "";
+        for(auto &stage : Computed) Stages += ((Stages=="") ? "" : ", ") + stage;
+        INFO_MESS << "Stages computed: " << Stages << ENDL;
+    }
+
+    PrintTiming(result);
+    if(fTimingFile!="") WriteTimings({result},fTimingFile);
+}
+
+Bool_t RunPipeline(TString theCountry, AnalysisResult &result, vector<TString> *Computed)
+{
+    Pipeline &pipe = fPipeline;
+
+    result = AnalysisResult();
+    result.Country = theCountry;
+
+    auto AddComputed = [&](TString Stage) {
+        if(Computed) Computed->push_back(Stage);
+    };
+
+    // read: the file is read again only if it has changed on disk, and then only the appended lines are parsed
+    // if the beginning of the file is unchanged
+    StageClock clock = StartStage();
+    TString FileName = GetDataFileName(theCountry);
+    Long_t Id, Size, Flags, ModTime;
+    TString Key;
+    // a stream (standard input or file descriptor) is read at each analysis
+    if(IsDataStream(FileName)) Key = Form("%s|%u",FileName.Data(),pipe.ReadVersion+1);
+    else if(gSystem->GetPathInfo(GetSourceFile(FileName),&Id,&Size,&Flags,&ModTime) != 0) {
+        cout<<FileName<<" not found"<<endl;
+        return false;
+    }
+    else Key = Form("%s|%ld|%ld",FileName.Data(),ModTime,Size);
+    if(Key != pipe.ReadKey) {
+        if(pipe.File.FileName != FileName) {
+            pipe.File = DataFile();
+            pipe.File.FileName = FileName;
+        }
+        pipe.BytesRead = 0;
+        Int_t Update = UpdateDataFile(pipe.File,&pipe.BytesRead);
+        if(Update == kDataNotFound) {
+            ResetPipeline();
+            return false;
+        }
+        pipe.ReadKey = Key;
+        if(Update != kDataUnchanged) {
+            pipe.ReadVersion++;
+            AddComputed((Update == kDataAppended) ? "read (appended lines)" : "read");
+        }
+    }
+
+    // trim and differentiate: read range and minimal number of deaths
+    Key = Form("%u|%s|%s|%d|%d|%d|%g",pipe.ReadVersion,fReadDataFrom.Data(),fReadDataTo.Data(),DeathsMin,fAnomalyMode,fAnomalyWindow,fAnomalyThreshold);
+    if(Key != pipe.SeriesKey) {
+        pipe.Raw = Series();
+        pipe.Raw.Country = theCountry;
+        pipe.Raw.BytesRead = pipe.BytesRead;
+        pipe.Raw.Dates = pipe.File.Dates;
+        pipe.Raw.Total_Deaths = pipe.File.Total_Deaths;
+        TrimDataRange(pipe.Raw.Dates,pipe.Raw.Total_Deaths,fReadDataFrom,fReadDataTo);
+        pipe.RawOk = BuildSeries(pipe.Raw);
+        pipe.SeriesKey = Key;
+        pipe.SeriesVersion++;
+        AddComputed("differentiate");
+    }
+    if(!pipe.RawOk) return false;
+    StopStage(result.Timings,kStageRead,clock);
+
+    // smooth and waves detection
+    clock = StartStage();
+    Key = Form("%u|%d|%d|%g|%d|%d",pipe.SeriesVersion,fNSmoothing,fDoWaveDetection,fWaveMinProminence,fDoWeekly,fWeeklyIterations);
+    if(Key != pipe.SmoothKey) {
+        pipe.Smoothed = pipe.Raw;
+        SmoothSeries(pipe.Smoothed,fNSmoothing);
+        pipe.SmoothKey = Key;
+        pipe.SmoothVersion++;
+        pipe.Fits.clear();
+        AddComputed("smooth");
+    }
+    result.Data = pipe.Smoothed;
+    StopStage(result.Timings,kStageSmooth,clock);
+
+    // the fit range depends on the axis range only when it is neither given nor defined by the waves
+    GetFitRange(result.Data,fFitRangeFrom,fFitRangeTo,result.XMin,result.XMax);
+
+    // fit and band of each model, kept for each fit range as long as the smoothed data do not change
+    for(auto Model : GetModels()) {
+        Key = Form("%d|%d|%d|%d%s",Model,fDoFullModel,result.XMin,result.XMax,GetCompartmentalKey(Model).Data());
+        auto it = pipe.Fits.find(Key);
+        if(it == pipe.Fits.end()) {
+            ModelFit fit;
+            FitModel(Model,result.Data,result.XMin,result.XMax,fit,nullptr,true,&result.Timings);
+            it = pipe.Fits.emplace(Key,fit).first;
+            AddComputed(Form("fit %s",fModelNames[Model]));
+        }
+        result.Fits.push_back(it->second);
+    }
+
+    // the cases, parsed with the deaths, are fitted with the same models, their fits being memoised with the ones of the deaths
+    if(fDoCases) {
+        vector<TString> case_dates = pipe.File.Case_Dates;
+        vector<Double_t> total_cases = pipe.File.Total_Cases;
+        TrimDataRange(case_dates,total_cases,fReadDataFrom,fReadDataTo);
+        if(BuildCaseSeries(theCountry,case_dates,total_cases,result.Data,result.Cases)) AnalyseCases(result,&pipe.Fits);
+    }
+
+    // the infections are derived from the smoothed data and the fits, and Rt from the data or the infections
+    clock = StartStage();
+    if(fDoDeconvolution) DeconvolveResult(result);
+    StopStage(result.Timings,kStageDeconvolution,clock);
+    clock = StartStage();
+    if(fDoRt) EstimateRt(result);
+    StopStage(result.Timings,kStageRt,clock);
+
+    return true;
+}
+
+void ResetPipeline()
+{
+    fPipeline = Pipeline();
+    ClearForecasts();
+}
+
+Bool_t AnalyseData(TString theCountry, AnalysisResult &result)
+{
+    result = AnalysisResult();
+    result.Country = theCountry;
+
+    // now, the data file is read, and the daily deaths (and cases) are calculated and smoothed
+    StageClock clock = StartStage();
+    if(fDoCases) {
+        if(LoadSeries(theCountry,result.Data,result.Cases) == false) return false;
+    }
+    else if(LoadSeries(theCountry,result.Data) == false) return false;
+    StopStage(result.Timings,kStageRead,clock);
+
+    clock = StartStage();
+    SmoothSeries(result.Data,fNSmoothing);
+    StopStage(result.Timings,kStageSmooth,clock);
+
+    // define the fit range
+    GetFitRange(result.Data,fFitRangeFrom,fFitRangeTo,result.XMin,result.XMax);
+
+    // In the following, we fit the different models, as a function of what has been asked in the Main fonctiuon parameters
+    // the confidence bands are computed at the same time, as they need the fit covariance
+    for(auto Model : GetModels()) {
+        ModelFit fit;
+        FitModel(Model,result.Data,result.XMin,result.XMax,fit,nullptr,true,&result.Timings);
+        result.Fits.push_back(fit);
+    }
+
+    if(fDoCases) AnalyseCases(result);
+
+    clock = StartStage();
+    if(fDoDeconvolution) DeconvolveResult(result);
+    StopStage(result.Timings,kStageDeconvolution,clock);
+    clock = StartStage();
+    if(fDoRt) EstimateRt(result);
+    StopStage(result.Timings,kStageRt,clock);
+
+    return true;
+}
+
+void DrawResult(const AnalysisResult &result, Timing *timing)
+{
+    StageClock clock = StartStage();
+
+    const Series &series = result.Data;
+    if(series.Dates.empty()) return;
+
+    // style parameters, to remove unsed default titles and stat
+    gStyle->SetOptTitle(0);
+    gStyle->SetOptStat(0);
+
+    // We create the Canvas and margins in which all will be ploted, the canvas being reused from one analysis to the other
+    // all the objects drawn in the canvas are owned by it, and deleted when it is cleared at the next plot
+    // the cases are plotted in their own canvas
+    const char *CanvasName = (series.Cases) ? "cases" : "daily";
+    TCanvas *MyCanvas = (TCanvas*)gROOT->GetListOfCanvases()->FindObject(CanvasName);
+    if(MyCanvas == nullptr) {
+        MyCanvas = new TCanvas(CanvasName,CanvasName,1600,1200);
+        MyCanvas->SetLeftMargin(0.107635);
+        MyCanvas->SetRightMargin(0.00125156);
+        MyCanvas->SetBottomMargin(0.13619);
+        MyCanvas->SetTopMargin(0.00190476);
+    }
+    MyCanvas->Clear();
+    MyCanvas->cd();
+
+    // histogram initialization, the cases having their own histogram, owned by their canvas
+    TH1D *hDaily = nullptr;
+    if(series.Cases) {
+        hDaily = PadOwned(BuildDateHistogram("hDaily_Cases"));
+        hDaily->GetYaxis()->SetTitle("CASES / DAY");
+        hDaily->SetBinContent(1,0.001);
+        hDaily->SetBinContent(hDaily->GetNbinsX(),0.001);
+    }
+    else {
+        InitHistograms();
+        hDaily = hDaily_Deaths;
+    }
+
+    // for better printouts in the plots, we change the coutries names of US and UK
+    TString theCountry = result.Country;
+    if(theCountry.EqualTo("US",TString::kIgnoreCase)) theCountry = "USA";
+    if(theCountry.EqualTo("UK",TString::kIgnoreCase)) theCountry = "United Kingdom";
+    theCountry.ReplaceAll("_"," ");
+
+    const char *Prefix = (series.Cases) ? "DailyC" : "DailyD";
+    hDaily->SetNameTitle(Form("%s_%s",Prefix,theCountry.Data()),Form("%s_%s",Prefix,theCountry.Data()));
+
+    // get the bins corresponding to the defined range
+    Int_t DateMin,DateMax;
+    GetAxisRange(series,DateMin,DateMax);
+
+    // the LastDate string is used to plot the last date of the data
+    TString LastDate = series.Dates.back();
+
+    // now, we fill the histogram
+    for(size_t i=0 ; i<series.Dates.size() ; i++) {
+        if(i<series.Daily_Deaths.size() && series.Daily_Deaths.at(i)) {
+            Int_t Bin = series.Bins.at(i);
+            if(Bin>0) {
+                hDaily->SetBinContent(Bin,series.Daily_Deaths.at(i));
+                hDaily->SetBinError(Bin,series.Daily_Deaths_error.at(i));
+            }
+            LastDate = series.Dates.at(i);
+        }
+    }
+
+    // The daily deaths histogram is ploted
+    hDaily->Draw("p");
+
+    // Chi2 definition
+    Double_t fChi2D=0., fChi2D2=0., fChi2ESIR=0., fChi2ESIR2=0.;
+    // functions definition
+    TF1 *fDaily_ESIR=nullptr, *fDaily_ESIR2=nullptr,*fDaily_D=nullptr,*fDaily_D2=nullptr;
+    Bool_t FullD2=false, FullESIR2=false;
+    // the compartmental models have the same parameters, and are printed by the same code
+    struct CompartmentalCurve { Int_t Model; TF1 *Func; Double_t Chi2; };
+    vector<CompartmentalCurve> fDaily_Compartmental;
+
+    // the fitted functions are rebuilt from the fit results, with their confidence bands
+    for(auto &fit : result.Fits) {
+        if(fit.Pars.empty()) continue;
+
+        TF1 *func = PadOwned(InitModel(fit.Model,fit.FullModel,Form("%s_%s",fModelNames[fit.Model],hDaily->GetName()),fit.XMin,series));
+        func->SetParameters(fit.Pars.data());
+        func->SetParErrors(fit.Errors.data());
+        func->Draw("same");
+
+        Double_t Chi2 = (fit.Ndf>0) ? fit.Chi2/fit.Ndf : 0.;
+        if(fit.Model == kModelD) {fDaily_D = func; fChi2D = Chi2;}
+        if(fit.Model == kModelD2) {fDaily_D2 = func; fChi2D2 = Chi2; FullD2 = fit.FullModel;}
+        if(fit.Model == kModelESIR) {fDaily_ESIR = func; fChi2ESIR = Chi2;}
+        if(fit.Model == kModelESIR2) {fDaily_ESIR2 = func; fChi2ESIR2 = Chi2; FullESIR2 = fit.FullModel;}
+        if(IsCompartmental(fit.Model)) fDaily_Compartmental.push_back({fit.Model,func,Chi2});
+
+        /*Create a histogram to hold the confidence intervals*/
+        if(fit.Band.size() == (size_t)hDaily->GetNbinsX()) {
+            auto *herror = PadOwned((TH1*)hDaily->Clone());
+            herror->Reset();
+            herror->SetName(((TString)hDaily->GetName()).Append("_error").Append(TString(fModelNames[fit.Model]).ReplaceAll("'","")));
+            for(int ibin=1 ; ibin<=herror->GetNbinsX() ; ibin++) {
+                herror->SetBinContent(ibin,fit.Band.at(ibin-1));
+                herror->SetBinError(ibin,fit.Band_error.at(ibin-1));
+            }
+
+            //Now the "hint" histogram has the fitted function values as the
+            //bin contents and the confidence intervals as bin errors
+            herror->SetStats(kFALSE);
+            herror->SetFillColor(func->GetLineColor());
+            herror->SetFillStyle(3002);
+            herror->SetFillColorAlpha(func->GetLineColor(),0.5);
+            herror->SetMarkerSize(0);
+            herror->Draw("e3 same");
+        }
+    }
+
+    // the two components of the D2 model are drawn separately
+    if(fDaily_D2) {
+        if(FullD2) {
+            TF1 *f1 = PadOwned(new TF1(Form("D2_%s_1",hDaily->GetName()),FuncD,hDaily->GetXaxis()->GetXmin(),hDaily->GetXaxis()->GetXmax(),4,1,TF1::EAddToList::kNo));
+            f1->SetParameters(fDaily_D2->GetParameter(0),fDaily_D2->GetParameter(1),fDaily_D2->GetParameter(2),fDaily_D2->GetParameter(6));
+            f1->SetLineColor(fDaily_D2->GetLineColor());
+            f1->SetLineStyle(kDashed);
+            f1->Draw("same");
+            TF1 *f2 = PadOwned(new TF1(Form("D2_%s_2",hDaily->GetName()),FuncD,hDaily->GetXaxis()->GetXmin(),hDaily->GetXaxis()->GetXmax(),4,1,TF1::EAddToList::kNo));
+            f2->SetParameters(fDaily_D2->GetParameter(3),fDaily_D2->GetParameter(4),fDaily_D2->GetParameter(5),fDaily_D2->GetParameter(6));
+            f2->SetLineColor(fDaily_D2->GetLineColor());
+            f2->SetLineStyle(kDashed);
+            f2->Draw("same");
+        }
+        else {
+            TF1 *f1 = PadOwned(new TF1(Form("D2_%s_1",hDaily->GetName()),FuncD,hDaily->GetXaxis()->GetXmin(),hDaily->GetXaxis()->GetXmax(),4,1,TF1::EAddToList::kNo));
+            f1->SetParameters(fDaily_D2->GetParameter(0),fDaily_D2->GetParameter(1),fDaily_D2->GetParameter(2),fDaily_D2->GetParameter(4));
+            f1->SetLineColor(fDaily_D2->GetLineColor());
+            f1->SetLineStyle(kDashed);
+            f1->Draw("same");
+            TF1 *f2 = PadOwned(new TF1(Form("D2_%s_2",hDaily->GetName()),FuncD,hDaily->GetXaxis()->GetXmin(),hDaily->GetXaxis()->GetXmax(),4,1,TF1::EAddToList::kNo));
+            f2->SetParameters(fDaily_D2->GetParameter(0),fDaily_D2->GetParameter(3),fDaily_D2->GetParameter(2),fDaily_D2->GetParameter(4));
+            f2->SetLineColor(fDaily_D2->GetLineColor());
+            f2->SetLineStyle(kDashed);
+            f2->Draw("same");
+        }
+    }
+
+    Double_t MaxY = hDaily->GetMaximum() * 1.2;
+    hDaily->GetYaxis()->SetRangeUser(0,MaxY);
+    hDaily->GetXaxis()->SetRange(DateMin,DateMax);
+
+    // Here, we remove some of the labels, in order to not have more than 40 labels on the graph
+
+    Int_t NBinsInRange = DateMax-DateMin;
+    Int_t Step = NBinsInRange/40;
+    for(int i=1 ; i<=hDaily->GetNbinsX() ; i+=Step) {
+        for(int ii=1 ; ii<Step ; ii++) {
+            if((i+ii) <= hDaily->GetNbinsX()) {
+                hDaily->GetXaxis()->SetBinLabel(i+ii,"");
+            }
+        }
+    }
+
+    // We update the plot and we print all the fit parameters and Chi2 values
+    MyCanvas->cd();
+    MyCanvas->Modified();
+    MyCanvas->Update();
+
+    Float_t XVal = gPad->GetFrame()->GetX1()*1.02;
+    Float_t YVal = gPad->GetFrame()->GetY2()*0.96;
+
+    TLatex *text = PadOwned(new TLatex(XVal,YVal,Form("%s: %s",theCountry.Data(),LastDate.Data())));
+    text->SetTextColor(kBlack);text->Draw();
+    text->SetTextSize(0.05);
+    text->SetTextFont(132);
+    text->Draw();
+
+    YVal = gPad->GetFrame()->GetY2() * 0.95;
+    XVal = gPad->GetFrame()->GetX2() * 0.78;
+    Int_t NDY=0;
+
+    Int_t NFuncs = (fDaily_D!=nullptr)+(fDaily_D2!=nullptr)+(fDaily_ESIR!=nullptr)+(fDaily_ESIR2!=nullptr)+fDaily_Compartmental.size();
+    Float_t DY = gPad->GetFrame()->GetY2()*0.05;
+    Float_t TextSize = 0.04;
+
+    if(NFuncs>2) {
+        TextSize = 0.02;
+        DY = gPad->GetFrame()->GetY2()*0.03;
+        XVal = gPad->GetFrame()->GetX2() * 0.88;
+        YVal = gPad->GetFrame()->GetY2() * 0.97;
+    }
+    else {
+        TextSize = 0.03;
+        DY = gPad->GetFrame()->GetY2()*0.04;
+        XVal = gPad->GetFrame()->GetX2() * 0.83;
+        YVal = gPad->GetFrame()->GetY2() * 0.96;
+    }
+
+    // Print D
+    if(fDaily_D) {
+        TLatex *text = PadOwned(new TLatex(XVal,YVal-DY*NDY,"D' model"));
+        text->SetTextColor(fDaily_D->GetLineColor());text->Draw();
+        text->SetTextFont(132);
+        text->SetTextSize(TextSize+0.01);
+        NDY++;
+
+        text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("a = %.2f #pm %.2f",fDaily_D->GetParameter(0),fDaily_D->GetParError(0))));
+        text->SetTextColor(fDaily_D->GetLineColor());text->Draw();
+        text->SetTextFont(132);
+        text->SetTextSize(TextSize);
+        NDY++;
+        text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b = %.2f #pm %.2f",fDaily_D->GetParameter(1),fDaily_D->GetParError(1))));
+        text->SetTextColor(fDaily_D->GetLineColor());text->Draw();
+        text->SetTextSize(TextSize);
+        text->SetTextFont(132);
+        NDY++;
+        text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("c = %.2e #pm %.2e",fDaily_D->GetParameter(2),fDaily_D->GetParError(2))));
+        text->SetTextColor(fDaily_D->GetLineColor());text->Draw();
+        text->SetTextSize(TextSize);
+        text->SetTextFont(132);
+        NDY++;
+
+        text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("Chi2/ndf = %.2f",fChi2D)));
+        text->SetTextColor(fDaily_D->GetLineColor());text->Draw();
+        text->SetTextSize(TextSize);
+        text->SetTextFont(132);
+        NDY++;
+        NDY++;
+    }
+
+    // Print D2
+    if(fDaily_D2) {
+        if(FullD2) {
+
+            TLatex *text = PadOwned(new TLatex(XVal,YVal-DY*NDY,"D'2 full model"));
+            text->SetTextColor(fDaily_D2->GetLineColor());text->Draw();
+            text->SetTextFont(132);
+            text->SetTextSize(TextSize+0.01);
+            NDY++;
+
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("a1 = %.2f #pm %.2f",fDaily_D2->GetParameter(0),fDaily_D2->GetParError(0))));
+            text->SetTextColor(fDaily_D2->GetLineColor());text->Draw();
+            text->SetTextFont(132);
+            text->SetTextSize(TextSize);
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b1 = %.2f #pm %.2f",fDaily_D2->GetParameter(1),fDaily_D2->GetParError(1))));
+            text->SetTextColor(fDaily_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("c1 = %.2e #pm %.2e",fDaily_D2->GetParameter(2),fDaily_D2->GetParError(2))));
+            text->SetTextColor(fDaily_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("a2 = %.2f #pm %.2f",fDaily_D2->GetParameter(3),fDaily_D2->GetParError(3))));
+            text->SetTextColor(fDaily_D2->GetLineColor());text->Draw();
+            text->SetTextFont(132);
+            text->SetTextSize(TextSize);
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b2 = %.2f #pm %.2f",fDaily_D2->GetParameter(4),fDaily_D2->GetParError(4))));
+            text->SetTextColor(fDaily_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("c2 = %.2e #pm %.2e",fDaily_D2->GetParameter(5),fDaily_D2->GetParError(5))));
+            text->SetTextColor(fDaily_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("Chi2/ndf = %.2f",fChi2D2)));
+            text->SetTextColor(fDaily_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+            NDY++;
+        }
+        else {
+            TLatex *text = PadOwned(new TLatex(XVal,YVal-DY*NDY,"D'2 model"));
+            text->SetTextColor(fDaily_D2->GetLineColor());text->Draw();
+            text->SetTextFont(132);
+            text->SetTextSize(TextSize+0.01);
+            NDY++;
+
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("a = %.2f #pm %.2f",fDaily_D2->GetParameter(0),fDaily_D2->GetParError(0))));
+            text->SetTextColor(fDaily_D2->GetLineColor());text->Draw();
+            text->SetTextFont(132);
+            text->SetTextSize(TextSize);
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b1 = %.2f #pm %.2f",fDaily_D2->GetParameter(1),fDaily_D2->GetParError(1))));
+            text->SetTextColor(fDaily_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b2 = %.2f #pm %.2f",fDaily_D2->GetParameter(3),fDaily_D2->GetParError(3))));
+            text->SetTextColor(fDaily_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("c = %.2e #pm %.2e",fDaily_D2->GetParameter(2),fDaily_D2->GetParError(2))));
+            text->SetTextColor(fDaily_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("Chi2/ndf = %.2f",fChi2D2)));
+            text->SetTextColor(fDaily_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+            NDY++;
+        }
+    }
+
+    // Print ESIR
+    if(fDaily_ESIR) {
+        text = PadOwned(new TLatex(XVal,YVal-DY*NDY,"ESIR model"));
+        text->SetTextColor(fDaily_ESIR->GetLineColor());text->Draw();
+        text->SetTextFont(132);
+        text->SetTextSize(TextSize+0.01);
+        NDY++;
+
+        text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("a = %.2e #pm %.2e",fDaily_ESIR->GetParameter(0),fDaily_ESIR->GetParError(0))));
+        text->SetTextColor(fDaily_ESIR->GetLineColor());text->Draw();
+        text->SetTextSize(TextSize);
+        text->SetTextFont(132);
+
+        NDY++;
+        text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b = %.2f #pm %.2f",fDaily_ESIR->GetParameter(1),fDaily_ESIR->GetParError(1))));
+        text->SetTextColor(fDaily_ESIR->GetLineColor());text->Draw();
+        text->SetTextSize(TextSize);
+        text->SetTextFont(132);
+
+        NDY++;
+        text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("c = %.2e #pm %.2e",fDaily_ESIR->GetParameter(2),fDaily_ESIR->GetParError(2))));
+        text->SetTextColor(fDaily_ESIR->GetLineColor());text->Draw();
+        text->SetTextSize(TextSize);
+        text->SetTextFont(132);
+
+        NDY++;
+        text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("a2 = %.3g #pm %.3g",fDaily_ESIR->GetParameter(3),fDaily_ESIR->GetParError(3))));
+        text->SetTextColor(fDaily_ESIR->GetLineColor());text->Draw();
+        text->SetTextSize(TextSize);
+        text->SetTextFont(132);
+
+        NDY++;
+        text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b2 = %.2e #pm %.2e",fDaily_ESIR->GetParameter(4),fDaily_ESIR->GetParError(4))));
+        text->SetTextColor(fDaily_ESIR->GetLineColor());text->Draw();
+        text->SetTextSize(TextSize);
+        text->SetTextFont(132);
+
+        NDY++;
+        text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("Chi2/ndf = %.2f",fChi2ESIR)));
+        text->SetTextColor(fDaily_ESIR->GetLineColor());text->Draw();
+        text->SetTextSize(TextSize);
+        text->SetTextFont(132);
+
+        NDY++;
+        NDY++;
+    }
+
+    // Print ESIR2
+    if(fDaily_ESIR2) {
+        if(FullESIR2) {
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,"ESIR2 full model"));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextFont(132);
+            text->SetTextSize(TextSize+0.01);
+            NDY++;
+
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("a = %.2e #pm %.2e",fDaily_ESIR2->GetParameter(0),fDaily_ESIR2->GetParError(0))));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b = %.2f #pm %.2f",fDaily_ESIR2->GetParameter(1),fDaily_ESIR2->GetParError(1))));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("c = %.2e #pm %.2e",fDaily_ESIR2->GetParameter(2),fDaily_ESIR2->GetParError(2))));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("a' = %.2e #pm %.2e",fDaily_ESIR2->GetParameter(3),fDaily_ESIR2->GetParError(3))));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b' = %.2f #pm %.2f",fDaily_ESIR2->GetParameter(4),fDaily_ESIR2->GetParError(4))));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("c' = %.2e #pm %.2e",fDaily_ESIR2->GetParameter(5),fDaily_ESIR2->GetParError(5))));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("a2 = %.3g #pm %.3g",fDaily_ESIR2->GetParameter(6),fDaily_ESIR2->GetParError(6))));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b2 = %.2e #pm %.2e",fDaily_ESIR2->GetParameter(7),fDaily_ESIR2->GetParError(7))));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("Chi2/ndf = %.2f",fChi2ESIR2)));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+
+            NDY++;
+            NDY++;
+        }
+        else {
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,"ESIR2 model"));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextFont(132);
+            text->SetTextSize(TextSize+0.01);
+            NDY++;
+
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("a = %.2e #pm %.2e",fDaily_ESIR2->GetParameter(0),fDaily_ESIR2->GetParError(0))));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b = %.2f #pm %.2f",fDaily_ESIR2->GetParameter(1),fDaily_ESIR2->GetParError(1))));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b' = %.2f #pm %.2f",fDaily_ESIR2->GetParameter(2),fDaily_ESIR2->GetParError(2))));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("a2 = %.3g #pm %.3g",fDaily_ESIR2->GetParameter(3),fDaily_ESIR2->GetParError(3))));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b2 = %.2e #pm %.2e",fDaily_ESIR2->GetParameter(4),fDaily_ESIR2->GetParError(4))));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("Chi2/ndf = %.2f",fChi2ESIR2)));
+            text->SetTextColor(fDaily_ESIR2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+
+            NDY++;
+            NDY++;
+        }
+    }
+
+    // Print SIR, SEIRD
+    for(auto &curve : fDaily_Compartmental) {
+        TLatex *text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("%s model",fModelNames[curve.Model])));
+        text->SetTextColor(curve.Func->GetLineColor());text->Draw();
+        text->SetTextFont(132);
+        text->SetTextSize(TextSize+0.01);
+        NDY++;
+
+        const char *Formats[kNCompartmentalPars-1] = {"a = %.3g #pm %.3g","R0 = %.2f #pm %.2f","m = %.2f #pm %.2f","tm = %.1f #pm %.1f","i0 = %.2e #pm %.2e"};
+        for(int ipar=0 ; ipar<kNCompartmentalPars-1 ; ipar++) {
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form(Formats[ipar],curve.Func->GetParameter(ipar),curve.Func->GetParError(ipar))));
+            text->SetTextColor(curve.Func->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+        }
+
+        text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("Chi2/ndf = %.2f",curve.Chi2)));
+        text->SetTextColor(curve.Func->GetLineColor());text->Draw();
+        text->SetTextSize(TextSize);
+        text->SetTextFont(132);
+        NDY++;
+        NDY++;
+    }
+
+    gSystem->mkdir("Pictures");
+    TString OutputFileName = Form("Pictures/covid19_daily_%s_%s",(series.Cases) ? "cases" : "deaths",theCountry.Data());
+    if(series.NSmoothing>1) OutputFileName.Append(Form("_%dDaysSmooth",series.NSmoothing));
+    if(series.Weekly) OutputFileName.Append("_Weekly");
+    OutputFileName.Append(Form("_%s.png",series.Dates.back().Data()));
+    if(timing) StopStage(*timing,kStageDraw,clock);
+
+    clock = StartStage();
+    gPad->GetCanvas()->SaveAs(OutputFileName);
+    if(timing) StopStage(*timing,kStagePicture,clock);
+}
+
+void InitHistograms() {
+
+    delete hDaily_Deaths;
+
+    // the daily deaths histogram has one bin per day, labeled with the dates, for the years 2020 and 2021
+    hDaily_Deaths = BuildDateHistogram("hDaily_Deaths");
+    hDaily_Deaths->GetYaxis()->SetTitle("DEATHS / DAY");
+
+    // These points is used force the function to start and ends at 0.
+    hDaily_Deaths->SetBinContent(1,0.001);
+    hDaily_Deaths->SetBinContent(hDaily_Deaths->GetNbinsX(),0.001);
+}
+
+void SetWaveDetection(Bool_t DoWaves, Double_t MinProminence) {
+    fDoWaveDetection = DoWaves;
+    fWaveMinProminence = MinProminence;
+
+    if(fDoWaveDetection) INFO_MESS << "Waves detection activated, minimal prominence: " << fWaveMinProminence << ENDL;
+    else INFO_MESS << "Waves detection deactivated" << ENDL;
+}
+
+void SetAnomalies(Int_t Mode, Int_t Window, Double_t Threshold) {
+    fAnomalyMode = (Mode>=0 && Mode<kNAnomalyModes) ? Mode : kAnomalyKeep;
+    fAnomalyWindow = max(5,Window);
+    fAnomalyThreshold = Threshold;
+
+    INFO_MESS << "Reporting anomalies " << fAnomalyModeNames[fAnomalyMode] << ": median and MAD on " << fAnomalyWindow << " days, threshold " << fAnomalyThreshold << ENDL;
+}
+
+void SetWeeklyDecomposition(Bool_t DoWeekly, Int_t NIterations) {
+    fDoWeekly = DoWeekly;
+    fWeeklyIterations = max(1,NIterations);
+
+    if(fDoWeekly) INFO_MESS << "Weekday decomposition activated (" << fWeeklyIterations << " iterations), centred smoothing" << ENDL;
+    else INFO_MESS << "Weekday decomposition deactivated" << ENDL;
+}
+
+void SetTimingFile(TString FileName) {
+    fTimingFile = FileName;
+
+    if(fTimingFile!="") INFO_MESS << "Timing of the analyses written in " << fTimingFile << ENDL;
+    else INFO_MESS << "Timing of the analyses not written" << ENDL;
+}
+
+void SetStateFile(TString FileName) {
+    fStateFile = FileName;
+
+    if(fStateFile!="") INFO_MESS << "Analysis state saved in " << fStateFile << ENDL;
+    else INFO_MESS << "Analysis state not saved" << ENDL;
+}
+
+void SetModels(Bool_t DoD, Bool_t DoD2, Bool_t DoESIR, Bool_t DoESIR2, Bool_t FullModel, Bool_t DoSIR, Bool_t DoSEIRD) {
+    fDoFullModel = FullModel;
+    fDoD = DoD;
+    fDoD2 = DoD2;
+    fDoESIR = DoESIR;
+    fDoESIR2 = DoESIR2;
+    fDoSIR = DoSIR;
+    fDoSEIRD = DoSEIRD;
+
+    INFO_MESS << "Models parameters: ";
+    if(fDoD) cout << " D': On ";
+    if(fDoD2) cout << " D2': On ";
+    if(fDoESIR) cout << " ESIR: On ";
+    if(fDoESIR2) cout << " ESIR2: On ";
+    if(fDoSIR) cout << " SIR: On ";
+    if(fDoSEIRD) cout << " SEIRD: On ";
+    if(fDoFullModel) cout << " ==> Full parameters mode activated";
+    cout << ENDL;
+}
+
+void SetCompartmental(Double_t IncubationDays, Double_t InfectiousDays, Double_t ReductionDays, Double_t Tolerance) {
+    fIncubationDays = max(IncubationDays,0.1);
+    fInfectiousDays = max(InfectiousDays,0.1);
+    fReductionDays = max(ReductionDays,0.1);
+    fODETolerance = min(max(Tolerance,1e-12),1e-2);
+
+    INFO_MESS << Form("Compartmental models: incubation %.1f days, infectious %.1f days, reduction of the transmission over %.1f days, tolerance %g",
+                      fIncubationDays,fInfectiousDays,fReductionDays,fODETolerance) << ENDL;
+}
+
+void PrintParameters(TString country_name) {
+
+    INFO_MESS << "Analyse data from: " << country_name << ENDL << ENDL;
+
+    INFO_MESS << "Models parameters: ";
+    if(fDoD) cout << " D': On ";
+    if(fDoD2) cout << " D2': On ";
+    if(fDoESIR) cout << " ESIR: On ";
+    if(fDoESIR2) cout << " ESIR2: On ";
+    if(fDoSIR) cout << " SIR: On ";
+    if(fDoSEIRD) cout << " SEIRD: On ";
+    if(fDoFullModel) cout << " ==> Full parameters mode activated";
+    cout << ENDL;
+
+    PrintRanges();
+
+    if(fDoWaveDetection) INFO_MESS << "Waves detection activated, minimal prominence: " << fWaveMinProminence << ENDL;
+    if(fDoWeekly) INFO_MESS << "Weekday decomposition activated, centred smoothing" << ENDL;
+    if(fAnomalyMode != kAnomalyKeep) INFO_MESS << "Reporting anomalies " << fAnomalyModeNames[fAnomalyMode] << ENDL;
+
+    if(fHeadless) return;
+
+    INFO_MESS << "Press a key to continue"<< ENDL;
+    cin.get();
+}
+
+bool ReadData(TString filename)
+{
+    // The vectors containing data are cleared from previous use
+    vDaily_Deaths.clear();
+    vDaily_Deaths_error.clear();
+
+    return ReadData(filename,vDates,vTotal_Deaths);
+}
+
+void DetectWaves(const vector<Double_t> &data, vector<Wave> &waves, Double_t MinProminence)
+{
+    waves.clear();
+
+    Int_t N = data.size();
+    if(N<3) return;
+
+    // sparse table giving the position of the minimum of any range [i,j] in O(1), built in O(n log n)
+    vector<Int_t> Log2(N+1,0);
+    for(int i=2 ; i<=N ; i++) Log2.at(i) = Log2.at(i/2)+1;
+
+    vector< vector<Int_t> > MinTable(Log2.at(N)+1);
+    MinTable.at(0).resize(N);
+    for(int i=0 ; i<N ; i++) MinTable.at(0).at(i) = i;
+    for(int k=1 ; k<=Log2.at(N) ; k++) {
+        MinTable.at(k).resize(N-(1<<k)+1);
+        for(size_t i=0 ; i<MinTable.at(k).size() ; i++) {
+            Int_t Left = MinTable.at(k-1).at(i);
+            Int_t Right = MinTable.at(k-1).at(i+(1<<(k-1)));
+            MinTable.at(k).at(i) = (data.at(Right)<data.at(Left)) ? Right : Left;
+        }
+    }
+    auto ArgMin = [&](Int_t i, Int_t j) {
+        Int_t k = Log2.at(j-i+1);
+        Int_t Left = MinTable.at(k).at(i);
+        Int_t Right = MinTable.at(k).at(j-(1<<k)+1);
+        return (data.at(Right)<data.at(Left)) ? Right : Left;
+    };
+
+    // for each point, the nearest higher points on the left and on the right are found with a monotonic stack, in O(n)
+    vector<Int_t> HigherLeft(N,-1), HigherRight(N,N);
+    vector<Int_t> Stack;
+    for(int i=0 ; i<N ; i++) {
+        while(!Stack.empty() && data.at(Stack.back())<=data.at(i)) {
+            HigherRight.at(Stack.back()) = i;
+            Stack.pop_back();
+        }
+        if(!Stack.empty()) HigherLeft.at(i) = Stack.back();
+        Stack.push_back(i);
+    }
+
+    // the peaks are the local maxima with a prominence higher than the requested fraction of the data maximum
+    Double_t DataMax = data.at(0);
+    for(int i=1 ; i<N ; i++) DataMax = max(DataMax,data.at(i));
+    if(DataMax<=0.) return;
+
+    vector<Int_t> Peaks;
+    vector<Double_t> Prominences;
+    for(int i=1 ; i<N-1 ; i++) {
+        if(!(data.at(i)>data.at(i-1) && data.at(i)>=data.at(i+1))) continue;
+
+        // the prominence is the height above the highest of the minima found up to the nearest higher points
+        Double_t LeftBase = data.at(ArgMin(HigherLeft.at(i)+1,i));
+        Double_t RightBase = data.at(ArgMin(i,HigherRight.at(i)-1));
+        Double_t Prominence = data.at(i) - max(LeftBase,RightBase);
+
+        if(Prominence >= MinProminence*DataMax) {
+            Peaks.push_back(i);
+            Prominences.push_back(Prominence);
+        }
+    }
+
+    // the waves are then delimited by the minima between two successive peaks
+    for(size_t ipeak=0 ; ipeak<Peaks.size() ; ipeak++) {
+        Wave wave;
+        wave.Peak = Peaks.at(ipeak);
+        wave.Height = data.at(wave.Peak);
+        wave.Prominence = Prominences.at(ipeak);
+
+        if(ipeak==0) {
+            wave.Onset = ArgMin(0,wave.Peak);
+            // in case of a flat start (no data, or not yet smoothed), the onset is the last point of the plateau
+            while(wave.Onset+1<wave.Peak && data.at(wave.Onset+1)==data.at(wave.Onset)) wave.Onset++;
+        }
+        else wave.Onset = waves.back().End;
+
+        if(ipeak+1<Peaks.size()) wave.End = ArgMin(wave.Peak,Peaks.at(ipeak+1));
+        else wave.End = ArgMin(wave.Peak,N-1);
+
+        // the area is estimated from the rising edge only, to be valid also for a wave still going on
+        Double_t RiseArea = 0.;
+        for(int i=wave.Onset ; i<=wave.Peak ; i++) RiseArea += data.at(i);
+        wave.Area = 2*RiseArea - wave.Height;
+
+        Int_t HalfHeight = wave.Peak;
+        while(HalfHeight>wave.Onset && data.at(HalfHeight)>0.5*wave.Height) HalfHeight--;
+        wave.RiseWidth = max(1,wave.Peak-HalfHeight);
+
+        waves.push_back(wave);
+    }
+}
+
+Bool_t GetWaveParameters(const Series &series, size_t iwave, Double_t t0, Double_t &a, Double_t &b, Double_t &c)
+{
+    if(iwave>=series.Waves.size()) return false;
+
+    const Wave &wave = series.Waves.at(iwave);
+    if(series.Bins.at(wave.Peak)<=0) return false;
+
+    // The D function is a logistic derivative: the half height is reached at 1.7627*b before the peak,
+    // the peak is at t0 + b*ln(1/c), and the integral is a/c
+    b = wave.RiseWidth/1.7627;
+    c = TMath::Exp(-(BinToX(series.Bins.at(wave.Peak))-t0)/b);
+    a = c*wave.Area;
+
+    return true;
+}
+
+void ClampParameters(TF1 *func)
+{
+    for(int ipar=0 ; ipar<func->GetNpar() ; ipar++) {
+        Double_t Min,Max;
+        func->GetParLimits(ipar,Min,Max);
+        // fixed or unbounded parameters are not modified
+        if(Min>=Max) continue;
+
+        // the parameters are not put exactly on the limits, where Minuit cannot move them
+        Double_t Value = func->GetParameter(ipar);
+        if(Value<Min) func->SetParameter(ipar,Min+1e-3*(Max-Min));
+        else if(Value>Max) func->SetParameter(ipar,Max-1e-3*(Max-Min));
+    }
+}
+
+bool LoadSeries(TString theCountry, Series &series)
+{
+    TString FileName = GetDataFileName(theCountry);
+
+    series = Series();
+    series.Country = theCountry;
+
+    // now, the data file is read using the ReadData function
+    bool data_ok = ReadData(FileName,series.Dates,series.Total_Deaths,&series.BytesRead);
+    if(data_ok == false) return false;
+
+    return BuildSeries(series);
+}
+
+bool LoadSeries(TString theCountry, Series &deaths, Series &cases)
+{
+    TString FileName = GetDataFileName(theCountry);
+
+    deaths = Series();
+    deaths.Country = theCountry;
+    cases = Series();
+
+    // the deaths and the cases are read in the same parse of the file
+    vector<TString> case_dates;
+    vector<Double_t> total_cases;
+    bool data_ok = ReadData(FileName,fReadDataFrom,fReadDataTo,deaths.Dates,deaths.Total_Deaths,case_dates,total_cases,&deaths.BytesRead);
+    if(data_ok == false || BuildSeries(deaths) == false) return false;
+
+    BuildCaseSeries(theCountry,case_dates,total_cases,deaths,cases);
+
+    return true;
+}
+
+bool BuildCaseSeries(TString theCountry, const vector<TString> &dates, const vector<Double_t> &total_cases, const Series &deaths, Series &cases)
+{
+    cases = Series();
+    cases.Country = theCountry;
+    cases.Cases = true;
+    if(dates.empty()) return false;
+
+    // the cases start with the same minimal number as the deaths
+    cases.Dates = dates;
+    cases.Total_Deaths = total_cases;
+    if(!BuildSeries(cases)) return false;
+
+    if(!deaths.Total_Deaths.empty() && deaths.Total_Deaths.back()>0) cases.Scale = max(1.,cases.Total_Deaths.back()/deaths.Total_Deaths.back());
+
+    return true;
+}
+
+bool BuildSeries(Series &series)
+{
+    // we remove the first possible data points that are bellow the defined threshold
+    while(!series.Total_Deaths.empty() && series.Total_Deaths.front()<DeathsMin) {
+        series.Dates.erase(series.Dates.begin());
+        series.Total_Deaths.erase(series.Total_Deaths.begin());
+    }
+
+    // if no data has been read, we exit
+    if(series.Total_Deaths.empty()) {
+        cout<<"OUPS, empty data"<<endl;
+        return false;
+    }
+
+    // now, we calculate the daily data as the difference between two successive days
+    series.Raw_Daily_Deaths.push_back(series.Total_Deaths.front());
+    for(size_t i=1 ; i<series.Dates.size() ; i++) {
+        if(series.Total_Deaths.at(i)>0) series.Raw_Daily_Deaths.push_back(series.Total_Deaths.at(i)-series.Total_Deaths.at(i-1));
+    }
+
+    // the backlog dumps and the downward revisions are recorded, and corrected before the smoothing if asked
+    DetectAnomalies(series.Raw_Daily_Deaths,fAnomalyWindow,fAnomalyThreshold,series.Anomalies);
+    CorrectAnomalies(series.Raw_Daily_Deaths,series.Anomalies,fAnomalyMode,fAnomalyWindow);
+
+    // the histogram bins of each date are stored, as well as the prefix sums used to smooth the data with any window
+    for(size_t i=0 ; i<series.Dates.size() ; i++) series.Bins.push_back(GetDateBin(series.Dates.at(i)));
+    BuildPrefixSums(series.Raw_Daily_Deaths,series.Prefix_Sum,series.Prefix_NPoints);
+
+    return true;
+}
+
+// weekday of the first daily value of a series, taken from the first date in the histogram, the days being consecutive
+static Int_t GetFirstWeekday(const Series &series)
+{
+    for(size_t i=0 ; i<series.Bins.size() ; i++) {
+        if(series.Bins.at(i)>0) return GetBinWeekday(series.Bins.at(i)-i);
+    }
+    return 0;
+}
+
+void SmoothSeries(Series &series, Int_t N)
+{
+    series.NSmoothing = N;
+    series.Weekly = fDoWeekly;
+    series.Weekday_Factors.clear();
+    if(!fDoWeekly) SmoothFromPrefixSums(N,series.Prefix_Sum,series.Prefix_NPoints,series.Daily_Deaths,series.Daily_Deaths_error);
+    else {
+        Int_t FirstWeekday = GetFirstWeekday(series);
+        // the data corrected by the weekday factors have no weekly cycle any more, the smoothing is centred to keep them in time
+        vector<Double_t> Trend, Adjusted, Sum, NPoints;
+        DecomposeWeekly(series.Raw_Daily_Deaths,FirstWeekday,fWeeklyIterations,series.Weekday_Factors,Trend,Adjusted);
+        BuildPrefixSums(Adjusted,Sum,NPoints);
+        SmoothFromPrefixSums(N,Sum,NPoints,series.Daily_Deaths,series.Daily_Deaths_error,true);
+    }
+
+    // the waves are searched in the smoothed data, to define the default fit range, t0 and the initial parameters
+    series.Waves.clear();
+    if(fDoWaveDetection) DetectWaves(series.Daily_Deaths,series.Waves,fWaveMinProminence);
+}
+
+Int_t CountAnomalies(const Series &series, Int_t XMin, Int_t XMax)
+{
+    Int_t NAnomalies = 0;
+    for(auto &anomaly : series.Anomalies) {
+        Int_t Bin = series.Bins.at(min(anomaly.Index,(Int_t)series.Bins.size()-1));
+        if(Bin>=XMin && Bin<=XMax) NAnomalies++;
+    }
+    return NAnomalies;
+}
+
+void PrintAnomalies(const AnalysisResult &result)
+{
+    for(const Series *series : {&result.Data,&result.Cases}) {
+        for(auto &anomaly : series->Anomalies) {
+            WARN_MESS << series->Country << ((series->Cases) ? " cases" : "") << ": " << fAnomalyNames[anomaly.Type] << " on " << series->Dates.at(min(anomaly.Index,(Int_t)series->Dates.size()-1));
+            cout << Form(", %g reported for %.1f expected (score %.1f), ",anomaly.Value,anomaly.Expected,anomaly.Score) << fAnomalyModeNames[anomaly.Mode];
+            if(anomaly.Unabsorbed<0.) cout << Form(", %g not absorbed by the previous days",-anomaly.Unabsorbed);
+            cout << ENDL;
+        }
+    }
+
+    // the fits which failed with anomalies in their range are pointed out
+    auto CheckFits = [&](const Series &series, const vector<ModelFit> &fits) {
+        for(auto &fit : fits) {
+            Int_t NAnomalies = CountAnomalies(series,fit.XMin,fit.XMax);
+            if(fit.Valid || NAnomalies == 0) continue;
+            WARN_MESS << fModelNames[fit.Model] << " fit of " << series.Country << ((series.Cases) ? " cases" : "") << " NOT valid with " << NAnomalies;
+            cout << " reporting anomalies " << fAnomalyModeNames[fAnomalyMode] << " in its range" << ((fAnomalyMode == kAnomalyKeep) ? ", try to exclude or redistribute them" : "") << ENDL;
+        }
+    };
+    CheckFits(result.Data,result.Fits);
+    CheckFits(result.Cases,result.CaseFits);
+}
+
+Int_t GetBinWeekday(Int_t Bin)
+{
+    // bin 1 is the Wednesday 1-Jan-20
+    return ((Bin+1)%7+7)%7;
+}
+
+void PrintWeekdayFactors(const Series &series)
+{
+    if(!series.Weekly || series.Weekday_Factors.size() != 7) return;
+
+    const char *Days[7] = {"Mon","Tue","Wed","Thu","Fri","Sat","Sun"};
+    INFO_MESS << "Weekday factors of " << series.Country << ((series.Cases) ? " (cases):" : ":");
+    for(int day=0 ; day<7 ; day++) cout << " " << Days[day] << Form(" %.2f",series.Weekday_Factors.at(day));
+    cout << ENDL;
+}
+
+void GetAxisRange(const Series &series, Int_t &DateMin, Int_t &DateMax)
+{
+    Int_t NBins = GetDateBin("31-Dec-21");
+
+    if(fAxisRangeFrom=="") DateMin = max(1,series.Bins.front()-5);
+    else DateMin = GetDateBin(fAxisRangeFrom);
+    if(fAxisRangeTo=="") DateMax = min(NBins,series.Bins.back()+5);
+    else DateMax = GetDateBin(fAxisRangeTo);
+}
+
+void GetFitRange(const Series &series, TString DateFrom, TString DateTo, Int_t &XMin, Int_t &XMax)
+{
+    Int_t DateMin,DateMax;
+    GetAxisRange(series,DateMin,DateMax);
+
+    // if not defined by the user, the fit starts at the onset of the first wave, and stops
+    // after the second one, as the models cannot describe more than two waves
+    if(DateFrom!="") XMin = GetDateBin(DateFrom);
+    else if(!series.Waves.empty() && series.Bins.at(series.Waves.front().Onset)>0) XMin = series.Bins.at(series.Waves.front().Onset);
+    else XMin = DateMin;
+    if(DateTo!="") XMax = GetDateBin(DateTo);
+    else if(series.Waves.size()>2 && series.Bins.at(series.Waves.at(1).End)>XMin) XMax = series.Bins.at(series.Waves.at(1).End);
+    else XMax = DateMax;
+}
+
+TF1 *InitModel(Int_t Model, Bool_t FullModel, TString Name, Double_t t0, const Series &series)
+{
+    // the functions are not added to the ROOT list of functions, to be able to build them in parallel threads
+    Double_t XLow = 0.;
+    Double_t XHigh = GetDateBin("31-Dec-21");
+
+    TF1 *func = nullptr;
+    Double_t a,b,c;
+
+    if(Model == kModelD) {
+        func = new TF1(Name,FuncD,XLow,XHigh,4,1,TF1::EAddToList::kNo);
+        func->SetParNames("a","b","c","t0");
+
+        // parameters initialization
+        func->SetParameter(0,50);
+        func->SetParameter(1,4.);
+        func->SetParameter(2,1e-3);
+        func->FixParameter(3,t0);
+
+        func->SetParLimits(0,0,1000);
+        func->SetParLimits(1,1.,20.);
+        func->SetParLimits(2,1e-6,1);
+
+        // if waves have been found, the initial parameters are estimated from the first one
+        if(GetWaveParameters(series,0,t0,a,b,c)) {
+            func->SetParameter(0,a);
+            func->SetParameter(1,b);
+            func->SetParameter(2,c);
+        }
+    }
+    else if(Model == kModelD2 && FullModel) {
+        func = new TF1(Name,FuncD2Full,XLow,XHigh,7,1,TF1::EAddToList::kNo);
+        func->SetParNames("a1","b1","c1","a2","b2","c2","t0");
+
+        func->SetParameter(0,50);
+        func->SetParameter(1,4.);
+        func->SetParameter(2,1e-3);
+        func->SetParameter(3,50);
+        func->SetParameter(4,10.);
+        func->SetParameter(5,1e-3);
+        func->FixParameter(6,t0);
+
+        func->SetParLimits(0,1,1000);
+        func->SetParLimits(1,1.,50.);
+        func->SetParLimits(2,1e-6,1);
+        func->SetParLimits(3,0,1000);
+        func->SetParLimits(4,1.,50.);
+        func->SetParLimits(5,1e-6,1);
+
+        // if waves have been found, the initial parameters are estimated from the first two ones
+        if(GetWaveParameters(series,0,t0,a,b,c)) {
+            func->SetParameter(0,a);
+            func->SetParameter(1,b);
+            func->SetParameter(2,c);
+        }
+        if(GetWaveParameters(series,1,t0,a,b,c)) {
+            func->SetParameter(3,a);
+            func->SetParameter(4,b);
+            func->SetParameter(5,c);
+        }
+    }
+    else if(Model == kModelD2) {
+        func = new TF1(Name,FuncD2,XLow,XHigh,5,1,TF1::EAddToList::kNo);
+        func->SetParNames("a","b1","c","b2","t0");
+
+        func->SetParameter(0,50);
+        func->SetParameter(1,4.);
+        func->SetParameter(2,1e-3);
+        func->SetParameter(3,7);
+        func->FixParameter(4,t0);
+
+        func->SetParLimits(0,0,1000);
+        func->SetParLimits(1,1.,50.);
+        func->SetParLimits(2,1e-6,1);
+        func->SetParLimits(3,3,50);
+
+        // if waves have been found, the time scales are estimated from the first two ones
+        if(GetWaveParameters(series,0,t0,a,b,c)) func->SetParameter(1,b);
+        if(GetWaveParameters(series,1,t0,a,b,c)) func->SetParameter(3,b);
+    }
+    else if(Model == kModelESIR) {
+        func = new TF1(Name,FuncESIR,XLow,XHigh,6,1,TF1::EAddToList::kNo);
+        func->SetParNames("a","b","c","a2","b2","t0");
+
+        func->SetParameter(0,5e-6);
+        func->SetParameter(1,10.);
+        func->SetParameter(2,5e-6);
+        func->SetParameter(3,500.);
+        func->SetParameter(4,1e-4);
+        func->FixParameter(5,t0);
+
+        func->SetParLimits(0,1e-15,1e-5);
+        func->SetParLimits(1,1.,50.);
+        func->SetParLimits(2,1e-15,1e-5);
+        func->SetParLimits(3,1e1,1e7);
+        func->SetParLimits(4,1e-8,0.1);
+
+        // if waves have been found, the time scale is estimated from the first one
+        if(GetWaveParameters(series,0,t0,a,b,c)) func->SetParameter(1,b);
+    }
+    else if(Model == kModelESIR2 && FullModel) {
+        func = new TF1(Name,FuncESIR2Full,XLow,XHigh,9,1,TF1::EAddToList::kNo);
+        func->SetParNames("a","b","c","a'","b'","c'","a2","b2","t0");
+
+        func->SetParameter(0,5e-6);
+        func->SetParameter(1,5.);
+        func->SetParameter(2,5e-6);
+        func->SetParameter(3,5e-6);
+        func->SetParameter(4,15.);
+        func->SetParameter(5,5e-6);
+        func->SetParameter(6,500.);
+        func->SetParameter(7,1e-4);
+        func->FixParameter(8,t0);
+
+        func->SetParLimits(0,1e-15,1e-2);
+        func->SetParLimits(1,1.,50.);
+        func->SetParLimits(2,1e-15,1e-2);
+        func->SetParLimits(3,1e-15,1e-2);
+        func->SetParLimits(4,1.,50.);
+        func->SetParLimits(5,1e-15,1e-2);
+        func->SetParLimits(6,1e1,1e7);
+        func->SetParLimits(7,1e-15,1e-1);
+
+        // if waves have been found, the time scales are estimated from the first two ones
+        if(GetWaveParameters(series,0,t0,a,b,c)) func->SetParameter(1,b);
+        if(GetWaveParameters(series,1,t0,a,b,c)) func->SetParameter(4,b);
+    }
+    else if(Model == kModelESIR2) {
+        func = new TF1(Name,FuncESIR2,XLow,XHigh,6,1,TF1::EAddToList::kNo);
+        func->SetParNames("a","b","b'","a2","b2","t0");
+
+        func->SetParameter(0,5e-6);
+        func->SetParameter(1,5.);
+        func->SetParameter(2,15.);
+        func->SetParameter(3,500.);
+        func->SetParameter(4,1e-4);
+        func->FixParameter(5,t0);
+
+        func->SetParLimits(0,1e-15,1e-2);
+        func->SetParLimits(1,1.,50.);
+        func->SetParLimits(2,1.,50.);
+        func->SetParLimits(3,1e1,1e7);
+        func->SetParLimits(4,1e-8,0.1);
+
+        // if waves have been found, the time scales are estimated from the first two ones
+        if(GetWaveParameters(series,0,t0,a,b,c)) func->SetParameter(1,b);
+        if(GetWaveParameters(series,1,t0,a,b,c)) func->SetParameter(2,b);
+    }
+    else if(IsCompartmental(Model)) {
+        func = new TF1(Name,CompartmentalFunctor(Model,XHigh),XLow,XHigh,kNCompartmentalPars,1,TF1::EAddToList::kNo);
+        func->SetParNames("a","R0","m","tm","i0","t0");
+
+        // a is the number of deaths if the whole population were infected: about twice the deaths of the first wave
+        Double_t Deaths = (series.Waves.empty()) ? 1e3 : max(1.,series.Waves.front().Area);
+        func->SetParameter(0,2*Deaths);
+        func->SetParameter(1,2.5);
+        func->SetParameter(2,0.5);
+        func->SetParameter(3,30.);
+        func->SetParameter(4,1e-5);
+        func->FixParameter(5,t0);
+
+        func->SetParLimits(0,1.,1e8);
+        func->SetParLimits(1,0.5,10.);
+        func->SetParLimits(2,0.,0.99);
+        func->SetParLimits(3,0.,XHigh-t0);
+        func->SetParLimits(4,1e-10,1e-2);
+
+        // the transmission is reduced before the peak of the first wave, by about the delay between infection and death,
+        // and the initial infectious fraction gives the daily deaths at t0 (a*i0/T_inf)
+        if(!series.Waves.empty() && series.Bins.at(series.Waves.front().Peak)>0)
+            func->SetParameter(3,BinToX(series.Bins.at(series.Waves.front().Peak))-t0-fIncubationDays-fInfectiousDays);
+        for(size_t i=0 ; i<series.Bins.size() && i<series.Daily_Deaths.size() ; i++) {
+            if(series.Bins.at(i) == (Int_t)t0 && series.Daily_Deaths.at(i)>0.) func->SetParameter(4,series.Daily_Deaths.at(i)*fInfectiousDays/(2*Deaths));
+        }
+    }
+    else return nullptr;
+
+    // the cases are larger than the deaths by about the number of cases per death: the limits of the amplitudes are scaled,
+    // as well as the initial amplitude of the ESIR models, which is not estimated from the waves
+    if(series.Scale > 1.) {
+        vector<TString> Amplitudes = {"a2"};
+        if(Model == kModelD || Model == kModelD2 || IsCompartmental(Model)) Amplitudes = {"a","a1","a2"};
+        for(auto &name : Amplitudes) {
+            Int_t ipar = func->GetParNumber(name);
+            if(ipar < 0) continue;
+            Double_t Min,Max;
+            func->GetParLimits(ipar,Min,Max);
+            func->SetParLimits(ipar,Min,Max*series.Scale);
+            if(Model == kModelESIR || Model == kModelESIR2) func->SetParameter(ipar,func->GetParameter(ipar)*series.Scale);
+        }
+    }
+
+    func->SetLineColor(fColors[Model]);
+    func->SetNpx(1000);
+
+    ClampParameters(func);
+
+    return func;
+}
+
+vector<Int_t> GetModels()
+{
+    vector<Int_t> Models;
+    if(fDoD) Models.push_back(kModelD);
+    if(fDoD2) Models.push_back(kModelD2);
+    if(fDoESIR) Models.push_back(kModelESIR);
+    if(fDoESIR2) Models.push_back(kModelESIR2);
+    if(fDoSIR) Models.push_back(kModelSIR);
+    if(fDoSEIRD) Models.push_back(kModelSEIRD);
+
+    return Models;
+}
+
+Bool_t IsCompartmental(Int_t Model)
+{
+    return (Model == kModelSIR || Model == kModelSEIRD);
+}
+
+TString GetCompartmentalKey(Int_t Model)
+{
+    if(!IsCompartmental(Model)) return "";
+    return Form("_%g_%g_%g_%g",fIncubationDays,fInfectiousDays,fReductionDays,fODETolerance);
+}
+
+void ConfigureMinimizer(ROOT::Fit::Fitter &fitter)
+{
+    // the options are given to each fitter, and not as ROOT defaults, to be able to fit in parallel threads
+    ROOT::Math::MinimizerOptions &options = fitter.Config().MinimizerOptions();
+    fitter.Config().SetMinimizer("Minuit2","Migrad");
+    options.SetMaxFunctionCalls(kMaxInt);
+    options.SetErrorDef(2);
+    //    options.SetTolerance(1e-3);
+    //    options.SetPrecision(1e-9);
+
+    // the Minuit warnings are not printed in headless mode
+    if(fHeadless) options.SetPrintLevel(-1);
+}
+
+void FillFitData(const Series &series, Int_t XMin, Int_t XMax, ROOT::Fit::BinData &data)
+{
+    // the data are first put on the histogram bins of the fit range, the bins without data are empty
+    vector<Double_t> Values(max(0,XMax-XMin+1),0.);
+    vector<Double_t> Errors(Values.size(),0.);
+    for(size_t i=0 ; i<series.Dates.size() && i<series.Daily_Deaths.size() ; i++) {
+        if(series.Daily_Deaths.at(i) && series.Bins.at(i)>=XMin && series.Bins.at(i)<=XMax) {
+            Values.at(series.Bins.at(i)-XMin) = series.Daily_Deaths.at(i);
+            Errors.at(series.Bins.at(i)-XMin) = series.Daily_Deaths_error.at(i);
+        }
+    }
+
+    // the points without errors are not taken into account by the chi2, as in the fit of a TGraphErrors
+    data.Initialize(Values.size()+1,1,ROOT::Fit::BinData::kValueError);
+    Double_t xMax=0.;
+    Double_t yMax=0.;
+    for(size_t i=0 ; i<Values.size() ; i++) {
+        if(Errors.at(i)>0.) data.Add(BinToX(XMin+i),Values.at(i),Errors.at(i));
+        if(Values.at(i)>yMax) {
+            yMax = Values.at(i);
+            xMax = BinToX(XMin+i);
+        }
+    }
+    // Add a dummy point at 5* the current max (to force to be at 0 for t infinity)
+    data.Add(5*xMax,0.,1.);
+}
+
+Bool_t FitModel(Int_t Model, const Series &series, Int_t XMin, Int_t XMax, ModelFit &fit, const ModelFit *start, Bool_t ComputeBand, Timing *timing)
+{
+    return FitModel(Model,fDoFullModel,series,XMin,XMax,fit,start,ComputeBand,timing);
+}
+
+Bool_t FitModel(Int_t Model, Bool_t FullModel, const Series &series, Int_t XMin, Int_t XMax, ModelFit &fit, const ModelFit *start, Bool_t ComputeBand, Timing *timing)
+{
+    StageClock clock = StartStage();
+
+    fit = ModelFit();
+    fit.Model = Model;
+    fit.FullModel = FullModel;
+    fit.XMin = XMin;
+    fit.XMax = XMax;
+
+    ROOT::Fit::BinData data;
+    FillFitData(series,XMin,XMax,data);
+
+    unique_ptr<TF1> func(InitModel(Model,fit.FullModel,Form("%s_%s_%d_%d",fModelNames[Model],series.Country.Data(),XMin,XMax),XMin,series));
+    if(func == nullptr) return false;
+
+    // warm start from a previous fit of the same model, t0 being fixed to the new fit range
+    if(start && start->Valid && start->Model == Model && start->FullModel == fit.FullModel) {
+        for(int ipar=0 ; ipar<func->GetNpar()-1 ; ipar++) func->SetParameter(ipar,start->Pars.at(ipar));
+        ClampParameters(func.get());
+    }
+
+    ROOT::Math::WrappedMultiTF1 wfunc(*func,1);
+    ROOT::Fit::Fitter fitter;
+    ConfigureMinimizer(fitter);
+    // the gradient of the chi2 of the compartmental models is given to Minuit, from the sensitivities of the integration
+    // (the model being only integrated up to one day after the fit range)
+    if(IsCompartmental(Model)) fitter.SetFunction(CompartmentalFunction(Model,BinToX(XMax)+1.),true);
+    else fitter.SetFunction(wfunc,false);
+    fitter.Config().SetParamsSettings(func->GetNpar(),func->GetParameters());
+    for(int ipar=0 ; ipar<func->GetNpar() ; ipar++) {
+        fitter.Config().ParSettings(ipar).SetName(func->GetParName(ipar));
+        fit.ParNames.push_back(func->GetParName(ipar));
+
+        // same convention as TF1: equal limits mean a fixed parameter
+        Double_t Min,Max;
+        func->GetParLimits(ipar,Min,Max);
+        if(Min*Max != 0 && Min >= Max) fitter.Config().ParSettings(ipar).Fix();
+        else if(Min < Max) fitter.Config().ParSettings(ipar).SetLimits(Min,Max);
+    }
+
+    fitter.Fit(data);
+
+    const ROOT::Fit::FitResult &result = fitter.Result();
+    if(result.IsEmpty()) return false;
+
+    Int_t NPars = result.NPar();
+    fit.Pars = result.Parameters();
+    fit.Errors = result.Errors();
+    fit.Covariance.assign(NPars*NPars,0.);
+    for(int i=0 ; i<NPars ; i++) {
+        for(int j=0 ; j<NPars ; j++) fit.Covariance.at(i*NPars+j) = result.CovMatrix(i,j);
+    }
+    fit.Chi2 = result.Chi2();
+    fit.Ndf = result.Ndf();
+    fit.Status = result.Status();
+    fit.Valid = result.IsValid();
+    fit.NCalls = result.NCalls();
+    if(fitter.GetMinimizer()) fit.NIterations = fitter.GetMinimizer()->NIterations();
+    fit.CovStatus = result.CovMatrixStatus();
+
+    // the time of the fit is kept with the fit, and added to the analysis timing
+    Timing FitTiming;
+    StopStage(FitTiming,kStageFit,clock);
+    fit.RealTime = FitTiming.RealTime[kStageFit];
+    if(timing) {
+        timing->RealTime[kStageFit] += FitTiming.RealTime[kStageFit];
+        timing->CpuTime[kStageFit] += FitTiming.CpuTime[kStageFit];
+    }
+
+    // the fitted function and its 95% confidence interval are computed for all the histogram bins,
+    // the interval being scaled by sqrt(chi2/ndf) as done by TVirtualFitter::GetConfidenceIntervals
+    if(ComputeBand) {
+        clock = StartStage();
+        Int_t NBins = GetDateBin("31-Dec-21");
+        vector<Double_t> X(NBins);
+        for(int ibin=1 ; ibin<=NBins ; ibin++) X.at(ibin-1) = BinToX(ibin);
+
+        fit.Band.resize(NBins);
+        fit.Band_error.resize(NBins);
+        if(IsCompartmental(Model)) {
+            // the exact gradients are propagated with the same normalisation, instead of the numerical derivatives of
+            // GetConfidenceIntervals which would integrate the model several times per bin and parameter
+            CompartmentalFunction model(Model,NBins,true);
+            Double_t Quantile = (fit.Ndf>0) ? TMath::StudentQuantile(0.975,fit.Ndf)*sqrt(fit.Chi2/fit.Ndf) : 0.;
+            vector<Double_t> Gradient(NPars);
+            for(int i=0 ; i<NBins ; i++) {
+                fit.Band.at(i) = model(&X.at(i),fit.Pars.data());
+                model.ParameterGradient(&X.at(i),fit.Pars.data(),Gradient.data());
+                Double_t Variance = 0.;
+                for(int ipar=0 ; ipar<NPars ; ipar++) {
+                    for(int jpar=0 ; jpar<NPars ; jpar++) Variance += Gradient.at(ipar)*fit.Covariance.at(ipar*NPars+jpar)*Gradient.at(jpar);
+                }
+                fit.Band_error.at(i) = Quantile*sqrt(max(0.,Variance));
+            }
+        }
+        else {
+            for(int i=0 ; i<NBins ; i++) fit.Band.at(i) = func->EvalPar(&X.at(i),fit.Pars.data());
+            result.GetConfidenceIntervals(NBins,1,1,X.data(),fit.Band_error.data(),0.95,true);
+        }
+        if(timing) StopStage(*timing,kStageBand,clock);
+    }
+
+    return fit.Valid;
+}
+
+// right-hand side of the compartmental equations, and of their forward sensitivities, for all the parameter sets of a batch
+// at the time t (days after t0). The values are stored as Y[irow*NSets+k], the NComp compartments (s,i) or (s,e,i) being
+// followed, with the sensitivities, by their derivatives with respect to R0, m, tm and i0
+static void CompartmentalDerivatives(const CompartmentalBatch &batch, Int_t NComp, Double_t t, const Double_t *Y, Double_t *F)
+{
+    Int_t N = batch.NSets;
+    Int_t I = NComp-1;                      // infectious compartment
+    Double_t Gamma = 1./fInfectiousDays;
+    Double_t Sigma = 1./fIncubationDays;
+    const Double_t *R0 = &batch.Pars.at(1*N), *M = &batch.Pars.at(2*N), *Tm = &batch.Pars.at(3*N);
+
+    for(int k=0 ; k<N ; k++) {
+        Double_t L = 1./(1.+exp(-(t-Tm[k])/fReductionDays));
+        Double_t Beta = Gamma*R0[k]*(1.-M[k]*L);
+        Double_t s = Y[k], i = Y[I*N+k];
+        Double_t Flow = Beta*s*i;
+        F[k] = -Flow;
+        if(NComp == 3) {
+            F[N+k] = Flow-Sigma*Y[N+k];
+            F[2*N+k] = Sigma*Y[N+k]-Gamma*i;
+        }
+        else F[N+k] = Flow-Gamma*i;
+        if(!batch.Sensitivities) continue;
+
+        // S' = J.S + df/dp, where only the transmission depends on R0, m and tm, and i0 only enters the initial values
+        Double_t dBeta[4] = {Gamma*(1.-M[k]*L),-Gamma*R0[k]*L,Gamma*R0[k]*M[k]*L*(1.-L)/fReductionDays,0.};
+        for(int q=0 ; q<4 ; q++) {
+            const Double_t *S = Y+NComp*(1+q)*N;
+            Double_t *FS = F+NComp*(1+q)*N;
+            Double_t dFlow = dBeta[q]*s*i+Beta*(S[k]*i+s*S[I*N+k]);
+            FS[k] = -dFlow;
+            if(NComp == 3) {
+                FS[N+k] = dFlow-Sigma*S[N+k];
+                FS[2*N+k] = Sigma*S[N+k]-Gamma*S[2*N+k];
+            }
+            else FS[N+k] = dFlow-Gamma*S[N+k];
+        }
+    }
+}
+
+Bool_t IntegrateCompartmental(CompartmentalBatch &batch)
+{
+    Int_t N = batch.NSets;
+    Int_t NComp = (batch.Model == kModelSEIRD) ? 3 : ((batch.Model == kModelSIR) ? 2 : 0);
+    Int_t NTimes = batch.Times.size();
+    batch.NSteps = 0;
+    batch.NRejected = 0;
+    batch.Daily.assign(NTimes*N,0.);
+    batch.Gradient.assign((batch.Sensitivities) ? NTimes*kNCompartmentalPars*N : 0,0.);
+    if(NComp == 0 || N <= 0 || (Int_t)batch.Pars.size() != kNCompartmentalPars*N) return false;
+    if(NTimes == 0 || batch.Times.back() < 0.) return true;
+
+    Int_t NRows = NComp*((batch.Sensitivities) ? 5 : 1);
+    Int_t Size = NRows*N;
+    vector<Double_t> Y(Size,0.), YNew(Size), YStage(Size);
+    vector<vector<Double_t>> K(7,vector<Double_t>(Size));
+
+    // a fraction i0 of the population is infectious at t0 (and as many are exposed for SEIRD), the others are susceptible
+    for(int k=0 ; k<N ; k++) {
+        Double_t i0 = batch.Pars.at(4*N+k);
+        Y.at(k) = 1.-(NComp-1)*i0;
+        for(int icomp=1 ; icomp<NComp ; icomp++) Y.at(icomp*N+k) = i0;
+        if(!batch.Sensitivities) continue;
+        Y.at(4*NComp*N+k) = -(NComp-1);
+        for(int icomp=1 ; icomp<NComp ; icomp++) Y.at((4*NComp+icomp)*N+k) = 1.;
+    }
+
+    // Dormand-Prince 5(4) coefficients, the last stage being the derivative at the end of the step (first same as last)
+    static const Double_t C[7] = {0.,1./5,3./10,4./5,8./9,1.,1.};
+    static const Double_t A[7][6] = {{0.,0.,0.,0.,0.,0.},
+                                     {1./5,0.,0.,0.,0.,0.},
+                                     {3./40,9./40,0.,0.,0.,0.},
+                                     {44./45,-56./15,32./9,0.,0.,0.},
+                                     {19372./6561,-25360./2187,64448./6561,-212./729,0.,0.},
+                                     {9017./3168,-355./33,46732./5247,49./176,-5103./18656,0.},
+                                     {35./384,0.,500./1113,125./192,-2187./6784,11./84}};
+    static const Double_t E[7] = {71./57600,0.,-71./16695,71./1920,-17253./339200,22./525,-1./40};
+
+    // the daily values are a*gamma*i(t), and their derivatives with respect to t0 are -a*gamma*i'(t)
+    Double_t Gamma = 1./fInfectiousDays;
+    Int_t I = NComp-1;
+    auto Output = [&](Int_t itime, Double_t t, Double_t h) {
+        // cubic Hermite interpolation between the beginning (Y, K[0]) and the end (YNew, K[6]) of the step
+        Double_t Theta = (h > 0.) ? (batch.Times.at(itime)-t)/h : 0.;
+        Double_t H00 = (2*Theta-3)*Theta*Theta+1, H10 = ((Theta-2)*Theta+1)*Theta, H01 = (3-2*Theta)*Theta*Theta, H11 = (Theta-1)*Theta*Theta;
+        Double_t D00 = 6*Theta*(Theta-1), D10 = (3*Theta-4)*Theta+1, D11 = (3*Theta-2)*Theta;
+        auto Value = [&](Int_t irow, Int_t k) {
+            Int_t idx = irow*N+k;
+            return (h > 0.) ? H00*Y[idx]+H10*h*K[0][idx]+H01*YNew[idx]+H11*h*K[6][idx] : Y[idx];
+        };
+        for(int k=0 ; k<N ; k++) {
+            Double_t a = batch.Pars.at(k);
+            Double_t Daily = a*Gamma*Value(I,k);
+            batch.Daily.at(itime*N+k) = Daily;
+            if(!batch.Sensitivities) continue;
+            Int_t idx = I*N+k;
+            Double_t Slope = (h > 0.) ? D00*(Y[idx]-YNew[idx])/h+D10*K[0][idx]+D11*K[6][idx] : K[0][idx];
+            Double_t *G = &batch.Gradient.at(itime*kNCompartmentalPars*N+k);
+            G[0] = Gamma*Value(I,k);
+            for(int q=0 ; q<4 ; q++) G[(1+q)*N] = a*Gamma*Value(NComp*(1+q)+I,k);
+            G[5*N] = -a*Gamma*Slope;
+        }
+    };
+
+    Double_t t = 0.;
+    Double_t TEnd = batch.Times.back();
+    Double_t h = min(0.1,TEnd);
+    CompartmentalDerivatives(batch,NComp,t,Y.data(),K[0].data());
+    Int_t itime = 0;
+    while(itime<NTimes && batch.Times.at(itime)<0.) itime++;
+    while(itime<NTimes && batch.Times.at(itime)<=0.) Output(itime++,t,0.);
+
+    // adaptive steps, common to all the parameter sets: the step is accepted if the local error estimate of every value
+    // (sensitivities included, for exact gradients) is below the tolerance, the absolute tolerance being 1e-6 of the
+    // relative one since the fractions of the population are small at the beginning of an epidemic
+    Double_t RelTolerance = fODETolerance, AbsTolerance = 1e-6*fODETolerance;
+    while(itime < NTimes) {
+        Bool_t Last = (h >= TEnd-t);
+        if(Last) h = TEnd-t;
+        else if(h < 1e-8 || batch.NSteps+batch.NRejected > 1000000) return false;
+        for(int istage=1 ; istage<7 ; istage++) {
+            for(int idx=0 ; idx<Size ; idx++) {
+                Double_t Sum = 0.;
+                for(int j=0 ; j<istage ; j++) Sum += A[istage][j]*K[j][idx];
+                YStage[idx] = Y[idx]+h*Sum;
+            }
+            CompartmentalDerivatives(batch,NComp,t+C[istage]*h,YStage.data(),K[istage].data());
+        }
+        // the last stage is evaluated at the 5th order solution
+        YNew = YStage;
+
+        Double_t Error = 0.;
+        for(int idx=0 ; idx<Size ; idx++) {
+            Double_t Estimate = 0.;
+            for(int j=0 ; j<7 ; j++) Estimate += E[j]*K[j][idx];
+            Double_t Scale = AbsTolerance+RelTolerance*max(fabs(Y[idx]),fabs(YNew[idx]));
+            Error = max(Error,fabs(h*Estimate)/Scale);
+        }
+        if(!isfinite(Error)) return false;
+
+        if(Error <= 1.) {
+            batch.NSteps++;
+            while(itime<NTimes && (Last || batch.Times.at(itime)<=t+h)) Output(itime++,t,h);
+            t += h;
+            Y.swap(YNew);
+            K[0].swap(K[6]);
+        }
+        else batch.NRejected++;
+        h *= min(5.,max(0.2,0.9*pow(max(Error,1e-10),-0.2)));
+    }
+
+    return true;
+}
+
+Bool_t CompartmentalFunction::Update(Double_t x, const double *p, Bool_t Sensitivities) const
+{
+    Bool_t Same = Cached && (Cache.Sensitivities || !Sensitivities) && x-p[5] <= Cache.Times.back();
+    for(int ipar=0 ; Same && ipar<kNCompartmentalPars ; ipar++) Same = (Cache.Pars.at(ipar) == p[ipar]);
+    if(Same) return true;
+
+    // the grid of an extended instance covers the latest time requested with the same t0, so that it does not change at
+    // each call, the one of a fit instance stops at XHigh
+    Double_t TEnd = ((Extend) ? max(XHigh,x) : XHigh)-p[5];
+    if(Extend && Cached && Cache.Pars.at(5) == p[5]) TEnd = max(TEnd,Cache.Times.back());
+    Cache.Model = Model;
+    Cache.NSets = 1;
+    Cache.Sensitivities = Sensitivities;
+    Cache.Pars.assign(p,p+kNCompartmentalPars);
+    Cache.Times.resize(2*max(0,(Int_t)ceil(TEnd))+1);
+    for(size_t itime=0 ; itime<Cache.Times.size() ; itime++) Cache.Times.at(itime) = 0.5*itime;
+    Cached = IntegrateCompartmental(Cache);
+
+    return Cached;
+}
+
+double CompartmentalFunction::DoEvalPar(const double *x, const double *p) const
+{
+    // nobody is infected before t0, and a fit instance gives 0 after the end of its grid
+    if(x[0] < p[5] || (!Extend && x[0] > XHigh) || !Update(x[0],p,false)) return 0.;
+
+    // linear interpolation between the half days of the grid
+    Double_t Position = 2*(x[0]-p[5]);
+    size_t itime = min((size_t)Position,Cache.Times.size()-1);
+    Double_t Weight = (itime+1 < Cache.Times.size()) ? Position-itime : 0.;
+    Double_t Daily = (1.-Weight)*Cache.Daily.at(itime);
+    if(Weight > 0.) Daily += Weight*Cache.Daily.at(itime+1);
+
+    return Daily;
+}
+
+void CompartmentalFunction::ParameterGradient(const double *x, const double *p, double *grad) const
+{
+    for(int ipar=0 ; ipar<kNCompartmentalPars ; ipar++) grad[ipar] = 0.;
+    if(x[0] < p[5] || (!Extend && x[0] > XHigh) || !Update(x[0],p,true)) return;
+
+    Double_t Position = 2*(x[0]-p[5]);
+    size_t itime = min((size_t)Position,Cache.Times.size()-1);
+    Double_t Weight = (itime+1 < Cache.Times.size()) ? Position-itime : 0.;
+    for(int ipar=0 ; ipar<kNCompartmentalPars ; ipar++) {
+        grad[ipar] = (1.-Weight)*Cache.Gradient.at(itime*kNCompartmentalPars+ipar);
+        if(Weight > 0.) grad[ipar] += Weight*Cache.Gradient.at((itime+1)*kNCompartmentalPars+ipar);
+    }
+}
+
+double CompartmentalFunction::DoParameterDerivative(const double *x, const double *p, unsigned int ipar) const
+{
+    Double_t Gradient[kNCompartmentalPars];
+    ParameterGradient(x,p,Gradient);
+
+    return (ipar < (unsigned int)kNCompartmentalPars) ? Gradient[ipar] : 0.;
+}
+
+Bool_t CompartmentalScenarios(const ModelFit &fit, const vector<Double_t> &Reductions, vector<vector<Double_t>> &Curves)
+{
+    Curves.clear();
+    if(!IsCompartmental(fit.Model) || fit.Pars.size() != (size_t)kNCompartmentalPars || Reductions.empty()) return false;
+
+    // the scenarios only differ by m (parameter 2), and are integrated together on the centres of the histogram bins
+    // (the bins before t0 staying at 0)
+    CompartmentalBatch batch;
+    batch.Model = fit.Model;
+    batch.NSets = Reductions.size();
+    Int_t NBins = GetDateBin("31-Dec-21");
+    for(int ibin=1 ; ibin<=NBins ; ibin++) batch.Times.push_back(BinToX(ibin)-fit.Pars.at(kNCompartmentalPars-1));
+    batch.Pars.resize(kNCompartmentalPars*batch.NSets);
+    for(int ipar=0 ; ipar<kNCompartmentalPars ; ipar++) {
+        for(int k=0 ; k<batch.NSets ; k++) batch.Pars.at(ipar*batch.NSets+k) = (ipar == 2) ? Reductions.at(k) : fit.Pars.at(ipar);
+    }
+    if(!IntegrateCompartmental(batch)) return false;
+
+    Curves.assign(batch.NSets,vector<Double_t>(NBins,0.));
+    for(int ibin=0 ; ibin<NBins ; ibin++) {
+        for(int k=0 ; k<batch.NSets ; k++) Curves.at(k).at(ibin) = batch.Daily.at(ibin*batch.NSets+k);
+    }
+
+    return true;
+}
+
+void SetCases(Bool_t DoCases, Int_t MaxLag) {
+    fDoCases = DoCases;
+    fMaxLag = MaxLag;
+
+    if(fDoCases) INFO_MESS << "Cases analysis activated, lag with the deaths searched up to " << fMaxLag << " days" << ENDL;
+    else INFO_MESS << "Cases analysis deactivated" << ENDL;
+}
+
+Bool_t EstimateLag(const Series &cases, const Series &deaths, LagEstimate &lag, Int_t MaxLag)
+{
+    lag = LagEstimate();
+
+    // both smoothed series are put on a common grid of days (histogram bins), the missing days being 0
+    Int_t First = kMaxInt, Last = 0;
+    for(auto series : {&cases,&deaths}) {
+        for(size_t i=0 ; i<series->Daily_Deaths.size() ; i++) {
+            if(series->Bins.at(i)<=0) continue;
+            First = min(First,series->Bins.at(i));
+            Last = max(Last,series->Bins.at(i));
+        }
+    }
+    if(First > Last) return false;
+    Int_t N = Last-First+1;
+    vector<Double_t> C(N,0.), D(N,0.);
+    for(size_t i=0 ; i<cases.Daily_Deaths.size() ; i++) if(cases.Bins.at(i)>0) C.at(cases.Bins.at(i)-First) = cases.Daily_Deaths.at(i);
+    for(size_t i=0 ; i<deaths.Daily_Deaths.size() ; i++) if(deaths.Bins.at(i)>0) D.at(deaths.Bins.at(i)-First) = deaths.Daily_Deaths.at(i);
+
+    // the series are padded with zeros to at least twice their length, so that the circular correlation computed by FFT
+    // does not wrap, and the sums of each series on any window are taken from their prefix sums
+    size_t M = NextPowerOfTwo(2*N);
+    vector<complex<Double_t>> FC(M), FD(M);
+    vector<Double_t> SumC(N+1,0.), SumC2(N+1,0.), SumD(N+1,0.), SumD2(N+1,0.);
+    for(int i=0 ; i<N ; i++) {
+        FC.at(i) = C.at(i);
+        FD.at(i) = D.at(i);
+        SumC.at(i+1) = SumC.at(i)+C.at(i);
+        SumC2.at(i+1) = SumC2.at(i)+C.at(i)*C.at(i);
+        SumD.at(i+1) = SumD.at(i)+D.at(i);
+        SumD2.at(i+1) = SumD2.at(i)+D.at(i)*D.at(i);
+    }
+
+    // R[k] = sum_t D[t+k]*C[t], the negative lags being at the end of the vector
+    FFT(FC);
+    FFT(FD);
+    for(size_t i=0 ; i<M ; i++) FD.at(i) *= conj(FC.at(i));
+    FFT(FD,true);
+
+    // the correlation at each lag is the Pearson coefficient on the N-|k| days where both series overlap: the means are
+    // removed on the overlap only, a mean removed on the whole grid favouring the small lags, which overlap on more days
+    MaxLag = min(MaxLag,N-2);
+    lag.Correlation = -2.;
+    for(int k=-MaxLag ; k<=MaxLag ; k++) {
+        Int_t FirstC = max(0,-k), LastC = N-max(0,k), n = LastC-FirstC;
+        Double_t SC = SumC.at(LastC)-SumC.at(FirstC), SC2 = SumC2.at(LastC)-SumC2.at(FirstC);
+        Double_t SD = SumD.at(LastC+k)-SumD.at(FirstC+k), SD2 = SumD2.at(LastC+k)-SumD2.at(FirstC+k);
+        Double_t VarC = SC2-SC*SC/n, VarD = SD2-SD*SD/n;
+        if(VarC<=0. || VarD<=0.) continue;
+        Double_t Correlation = (FD.at((k>=0) ? k : M+k).real()-SC*SD/n)/sqrt(VarC*VarD);
+        if(Correlation > lag.Correlation) {
+            lag.Correlation = Correlation;
+            lag.Lag = k;
+        }
+    }
+
+    // the ratio is computed on the days where both the cases and the shifted deaths are known
+    Int_t FirstC = max(0,-lag.Lag), LastC = N-max(0,lag.Lag);
+    Double_t TotalC = SumC.at(LastC)-SumC.at(FirstC), TotalD = SumD.at(LastC+lag.Lag)-SumD.at(FirstC+lag.Lag);
+    if(TotalC>0.) lag.Ratio = TotalD/TotalC;
+    lag.Valid = (lag.Correlation>0. && TotalC>0.);
+
+    return lag.Valid;
+}
+
+void AnalyseCases(AnalysisResult &result, map<TString,ModelFit> *Fits)
+{
+    result.CaseFits.clear();
+    result.Lag = LagEstimate();
+    Series &cases = result.Cases;
+    if(cases.Dates.empty()) return;
+
+    StageClock clock = StartStage();
+    SmoothSeries(cases,result.Data.NSmoothing);
+    StopStage(result.Timings,kStageSmooth,clock);
+
+    // the cases have their own fit range, their waves coming before the ones of the deaths
+    GetFitRange(cases,fFitRangeFrom,fFitRangeTo,result.CasesXMin,result.CasesXMax);
+    for(auto Model : GetModels()) {
+        TString Key = Form("cases|%d|%d|%d|%d%s",Model,fDoFullModel,result.CasesXMin,result.CasesXMax,GetCompartmentalKey(Model).Data());
+        if(Fits && Fits->count(Key)) {
+            result.CaseFits.push_back(Fits->at(Key));
+            continue;
+        }
+        ModelFit fit;
+        FitModel(Model,cases,result.CasesXMin,result.CasesXMax,fit,nullptr,true,&result.Timings);
+        if(Fits) (*Fits)[Key] = fit;
+        result.CaseFits.push_back(fit);
+    }
+
+    EstimateLag(cases,result.Data,result.Lag,fMaxLag);
+}
+
+AnalysisResult GetCasesResult(const AnalysisResult &result)
+{
+    AnalysisResult cases;
+    cases.Country = result.Country;
+    cases.Data = result.Cases;
+    cases.XMin = result.CasesXMin;
+    cases.XMax = result.CasesXMax;
+    cases.Fits = result.CaseFits;
+
+    return cases;
+}
+
+void PrintCases(const AnalysisResult &result)
+{
+    const LagEstimate &lag = result.Lag;
+    if(lag.Valid) {
+        INFO_MESS << "Deaths delayed by " << lag.Lag << " days with respect to the cases, " << Form("%.2f%%",100*lag.Ratio)
+                  << " of the cases being deaths (correlation " << Form("%.2f",lag.Correlation) << ")" << ENDL;
+    }
+    else WARN_MESS << "No lag found between the cases and the deaths" << ENDL;
+
+    INFO_MESS << "Cases fits, from " << GetBinDate(result.CasesXMin) << " to " << GetBinDate(result.CasesXMax) << ":" << ENDL;
+    for(auto &fit : result.CaseFits) PrintFit(fit);
+}
+
+void SetRt(Bool_t DoRt, Double_t GenerationMean, Double_t GenerationSD, Int_t Window, Int_t Delay, Bool_t FromInfections) {
+    fDoRt = DoRt;
+    fRtGenerationMean = GenerationMean;
+    fRtGenerationSD = GenerationSD;
+    fRtWindow = max(1,Window);
+    fRtDelay = Delay;
+    fRtFromInfections = FromInfections;
+
+    if(!fDoRt) {
+        INFO_MESS << "Rt estimation deactivated" << ENDL;
+        return;
+    }
+    INFO_MESS << "Rt estimation activated: " << fRtWindow << " days window, ";
+    if(fRtFromInfections) cout << "on the deconvolved infections, generation interval ";
+    else cout << fRtDelay << " days delay, generation interval ";
+    if(fRtGeneration.empty()) cout << "gamma " << fRtGenerationMean << " +/- " << fRtGenerationSD << " days" << ENDL;
+    else cout << fRtGeneration.size() << " daily weights" << ENDL;
+}
+
+void SetGenerationInterval(vector<Double_t> Weights) {
+    fRtGeneration = Weights;
+
+    if(fRtGeneration.empty()) INFO_MESS << "Generation interval: gamma " << fRtGenerationMean << " +/- " << fRtGenerationSD << " days" << ENDL;
+    else INFO_MESS << "Generation interval: " << fRtGeneration.size() << " daily weights" << ENDL;
+}
+
+vector<Double_t> GetGenerationInterval()
+{
+    vector<Double_t> Weights(1,0.);
+
+    if(!fRtGeneration.empty()) for(auto weight : fRtGeneration) Weights.push_back(max(0.,weight));
+    else Weights = DiscretiseGamma(fRtGenerationMean,fRtGenerationSD,1);
+
+    Double_t Sum = 0.;
+    for(auto weight : Weights) Sum += weight;
+    if(Sum>0.) for(auto &weight : Weights) weight /= Sum;
+
+    return Weights;
+}
+
+// to put the smoothed daily data of a series on a grid of days without gap, the missing days being 0 (First: bin of the first day)
+static Bool_t GetDailyGrid(const Series &series, Int_t &First, vector<Double_t> &Daily)
+{
+    Daily.clear();
+    First = kMaxInt;
+    Int_t Last = 0;
+    for(size_t i=0 ; i<series.Daily_Deaths.size() ; i++) {
+        if(series.Bins.at(i)<=0) continue;
+        First = min(First,series.Bins.at(i));
+        Last = max(Last,series.Bins.at(i));
+    }
+    if(First > Last) return false;
+    Daily.assign(Last-First+1,0.);
+    for(size_t i=0 ; i<series.Daily_Deaths.size() ; i++) {
+        if(series.Bins.at(i)>0) Daily.at(series.Bins.at(i)-First) = max(0.,series.Daily_Deaths.at(i));
+    }
+    return true;
+}
+
+Bool_t EstimateRt(const Series &series, RtEstimate &rt)
+{
+    rt = RtEstimate();
+
+    Int_t First;
+    vector<Double_t> Incidence;
+    if(!GetDailyGrid(series,First,Incidence)) return false;
+
+    return EstimateRt(Incidence,First,fRtDelay,rt);
+}
+
+Bool_t EstimateRt(AnalysisResult &result)
+{
+    const InfectionCurves &infections = result.Infections;
+    if(!fRtFromInfections || !infections.Valid) return EstimateRt(result.Data,result.Rt);
+
+    // the infections are already at the time of the infections, only the reliable ones being used
+    vector<Double_t> Incidence(infections.Data.begin(),infections.Data.begin()+infections.LastReliableBin);
+    return EstimateRt(Incidence,1,0,result.Rt);
+}
+
+Bool_t EstimateRt(const vector<Double_t> &Incidence, Int_t First, Int_t Delay, RtEstimate &rt)
+{
+    rt = RtEstimate();
+    Int_t N = Incidence.size();
+    if(N == 0) return false;
+
+    // infection pressure of the renewal equation, Lambda[t] = sum_k w[k]*I[t-k]
+    vector<Double_t> Lambda;
+    Convolve(Incidence,GetGenerationInterval(),Lambda);
+
+    vector<Double_t> SumI(N+1,0.), SumL(N+1,0.);
+    for(int t=0 ; t<N ; t++) {
+        SumI.at(t+1) = SumI.at(t)+Incidence.at(t);
+        SumL.at(t+1) = SumL.at(t)+Lambda.at(t);
+    }
+
+    // gamma prior of mean 5 and standard deviation 5, as in Cori et al. (2013), the posterior on a window being a gamma
+    // of shape PriorShape+sum(I) and rate 1/PriorScale+sum(Lambda); the estimates start once 12 events have been seen
+    const Double_t PriorShape = 1., PriorScale = 5.;
+    for(int t=fRtWindow-1 ; t<N ; t++) {
+        if(SumI.at(t+1) < 12) continue;
+        Double_t WindowI = SumI.at(t+1)-SumI.at(t+1-fRtWindow);
+        Double_t WindowL = SumL.at(t+1)-SumL.at(t+1-fRtWindow);
+        Int_t Bin = First+t-Delay;
+        if(WindowL<=0. || Bin<=0) continue;
+
+        Double_t Shape = PriorShape+WindowI;
+        Double_t Rate = 1./PriorScale+WindowL;
+        rt.Bins.push_back(Bin);
+        rt.Mean.push_back(Shape/Rate);
+        rt.Low.push_back(TMath::ChisquareQuantile(0.025,2*Shape)/(2*Rate));
+        rt.High.push_back(TMath::ChisquareQuantile(0.975,2*Shape)/(2*Rate));
+    }
+    rt.Valid = !rt.Mean.empty();
+
+    return rt.Valid;
+}
+
+void PrintRt(const AnalysisResult &result)
+{
+    const RtEstimate &rt = result.Rt;
+    if(!rt.Valid) {
+        WARN_MESS << "Rt of " << result.Country << " cannot be estimated" << ENDL;
+        return;
+    }
+    INFO_MESS << "Rt of " << result.Country << " on " << GetBinDate(rt.Bins.back()) << ": " << Form("%.2f [%.2f, %.2f]",rt.Mean.back(),rt.Low.back(),rt.High.back())
+              << " (95% credible interval, " << fRtWindow << " days window)" << ENDL;
+}
+
+void DrawRt(const AnalysisResult &result)
+{
+    const Series &series = result.Data;
+    const RtEstimate &rt = result.Rt;
+    if(!rt.Valid) return;
+
+    gStyle->SetOptTitle(0);
+    gStyle->SetOptStat(0);
+
+    TCanvas *MyCanvas = (TCanvas*)gROOT->GetListOfCanvases()->FindObject("rt");
+    if(MyCanvas == nullptr) MyCanvas = new TCanvas("rt","rt",1600,600);
+    MyCanvas->Clear();
+    MyCanvas->cd();
+
+    Int_t DateMin,DateMax;
+    GetAxisRange(series,DateMin,DateMax);
+    DateMin = min(DateMin,rt.Bins.front());
+
+    // the frame is an empty date histogram, the credible interval being drawn as a band around the posterior mean
+    TH1D *frame = PadOwned(BuildDateHistogram("hRt"));
+    frame->GetYaxis()->SetTitle("R_{t}");
+    frame->GetXaxis()->SetRange(DateMin,DateMax);
+    Double_t MaxY = 0.;
+    for(size_t i=0 ; i<rt.Bins.size() ; i++) if(rt.Bins.at(i)>=DateMin && rt.Bins.at(i)<=DateMax) MaxY = max(MaxY,rt.High.at(i));
+    frame->GetYaxis()->SetRangeUser(0,min(4.,MaxY*1.1));
+    Int_t Step = max(1,(DateMax-DateMin)/40);
+    for(int ibin=1 ; ibin<=frame->GetNbinsX() ; ibin++) if((ibin-1)%Step) frame->GetXaxis()->SetBinLabel(ibin,"");
+    frame->Draw("axis");
+
+    TGraphAsymmErrors *band = PadOwned(new TGraphAsymmErrors);
+    TGraph *graph = PadOwned(new TGraph);
+    for(size_t i=0 ; i<rt.Bins.size() ; i++) {
+        band->SetPoint(i,BinToX(rt.Bins.at(i)),rt.Mean.at(i));
+        band->SetPointError(i,0.,0.,rt.Mean.at(i)-rt.Low.at(i),rt.High.at(i)-rt.Mean.at(i));
+        graph->SetPoint(i,BinToX(rt.Bins.at(i)),rt.Mean.at(i));
+    }
+    band->SetFillColorAlpha(kBlue,0.3);
+    band->Draw("3");
+    graph->SetLineColor(kBlue);
+    graph->SetLineWidth(2);
+    graph->Draw("l");
+
+    TGraph *one = PadOwned(new TGraph);
+    one->SetPoint(0,BinToX(DateMin),1.);
+    one->SetPoint(1,BinToX(DateMax),1.);
+    one->SetLineStyle(kDashed);
+    one->Draw("l");
+
+    TString theCountry = result.Country;
+    theCountry.ReplaceAll("_"," ");
+    TLatex *text = PadOwned(new TLatex(0.12,0.85,Form("%s: R_{t} = %.2f [%.2f, %.2f] on %s",theCountry.Data(),rt.Mean.back(),rt.Low.back(),rt.High.back(),GetBinDate(rt.Bins.back()).Data())));
+    text->SetNDC();
+    text->SetTextFont(132);
+    text->SetTextSize(0.05);
+    text->Draw();
+
+    MyCanvas->Modified();
+    MyCanvas->Update();
+
+    gSystem->mkdir("Pictures");
+    TString OutputFileName = Form("Pictures/covid19_rt_%s",theCountry.Data());
+    if(series.NSmoothing>1) OutputFileName.Append(Form("_%dDaysSmooth",series.NSmoothing));
+    OutputFileName.Append(Form("_%s.png",series.Dates.back().Data()));
+    MyCanvas->SaveAs(OutputFileName);
+}
+
+void SetDeconvolution(Bool_t DoDeconvolution, Double_t DelayMean, Double_t DelaySD, Int_t Method, Double_t Regularisation) {
+    fDoDeconvolution = DoDeconvolution;
+    fDelayMean = DelayMean;
+    fDelaySD = DelaySD;
+    fDeconvolutionMethod = (Method>=0 && Method<kNDeconvolutionMethods) ? Method : kRichardsonLucy;
+    if(Regularisation>0) fDeconvolutionRegularisation = Regularisation;
+    else fDeconvolutionRegularisation = (fDeconvolutionMethod == kTikhonov) ? 0.01 : 50.;
+
+    if(!fDoDeconvolution) {
+        INFO_MESS << "Deconvolution deactivated" << ENDL;
+        return;
+    }
+    INFO_MESS << "Deconvolution activated: " << fDeconvolutionNames[fDeconvolutionMethod];
+    if(fDeconvolutionMethod == kRichardsonLucy) cout << " (" << (Int_t)fDeconvolutionRegularisation << " iterations)";
+    else cout << " (lambda = " << fDeconvolutionRegularisation << ")";
+    if(fDelayWeights.empty()) cout << ", infection-to-death delay gamma " << fDelayMean << " +/- " << fDelaySD << " days" << ENDL;
+    else cout << ", infection-to-death delay of " << fDelayWeights.size() << " daily weights" << ENDL;
+}
+
+void SetDelayDistribution(vector<Double_t> Weights) {
+    fDelayWeights = Weights;
+
+    if(fDelayWeights.empty()) INFO_MESS << "Infection-to-death delay: gamma " << fDelayMean << " +/- " << fDelaySD << " days" << ENDL;
+    else INFO_MESS << "Infection-to-death delay: " << fDelayWeights.size() << " daily weights" << ENDL;
+}
+
+vector<Double_t> GetDelayDistribution()
+{
+    vector<Double_t> Weights;
+
+    if(!fDelayWeights.empty()) for(auto weight : fDelayWeights) Weights.push_back(max(0.,weight));
+    else Weights = DiscretiseGamma(fDelayMean,fDelaySD,0);
+
+    Double_t Sum = 0.;
+    for(auto weight : Weights) Sum += weight;
+    if(Sum>0.) for(auto &weight : Weights) weight /= Sum;
+
+    return Weights;
+}
+
+// to deconvolve a curve with a deconvolver, with the method and the regularisation of the configuration
+static void DeconvolveCurve(const Deconvolver &deconvolver, const vector<Double_t> &data, vector<Double_t> &result)
+{
+    if(fDeconvolutionMethod == kTikhonov) DeconvolveTikhonov(deconvolver,data,fDeconvolutionRegularisation,result);
+    else DeconvolveRichardsonLucy(deconvolver,data,TMath::Nint(fDeconvolutionRegularisation),result);
+}
+
+Bool_t DeconvolveResult(AnalysisResult &result)
+{
+    InfectionCurves &infections = result.Infections;
+    infections = InfectionCurves();
+
+    vector<Double_t> Delay = GetDelayDistribution();
+    Int_t First;
+    vector<Double_t> Daily;
+    if(Delay.empty() || !GetDailyGrid(result.Data,First,Daily)) return false;
+    Int_t NBins = GetDateBin("31-Dec-21");
+    Int_t K = Delay.size();
+
+    // the infections start K-1 days before the data, the ones before the first bin being dropped
+    Deconvolver deconvolver;
+    vector<Double_t> Curve;
+    InitDeconvolver(deconvolver,Delay,Daily.size());
+    DeconvolveCurve(deconvolver,Daily,Curve);
+    infections.Data.assign(NBins,0.);
+    for(size_t j=0 ; j<Curve.size() ; j++) {
+        Int_t Bin = First-(K-1)+j;
+        if(Bin>=1 && Bin<=NBins) infections.Data.at(Bin-1) = Curve.at(j);
+    }
+
+    // the infections of the last days are constrained by the deaths only beyond the mean delay
+    Double_t MeanDelay = 0.;
+    for(int d=0 ; d<K ; d++) MeanDelay += d*Delay.at(d);
+    infections.LastReliableBin = min(NBins,First+(Int_t)Daily.size()-1-TMath::Nint(MeanDelay));
+    infections.Valid = infections.LastReliableBin>=First;
+
+    // the fitted curves are all defined on the bins of the histogram, their deconvolver being shared
+    InitDeconvolver(deconvolver,Delay,NBins);
+    for(auto &fit : result.Fits) {
+        infections.Fits.push_back({});
+        if(fit.Band.size() != (size_t)NBins) continue;
+        DeconvolveCurve(deconvolver,fit.Band,Curve);
+        infections.Fits.back().assign(Curve.begin()+(K-1),Curve.end());
+    }
+
+    return infections.Valid;
+}
+
+void PrintInfections(const AnalysisResult &result)
+{
+    const InfectionCurves &infections = result.Infections;
+    if(!infections.Valid) {
+        WARN_MESS << "The infections of " << result.Country << " cannot be deconvolved" << ENDL;
+        return;
+    }
+
+    auto PrintPeak = [&](TString Name, const vector<Double_t> &curve) {
+        if(curve.empty()) return;
+        Int_t Last = min((Int_t)curve.size(),infections.LastReliableBin);
+        Int_t Peak = max_element(curve.begin(),curve.begin()+Last)-curve.begin();
+        INFO_MESS << Name << " infections peak on " << GetBinDate(Peak+1) << Form(" (%.1f deaths/day)",curve.at(Peak)) << ENDL;
+    };
+    INFO_MESS << "Infections of " << result.Country << " deconvolved with " << fDeconvolutionNames[fDeconvolutionMethod]
+              << ", reliable up to " << GetBinDate(infections.LastReliableBin) << ENDL;
+    PrintPeak("Data",infections.Data);
+    for(size_t ifit=0 ; ifit<infections.Fits.size() && ifit<result.Fits.size() ; ifit++) PrintPeak(fModelNames[result.Fits.at(ifit).Model],infections.Fits.at(ifit));
+}
+
+void DrawInfections(const AnalysisResult &result)
+{
+    const Series &series = result.Data;
+    const InfectionCurves &infections = result.Infections;
+    if(!infections.Valid) return;
+
+    gStyle->SetOptTitle(0);
+    gStyle->SetOptStat(0);
+
+    TCanvas *MyCanvas = (TCanvas*)gROOT->GetListOfCanvases()->FindObject("infections");
+    if(MyCanvas == nullptr) MyCanvas = new TCanvas("infections","infections",1600,600);
+    MyCanvas->Clear();
+    MyCanvas->cd();
+
+    Int_t DateMin,DateMax;
+    GetAxisRange(series,DateMin,DateMax);
+
+    // the infections of the data are drawn as a histogram, in deaths per day, the ones of the fits as curves
+    TH1D *hInfections = PadOwned(BuildDateHistogram("hInfections"));
+    hInfections->GetYaxis()->SetTitle("INFECTIONS / DAY (in deaths)");
+    hInfections->GetXaxis()->SetRange(DateMin,DateMax);
+    Double_t MaxY = 0.;
+    for(int ibin=1 ; ibin<=hInfections->GetNbinsX() && ibin<=(Int_t)infections.Data.size() ; ibin++) {
+        hInfections->SetBinContent(ibin,infections.Data.at(ibin-1));
+        if(ibin>=DateMin && ibin<=DateMax) MaxY = max(MaxY,infections.Data.at(ibin-1));
+    }
+    Int_t Step = max(1,(DateMax-DateMin)/40);
+    for(int ibin=1 ; ibin<=hInfections->GetNbinsX() ; ibin++) if((ibin-1)%Step) hInfections->GetXaxis()->SetBinLabel(ibin,"");
+    hInfections->GetYaxis()->SetRangeUser(0,MaxY*1.3);
+    hInfections->SetLineColor(kBlack);
+    hInfections->Draw("hist");
+
+    for(size_t ifit=0 ; ifit<infections.Fits.size() && ifit<result.Fits.size() ; ifit++) {
+        const vector<Double_t> &curve = infections.Fits.at(ifit);
+        TGraph *graph = PadOwned(new TGraph);
+        for(int ibin=DateMin ; ibin<=DateMax && ibin<=(Int_t)curve.size() ; ibin++) graph->SetPoint(graph->GetN(),BinToX(ibin),curve.at(ibin-1));
+        graph->SetLineColor(fColors[result.Fits.at(ifit).Model]);
+        graph->SetLineWidth(2);
+        graph->Draw("l");
+    }
+
+    // the infections after the last reliable day are not yet seen in the deaths
+    TGraph *reliable = PadOwned(new TGraph);
+    reliable->SetPoint(0,BinToX(infections.LastReliableBin),0.);
+    reliable->SetPoint(1,BinToX(infections.LastReliableBin),MaxY*1.3);
+    reliable->SetLineStyle(kDashed);
+    reliable->Draw("l");
+
+    TString theCountry = result.Country;
+    theCountry.ReplaceAll("_"," ");
+    TLatex *text = PadOwned(new TLatex(0.12,0.85,Form("%s: infections deconvolved with %s",theCountry.Data(),fDeconvolutionNames[fDeconvolutionMethod])));
+    text->SetNDC();
+    text->SetTextFont(132);
+    text->SetTextSize(0.05);
+    text->Draw();
+
+    MyCanvas->Modified();
+    MyCanvas->Update();
+
+    gSystem->mkdir("Pictures");
+    TString OutputFileName = Form("Pictures/covid19_infections_%s",theCountry.Data());
+    if(series.NSmoothing>1) OutputFileName.Append(Form("_%dDaysSmooth",series.NSmoothing));
+    OutputFileName.Append(Form("_%s.png",series.Dates.back().Data()));
+    MyCanvas->SaveAs(OutputFileName);
+}
+
+void SetForecast(Bool_t DoForecast, Int_t NDays, Int_t FinalDays) {
+    fDoForecast = DoForecast;
+    fForecastDays = max(1,NDays);
+    fForecastFinalDays = max(1,FinalDays);
+
+    if(!fDoForecast) {
+        INFO_MESS << "Forecasts deactivated" << ENDL;
+        return;
+    }
+    INFO_MESS << "Forecasts activated: " << fForecastDays << " days projected, final toll " << fForecastFinalDays << " days after the last data" << ENDL;
+}
+
+// date of a projected day, the bins after 2021 having no date in the histograms
+static TString GetForecastDate(Int_t Bin)
+{
+    TString Date = GetBinDate(Bin);
+    if(Date.IsNull()) Date = Form("day %d",Bin);
+
+    return Date;
+}
+
+Bool_t ComputeForecast(const ModelFit &fit, const Series &series, Int_t NDays, Int_t FinalDays, Forecast &forecast)
+{
+    forecast = Forecast();
+    forecast.Model = fit.Model;
+    forecast.FinalDays = FinalDays;
+
+    Int_t NPars = fit.Pars.size();
+    if(fit.Model<0 || fit.Model>=kNModels || NPars == 0 || fit.Covariance.size() != (size_t)(NPars*NPars)) return false;
+    if(series.Bins.empty() || series.Bins.back()<1 || NDays<1 || FinalDays<1) return false;
+    forecast.LastBin = series.Bins.back();
+    forecast.LastTotal = series.Total_Deaths.back();
+
+    // the fitted curve is computed once on all the days from the start of the fit to the final toll, with its derivatives
+    // with respect to the free parameters (the fixed ones have no variance)
+    Int_t First = min(fit.XMin,forecast.LastBin+1);
+    Int_t NProjected = max(NDays,FinalDays);
+    Int_t NPoints = forecast.LastBin+NProjected-First+1;
+    vector<Double_t> X(NPoints), Curve(NPoints);
+    for(int j=0 ; j<NPoints ; j++) X.at(j) = BinToX(First+j);
+
+    vector<Int_t> Free;
+    for(int ipar=0 ; ipar<NPars ; ipar++) if(fit.Covariance.at(ipar*NPars+ipar) > 0.) Free.push_back(ipar);
+    Int_t NFree = Free.size();
+    vector<Double_t> G(NPoints*NFree,0.);   // G[j*NFree+ifree]: derivative of the curve at X[j]
+
+    if(IsCompartmental(fit.Model)) {
+        CompartmentalFunction model(fit.Model,X.back(),true);
+        vector<Double_t> Gradient(NPars);
+        for(int j=0 ; j<NPoints ; j++) {
+            Curve.at(j) = model(&X.at(j),fit.Pars.data());
+            model.ParameterGradient(&X.at(j),fit.Pars.data(),Gradient.data());
+            for(int ifree=0 ; ifree<NFree ; ifree++) G.at(j*NFree+ifree) = Gradient.at(Free.at(ifree));
+        }
+    }
+    else {
+        unique_ptr<TF1> func(InitModel(fit.Model,fit.FullModel,Form("Forecast_%s_%s_%d_%d",fModelNames[fit.Model],series.Country.Data(),fit.XMin,fit.XMax),fit.XMin,series));
+        vector<Double_t> Pars = fit.Pars;
+        for(int j=0 ; j<NPoints ; j++) Curve.at(j) = func->EvalPar(&X.at(j),Pars.data());
+        for(int ifree=0 ; ifree<NFree ; ifree++) {
+            Int_t ipar = Free.at(ifree);
+            Double_t Step = max(1e-4*fabs(fit.Pars.at(ipar)),1e-8);
+            for(int j=0 ; j<NPoints ; j++) {
+                Pars.at(ipar) = fit.Pars.at(ipar)+Step;
+                Double_t Up = func->EvalPar(&X.at(j),Pars.data());
+                Pars.at(ipar) = fit.Pars.at(ipar)-Step;
+                Double_t Down = func->EvalPar(&X.at(j),Pars.data());
+                G.at(j*NFree+ifree) = (Up-Down)/(2.*Step);
+            }
+            Pars.at(ipar) = fit.Pars.at(ipar);
+        }
+    }
+
+    // 95% interval of a quantity of gradient g, with the normalisation of the confidence band of the fit
+    Double_t Quantile = (fit.Ndf>0) ? TMath::StudentQuantile(0.975,fit.Ndf)*sqrt(fit.Chi2/fit.Ndf) : 0.;
+    auto GetError = [&](const Double_t *g) {
+        Double_t Variance = 0.;
+        for(int i=0 ; i<NFree ; i++) {
+            for(int k=0 ; k<NFree ; k++) Variance += g[i]*fit.Covariance.at(Free.at(i)*NPars+Free.at(k))*g[k];
+        }
+        return Quantile*sqrt(max(0.,Variance));
+    };
+
+    // daily and cumulative projections, the cumulative gradient being the sum of the daily ones
+    Int_t Offset = forecast.LastBin+1-First;
+    Double_t Total = forecast.LastTotal;
+    vector<Double_t> TotalGradient(NFree,0.);
+    for(int iday=1 ; iday<=NProjected ; iday++) {
+        Int_t j = Offset+iday-1;
+        Total += Curve.at(j);
+        for(int ifree=0 ; ifree<NFree ; ifree++) TotalGradient.at(ifree) += G.at(j*NFree+ifree);
+        if(iday<=NDays) {
+            forecast.Bins.push_back(forecast.LastBin+iday);
+            forecast.Daily.push_back(Curve.at(j));
+            forecast.Daily_error.push_back(GetError(&G.at(j*NFree)));
+            forecast.Cumulative.push_back(Total);
+            forecast.Cumulative_error.push_back(GetError(TotalGradient.data()));
+        }
+        if(iday == FinalDays) {
+            forecast.FinalToll = Total;
+            forecast.FinalToll_error = GetError(TotalGradient.data());
+        }
+    }
+
+    // the peak is refined between the days by the parabola through the maximum and its two neighbours, whose vertex
+    // Delta = (L-R)/(2(L-2f0+R)) and height f0-(L-R)Delta/4 are derived with respect to the parameters
+    Int_t Peak = max_element(Curve.begin(),Curve.end())-Curve.begin();
+    forecast.PeakX = X.at(Peak);
+    forecast.PeakHeight = Curve.at(Peak);
+    vector<Double_t> PeakGradient(&G.at(Peak*NFree),&G.at(Peak*NFree)+NFree), HeightGradient = PeakGradient;
+    std::fill(PeakGradient.begin(),PeakGradient.end(),0.);
+    if(Peak>0 && Peak<NPoints-1) {
+        Double_t L = Curve.at(Peak-1), R = Curve.at(Peak+1);
+        Double_t Num = L-R;
+        Double_t Den = 2.*(L-2.*Curve.at(Peak)+R);
+        if(Den < 0.) {
+            Double_t Delta = Num/Den;
+            forecast.PeakX += Delta;
+            forecast.PeakHeight -= 0.25*Num*Delta;
+            for(int ifree=0 ; ifree<NFree ; ifree++) {
+                Double_t gL = G.at((Peak-1)*NFree+ifree), g0 = G.at(Peak*NFree+ifree), gR = G.at((Peak+1)*NFree+ifree);
+                PeakGradient.at(ifree) = ((gL-gR)*Den-Num*2.*(gL-2.*g0+gR))/(Den*Den);
+                HeightGradient.at(ifree) = g0+0.5*Delta*(gR-gL)+0.5*Delta*Delta*(gL-2.*g0+gR);
+            }
+        }
+    }
+    forecast.PeakX_error = GetError(PeakGradient.data());
+    forecast.PeakHeight_error = GetError(HeightGradient.data());
+
+    forecast.Valid = std::isfinite(forecast.FinalToll) && std::isfinite(forecast.PeakHeight);
+
+    return forecast.Valid;
+}
+
+// forecasts cached by fit, shared by the threads of the batches and of the server: the list is ordered from the most to
+// the least recently used forecast, the map giving the position of each key in the list
+static mutex fForecastMutex;
+static list<pair<TString,Forecast>> fForecasts;
+static map<TString,list<pair<TString,Forecast>>::iterator> fForecastIndex;
+static size_t fForecastCacheSize = 10000;
+
+// to drop the least recently used forecasts until the cache holds at most Size of them (fForecastMutex locked)
+static void EvictForecasts(size_t Size)
+{
+    while(fForecasts.size() > Size) {
+        fForecastIndex.erase(fForecasts.back().first);
+        fForecasts.pop_back();
+    }
+}
+
+Bool_t GetForecast(const ModelFit &fit, const Series &series, Forecast &forecast, Int_t NDays, Int_t FinalDays)
+{
+    // the key holds everything the projection depends on, the parameters being written exactly
+    TString Key = Form("%s|%d|%d|%d|%d|%d|%d|%d|%.17g|%.17g",series.Country.Data(),series.Cases,fit.Model,fit.FullModel,fit.XMin,fit.XMax,NDays,FinalDays,
+                       fit.Chi2,(series.Total_Deaths.empty()) ? 0. : series.Total_Deaths.back());
+    Key += Form("|%d",(series.Bins.empty()) ? -1 : series.Bins.back());
+    Key += GetCompartmentalKey(fit.Model);
+    for(auto &par : fit.Pars) Key += Form("|%.17g",par);
+
+    {
+        lock_guard<mutex> lock(fForecastMutex);
+        auto it = fForecastIndex.find(Key);
+        if(it != fForecastIndex.end()) {
+            fForecasts.splice(fForecasts.begin(),fForecasts,it->second);
+            forecast = it->second->second;
+            return forecast.Valid;
+        }
+    }
+
+    // the projection is computed outside of the lock, two threads asking for the same new forecast computing it both
+    ComputeForecast(fit,series,NDays,FinalDays,forecast);
+
+    lock_guard<mutex> lock(fForecastMutex);
+    auto it = fForecastIndex.find(Key);
+    if(it != fForecastIndex.end()) {
+        fForecasts.splice(fForecasts.begin(),fForecasts,it->second);
+        it->second->second = forecast;
+        return forecast.Valid;
+    }
+    EvictForecasts(fForecastCacheSize-1);
+    fForecasts.emplace_front(Key,forecast);
+    fForecastIndex[Key] = fForecasts.begin();
+
+    return forecast.Valid;
+}
+
+void ClearForecasts()
+{
+    lock_guard<mutex> lock(fForecastMutex);
+    fForecasts.clear();
+    fForecastIndex.clear();
+}
+
+size_t GetNForecasts()
+{
+    lock_guard<mutex> lock(fForecastMutex);
+    return fForecasts.size();
+}
+
+void SetForecastCacheSize(size_t Size)
+{
+    lock_guard<mutex> lock(fForecastMutex);
+    fForecastCacheSize = max(Size,(size_t)1);
+    EvictForecasts(fForecastCacheSize);
+}
+
+void PrintForecast(const AnalysisResult &result)
+{
+    const Series &series = result.Data;
+    TString Unit = (series.Cases) ? "cases" : "deaths";
+
+    for(auto &fit : result.Fits) {
+        Forecast forecast;
+        if(!GetForecast(fit,series,forecast,fForecastDays,fForecastFinalDays)) {
+            WARN_MESS << "The " << fModelNames[fit.Model] << " fit of " << result.Country << " cannot be projected" << ENDL;
+            continue;
+        }
+        INFO_MESS << fModelNames[fit.Model] << " forecast of " << result.Country << " after " << series.Dates.back();
+        cout << ((fit.Valid) ? "" : " (fit NOT valid)") << ", with 95% intervals:" << ENDL;
+        cout << Form("   next %d days: %.0f +/- %.0f %s, total %.0f +/- %.0f (%.1f +/- %.1f %s/day on %s)",(Int_t)forecast.Bins.size(),
+                     forecast.Cumulative.back()-forecast.LastTotal,forecast.Cumulative_error.back(),Unit.Data(),forecast.Cumulative.back(),forecast.Cumulative_error.back(),
+                     forecast.Daily.back(),forecast.Daily_error.back(),Unit.Data(),GetForecastDate(forecast.Bins.back()).Data()) << endl;
+        cout << Form("   peak on %s +/- %.1f days, %.1f +/- %.1f %s/day",GetForecastDate((Int_t)floor(forecast.PeakX)+1).Data(),forecast.PeakX_error,
+                     forecast.PeakHeight,forecast.PeakHeight_error,Unit.Data()) << endl;
+        cout << Form("   final toll after %d days: %.0f +/- %.0f %s",forecast.FinalDays,forecast.FinalToll,forecast.FinalToll_error,Unit.Data()) << endl;
+    }
+}
+
+void WriteForecastJSON(ostream &json, const Forecast &forecast)
+{
+    auto Number = [](Double_t x) { return (std::isfinite(x)) ? TString::Format("%.10g",x) : TString("null"); };
+
+    json << "{\"model\":\"" << ((forecast.Model>=0 && forecast.Model<kNModels) ? fModelNames[forecast.Model] : "") << "\",\"valid\":" << ((forecast.Valid) ? "true" : "false");
+    json << ",\"last_date\":\"" << GetForecastDate(forecast.LastBin) << "\",\"last_total\":" << Number(forecast.LastTotal) << ",\"dates\":[";
+    for(size_t i=0 ; i<forecast.Bins.size() ; i++) json << ((i) ? ",\"" : "\"") << GetForecastDate(forecast.Bins.at(i)) << "\"";
+    json << "],\"daily\":" << ToJSON(forecast.Daily) << ",\"daily_error\":" << ToJSON(forecast.Daily_error);
+    json << ",\"cumulative\":" << ToJSON(forecast.Cumulative) << ",\"cumulative_error\":" << ToJSON(forecast.Cumulative_error);
+    json << ",\"peak_date\":\"" << GetForecastDate((Int_t)floor(forecast.PeakX)+1) << "\",\"peak_x\":" << Number(forecast.PeakX) << ",\"peak_x_error\":" << Number(forecast.PeakX_error);
+    json << ",\"peak_height\":" << Number(forecast.PeakHeight) << ",\"peak_height_error\":" << Number(forecast.PeakHeight_error);
+    json << ",\"final_days\":" << forecast.FinalDays << ",\"final_toll\":" << Number(forecast.FinalToll) << ",\"final_toll_error\":" << Number(forecast.FinalToll_error) << "}";
+}
+
+void PrintFit(const ModelFit &fit)
+{
+    INFO_MESS << fModelNames[fit.Model] << ((fit.FullModel && (fit.Model==kModelD2 || fit.Model==kModelESIR2)) ? " full model" : " model");
+    cout << " fit: status " << fit.Status << ((fit.Valid) ? " (valid)" : " (NOT valid)") << ", Chi2/ndf = " << Form("%.2f",(fit.Ndf>0) ? fit.Chi2/fit.Ndf : 0.);
+    cout << ", " << fit.NCalls << " calls" << ENDL;
+    for(size_t ipar=0 ; ipar<fit.Pars.size() ; ipar++) {
+        cout << Form("%10s = %12.4g +/- %.4g",fit.ParNames.at(ipar).Data(),fit.Pars.at(ipar),fit.Errors.at(ipar)) << endl;
+    }
+
+    // the compartmental fits are compared with the same epidemic without, and with half, the fitted reduction of the transmission
+    if(!IsCompartmental(fit.Model) || fit.Pars.size() != (size_t)kNCompartmentalPars) return;
+    vector<Double_t> Reductions = {fit.Pars.at(2),fit.Pars.at(2)/2,0.};
+    vector<vector<Double_t>> Curves;
+    if(!CompartmentalScenarios(fit,Reductions,Curves)) return;
+    for(size_t k=0 ; k<Reductions.size() ; k++) {
+        Double_t Deaths = 0.;
+        for(auto Daily : Curves.at(k)) Deaths += Daily;
+        cout << Form("%10s   %12.4g deaths up to the end of 2021 with m = %.2f",(k) ? "" : "scenarios",Deaths,Reductions.at(k)) << endl;
+    }
+}
+
+void Scan(TString theCountry, vector<Int_t> Smoothings, vector<TString> FitFrom, vector<TString> FitTo, Int_t NThreads)
+{
+    // the file is read only once, the smoothing for all the windows is then obtained from the same prefix sums
+    Series series;
+    if(LoadSeries(theCountry,series) == false) return;
+
+    if(Smoothings.empty()) Smoothings.push_back(fNSmoothing);
+    if(FitFrom.empty()) FitFrom.push_back(fFitRangeFrom);
+    if(FitTo.empty()) FitTo.push_back(fFitRangeTo);
+
+    for(auto &date : FitFrom) {
+        if(date!="" && GetDateBin(date)==-1) {
+            WARN_MESS << date << " not found in the histogram date range, ignored" << ENDL;
+            date = "";
+        }
+    }
+    for(auto &date : FitTo) {
+        if(date!="" && GetDateBin(date)==-1) {
+            WARN_MESS << date << " not found in the histogram date range, ignored" << ENDL;
+            date = "";
+        }
+    }
+
+    vector<Series> vSmoothed(Smoothings.size(),series);
+    for(size_t ismooth=0 ; ismooth<Smoothings.size() ; ismooth++) SmoothSeries(vSmoothed.at(ismooth),Smoothings.at(ismooth));
+
+    vector<Int_t> Models = GetModels();
+
+    // one result per grid point and per model
+    size_t NFrom = FitFrom.size();
+    size_t NTo = FitTo.size();
+    vector< vector<ModelFit> > Grid(Smoothings.size()*NFrom*NTo,vector<ModelFit>(Models.size()));
+
+    // one task per smoothing and fit start: the fit ends are scanned in order, each fit starting from the result of its neighbour
+    RunParallel(Smoothings.size()*NFrom,NThreads,[&](Int_t itask) {
+        size_t ismooth = itask/NFrom;
+        size_t ifrom = itask%NFrom;
+        const Series &smoothed = vSmoothed.at(ismooth);
+
+        for(size_t ito=0 ; ito<NTo ; ito++) {
+            Int_t XMin,XMax;
+            GetFitRange(smoothed,FitFrom.at(ifrom),FitTo.at(ito),XMin,XMax);
+
+            vector<ModelFit> &Fits = Grid.at(itask*NTo+ito);
+            for(size_t imodel=0 ; imodel<Models.size() ; imodel++) {
+                const ModelFit *Previous = (ito>0) ? &Grid.at(itask*NTo+ito-1).at(imodel) : nullptr;
+                FitModel(Models.at(imodel),smoothed,XMin,XMax,Fits.at(imodel),Previous);
+            }
+        }
+    });
+
+    // all the grid points are written in a file, one line per parameter
+    gSystem->mkdir("Scans");
+    TString OutputFileName = Form("Scans/scan_%s.csv",theCountry.Data());
+    ofstream file(OutputFileName);
+    file << "smoothing,fit_from,fit_to,model,status,chi2_ndf,parameter,value,error" << endl;
+    for(size_t igrid=0 ; igrid<Grid.size() ; igrid++) {
+        size_t ismooth = igrid/(NFrom*NTo);
+        size_t ifrom = (igrid/NTo)%NFrom;
+        size_t ito = igrid%NTo;
+        for(auto &fit : Grid.at(igrid)) {
+            for(size_t ipar=0 ; ipar<fit.Pars.size() ; ipar++) {
+                file << Smoothings.at(ismooth) << "," << FitFrom.at(ifrom) << "," << FitTo.at(ito) << "," << fModelNames[fit.Model] << ",";
+                file << fit.Status << "," << ((fit.Ndf>0) ? fit.Chi2/fit.Ndf : 0.) << "," << fit.ParNames.at(ipar) << ",";
+                file << fit.Pars.at(ipar) << "," << fit.Errors.at(ipar) << endl;
+            }
+        }
+    }
+    file.close();
+
+    // the stability table gives, for each parameter, the dispersion of the values over all the valid fits of the grid
+    TString TableFileName = Form("Scans/scan_%s_stability.txt",theCountry.Data());
+    ofstream table(TableFileName);
+    INFO_MESS << "Parameters stability for " << theCountry << ": " << Smoothings.size() << " smoothings x " << NFrom << " fit starts x " << NTo << " fit ends" << ENDL;
+    for(size_t imodel=0 ; imodel<Models.size() ; imodel++) {
+        vector<const ModelFit*> Valids;
+        for(auto &fits : Grid) if(fits.at(imodel).Valid) Valids.push_back(&fits.at(imodel));
+
+        TString Title = Form("%s model: %d valid fits over %d",fModelNames[Models.at(imodel)],(Int_t)Valids.size(),(Int_t)Grid.size());
+        TITLE_MESS << Title << ENDL;
+        table << Title << endl;
+        if(Valids.empty()) continue;
+
+        TString Header = Form("%10s %12s %12s %12s %12s %10s","parameter","mean","rms","min","max","rms/mean");
+        cout << Header << endl;
+        table << Header << endl;
+        for(size_t ipar=0 ; ipar<Valids.front()->Pars.size() ; ipar++) {
+            Double_t Sum=0., Sum2=0.;
+            Double_t Min=Valids.front()->Pars.at(ipar), Max=Min;
+            for(auto fit : Valids) {
+                Double_t Value = fit->Pars.at(ipar);
+                Sum += Value;
+                Sum2 += Value*Value;
+                Min = min(Min,Value);
+                Max = max(Max,Value);
+            }
+            Double_t Mean = Sum/Valids.size();
+            Double_t RMS = sqrt(max(0.,Sum2/Valids.size()-Mean*Mean));
+            TString Line = Form("%10s %12.4g %12.4g %12.4g %12.4g %9.1f%%",Valids.front()->ParNames.at(ipar).Data(),Mean,RMS,Min,Max,(Mean!=0.) ? 100.*RMS/fabs(Mean) : 0.);
+            cout << Line << endl;
+            table << Line << endl;
+        }
+    }
+    table.close();
+
+    INFO_MESS << "Scan results written in " << OutputFileName << " and " << TableFileName << ENDL;
+}
+
+void Scan(vector<TString> Countries, vector<Int_t> Smoothings, vector<TString> FitFrom, vector<TString> FitTo, Int_t NThreads)
+{
+    for(auto &country : Countries) Scan(country,Smoothings,FitFrom,FitTo,NThreads);
+}
+
+
+TString ToJSON(const vector<Double_t> &values)
+{
+    // the non finite values (failed fits) are written as null, which is not a valid JSON number
+    TString Buffer = "[";
+    for(size_t i=0 ; i<values.size() ; i++) {
+        if(i) Buffer += ",";
+        if(std::isfinite(values.at(i))) Buffer += TString::Format("%.10g",values.at(i));
+        else Buffer += "null";
+    }
+    Buffer += "]";
+
+    return Buffer;
+}
+
+bool OpenExporter(Exporter &exporter, TString FileName, TString Format)
+{
+    Format.ToLower();
+    exporter.FileName = FileName;
+    exporter.DoCSV = Format.Contains("csv");
+    exporter.DoJSON = Format.Contains("json");
+    exporter.DoROOT = Format.Contains("root");
+
+    if(!exporter.DoCSV && !exporter.DoJSON && !exporter.DoROOT) {
+        ERR_MESS << "Unknown export format: " << Format << ", use csv, json and/or root" << ENDL;
+        return false;
+    }
+
+    gSystem->mkdir(gSystem->DirName(FileName),true);
+
+    // the files are created once per batch, the records being then only appended
+    if(exporter.DoCSV) {
+        exporter.FitsCSV.open(FileName+"_fits.csv");
+        exporter.CovarianceCSV.open(FileName+"_covariance.csv");
+        exporter.CurvesCSV.open(FileName+"_curves.csv");
+        if(fDoRt) exporter.RtCSV.open(FileName+"_rt.csv");
+        if(fDoDeconvolution) exporter.InfectionsCSV.open(FileName+"_infections.csv");
+        if(fDoForecast) exporter.ForecastCSV.open(FileName+"_forecast.csv");
+        if(!exporter.FitsCSV || !exporter.CovarianceCSV || !exporter.CurvesCSV || (fDoRt && !exporter.RtCSV) || (fDoDeconvolution && !exporter.InfectionsCSV)
+           || (fDoForecast && !exporter.ForecastCSV)) {
+            ERR_MESS << "Cannot create the csv files " << FileName << "_*.csv" << ENDL;
+            return false;
+        }
+        exporter.FitsCSV.precision(10);
+        exporter.CovarianceCSV.precision(10);
+        exporter.CurvesCSV.precision(10);
+        exporter.FitsCSV << "country,last_date,smoothing,model,full_model,fit_from,fit_to,status,valid,chi2,ndf,ncalls,parameter,value,error" << endl;
+        exporter.CovarianceCSV << "country,model,parameter1,parameter2,covariance" << endl;
+        exporter.CurvesCSV << "country,model,date,data,data_error,fit,band_error" << endl;
+        if(fDoRt) {
+            exporter.RtCSV.precision(10);
+            exporter.RtCSV << "country,date,rt,rt_low,rt_high" << endl;
+        }
+        if(fDoDeconvolution) {
+            exporter.InfectionsCSV.precision(10);
+            exporter.InfectionsCSV << "country,curve,date,infections,reliable" << endl;
+        }
+        if(fDoForecast) {
+            exporter.ForecastCSV.precision(10);
+            exporter.ForecastCSV << "country,model,date,daily,daily_error,cumulative,cumulative_error" << endl;
+        }
+    }
+    if(exporter.DoJSON) {
+        exporter.JSON.open(FileName+".jsonl");
+        if(!exporter.JSON) {
+            ERR_MESS << "Cannot create the json file " << FileName << ".jsonl" << ENDL;
+            return false;
+        }
+    }
+    if(exporter.DoROOT) {
+        exporter.File = new TFile(FileName+".root","RECREATE");
+        if(exporter.File->IsZombie()) {
+            ERR_MESS << "Cannot create the root file " << FileName << ".root" << ENDL;
+            delete exporter.File;
+            exporter.File = nullptr;
+            return false;
+        }
+        exporter.Tree = new TTree("fits","Fit results, one entry per country and model");
+        exporter.Tree->SetDirectory(exporter.File);
+        exporter.Tree->Branch("country",&exporter.Country);
+        exporter.Tree->Branch("last_date",&exporter.LastDate);
+        exporter.Tree->Branch("smoothing",&exporter.Smoothing);
+        exporter.Tree->Branch("model",&exporter.Model);
+        exporter.Tree->Branch("full_model",&exporter.FullModel);
+        exporter.Tree->Branch("fit_from",&exporter.FitFrom);
+        exporter.Tree->Branch("fit_to",&exporter.FitTo);
+        exporter.Tree->Branch("status",&exporter.Status);
+        exporter.Tree->Branch("valid",&exporter.Valid);
+        exporter.Tree->Branch("chi2",&exporter.Chi2);
+        exporter.Tree->Branch("ndf",&exporter.Ndf);
+        exporter.Tree->Branch("ncalls",&exporter.NCalls);
+        exporter.Tree->Branch("par_names",&exporter.ParNames);
+        exporter.Tree->Branch("pars",&exporter.Pars);
+        exporter.Tree->Branch("errors",&exporter.Errors);
+        exporter.Tree->Branch("covariance",&exporter.Covariance);
+        exporter.Tree->Branch("first_bin",&exporter.FirstBin);
+        exporter.Tree->Branch("data",&exporter.Data);
+        exporter.Tree->Branch("data_error",&exporter.Data_error);
+        exporter.Tree->Branch("fit",&exporter.Fit);
+        exporter.Tree->Branch("band_error",&exporter.Band_error);
+    }
+
+    return true;
+}
+
+void SampleResult(const AnalysisResult &result, Int_t &DateMin, vector<TString> &Dates, vector<Double_t> &Data, vector<Double_t> &Data_error)
+{
+    const Series &series = result.Data;
+
+    Int_t DateMax;
+    GetAxisRange(series,DateMin,DateMax);
+    Int_t NDays = max(0,DateMax-DateMin+1);
+
+    Data.assign(NDays,0.);
+    Data_error.assign(NDays,0.);
+    for(size_t i=0 ; i<series.Dates.size() && i<series.Daily_Deaths.size() ; i++) {
+        Int_t Bin = series.Bins.at(i);
+        if(Bin>=DateMin && Bin<=DateMax) {
+            Data.at(Bin-DateMin) = series.Daily_Deaths.at(i);
+            Data_error.at(Bin-DateMin) = series.Daily_Deaths_error.at(i);
+        }
+    }
+    Dates.resize(NDays);
+    for(int iday=0 ; iday<NDays ; iday++) Dates.at(iday) = GetBinDate(DateMin+iday);
+}
+
+void SampleCurve(const vector<Double_t> &band, Int_t DateMin, Int_t NDays, vector<Double_t> &curve)
+{
+    curve.assign(NDays,0.);
+    for(int iday=0 ; iday<NDays ; iday++) {
+        if(DateMin+iday-1 < (Int_t)band.size()) curve.at(iday) = band.at(DateMin+iday-1);
+    }
+}
+
+void WriteResultJSON(ostream &json, const AnalysisResult &result)
+{
+    const Series &series = result.Data;
+    if(series.Dates.empty()) return;
+
+    Int_t DateMin;
+    vector<TString> Dates;
+    vector<Double_t> Data, Data_error;
+    SampleResult(result,DateMin,Dates,Data,Data_error);
+    Int_t NDays = Dates.size();
+
+    json << "{\"country\":\"" << result.Country << "\",\"last_date\":\"" << series.Dates.back() << "\",\"smoothing\":" << series.NSmoothing;
+    if(series.Weekly) json << ",\"weekday_factors\":" << ToJSON(series.Weekday_Factors);
+    json << ",\"fit_from\":\"" << GetBinDate(result.XMin) << "\",\"fit_to\":\"" << GetBinDate(result.XMax) << "\",\"dates\":[";
+    for(int iday=0 ; iday<NDays ; iday++) json << ((iday) ? ",\"" : "\"") << Dates.at(iday) << "\"";
+    json << "],\"data\":" << ToJSON(Data) << ",\"data_error\":" << ToJSON(Data_error) << ",\"fits\":[";
+    for(size_t ifit=0 ; ifit<result.Fits.size() ; ifit++) {
+        const ModelFit &fit = result.Fits.at(ifit);
+        vector<Double_t> Curve, Curve_error;
+        SampleCurve(fit.Band,DateMin,NDays,Curve);
+        SampleCurve(fit.Band_error,DateMin,NDays,Curve_error);
+
+        json << ((ifit) ? ",{" : "{") << "\"model\":\"" << fModelNames[fit.Model] << "\",\"full_model\":" << ((fit.FullModel) ? "true" : "false");
+        json << ",\"status\":" << fit.Status << ",\"valid\":" << ((fit.Valid) ? "true" : "false");
+        json << ",\"chi2\":" << ((std::isfinite(fit.Chi2)) ? TString::Format("%.10g",fit.Chi2) : TString("null")) << ",\"ndf\":" << fit.Ndf << ",\"ncalls\":" << fit.NCalls;
+        json << ",\"parameters\":[";
+        for(size_t ipar=0 ; ipar<fit.ParNames.size() ; ipar++) json << ((ipar) ? ",\"" : "\"") << fit.ParNames.at(ipar) << "\"";
+        json << "],\"values\":" << ToJSON(fit.Pars) << ",\"errors\":" << ToJSON(fit.Errors) << ",\"covariance\":" << ToJSON(fit.Covariance);
+        json << ",\"anomalies_in_range\":" << CountAnomalies(series,fit.XMin,fit.XMax);
+        json << ",\"fit\":" << ToJSON(Curve) << ",\"band_error\":" << ToJSON(Curve_error);
+        if(fDoForecast) {
+            Forecast forecast;
+            GetForecast(fit,series,forecast,fForecastDays,fForecastFinalDays);
+            json << ",\"forecast\":";
+            WriteForecastJSON(json,forecast);
+        }
+        json << "}";
+    }
+    json << "],\"anomalies\":[";
+    for(size_t i=0 ; i<series.Anomalies.size() ; i++) {
+        const Anomaly &anomaly = series.Anomalies.at(i);
+        json << ((i) ? ",{" : "{") << "\"date\":\"" << series.Dates.at(min(anomaly.Index,(Int_t)series.Dates.size()-1)) << "\",\"type\":\"" << fAnomalyNames[anomaly.Type];
+        json << "\",\"value\":" << Form("%.10g",anomaly.Value) << ",\"expected\":" << Form("%.10g",anomaly.Expected) << ",\"score\":" << Form("%.4g",anomaly.Score);
+        json << ",\"correction\":\"" << fAnomalyModeNames[anomaly.Mode] << "\",\"unabsorbed\":" << Form("%.10g",anomaly.Unabsorbed) << "}";
+    }
+    json << "]";
+
+    const RtEstimate &rt = result.Rt;
+    if(rt.Valid) {
+        json << ",\"rt\":{\"dates\":[";
+        for(size_t i=0 ; i<rt.Bins.size() ; i++) json << ((i) ? ",\"" : "\"") << GetBinDate(rt.Bins.at(i)) << "\"";
+        json << "],\"mean\":" << ToJSON(rt.Mean) << ",\"low\":" << ToJSON(rt.Low) << ",\"high\":" << ToJSON(rt.High) << "}";
+    }
+
+    // the infections are sampled on the same days as the data
+    const InfectionCurves &infections = result.Infections;
+    if(infections.Valid) {
+        vector<Double_t> Curve;
+        SampleCurve(infections.Data,DateMin,NDays,Curve);
+        json << ",\"infections\":{\"method\":\"" << fDeconvolutionNames[fDeconvolutionMethod] << "\",\"last_reliable\":\"" << GetBinDate(infections.LastReliableBin);
+        json << "\",\"data\":" << ToJSON(Curve) << ",\"fits\":[";
+        for(size_t ifit=0 ; ifit<infections.Fits.size() ; ifit++) {
+            SampleCurve(infections.Fits.at(ifit),DateMin,NDays,Curve);
+            json << ((ifit) ? "," : "") << ToJSON(Curve);
+        }
+        json << "]}";
+    }
+
+    // the cases are written as a result on their own, with their lag
+    if(!result.Cases.Dates.empty()) {
+        const LagEstimate &lag = result.Lag;
+        json << ",\"lag\":{\"days\":" << lag.Lag << ",\"ratio\":" << Form("%.6g",lag.Ratio) << ",\"correlation\":" << Form("%.4f",lag.Correlation);
+        json << ",\"valid\":" << ((lag.Valid) ? "true" : "false") << "},\"cases\":";
+        WriteResultJSON(json,GetCasesResult(result));
+    }
+    json << "}";
+}
+
+void WriteResult(Exporter &exporter, const AnalysisResult &result)
+{
+    const Series &series = result.Data;
+    if(series.Dates.empty()) return;
+
+    // the data and the curves are sampled on each day of the axis range
+    Int_t DateMin;
+    vector<TString> Dates;
+    vector<Double_t> Data, Data_error;
+    SampleResult(result,DateMin,Dates,Data,Data_error);
+    Int_t NDays = Dates.size();
+
+    TString LastDate = series.Dates.back();
+    TString FitFrom = GetBinDate(result.XMin);
+    TString FitTo = GetBinDate(result.XMax);
+
+    if(exporter.DoCSV) {
+        for(auto &fit : result.Fits) {
+            const char *ModelName = fModelNames[fit.Model];
+            for(size_t ipar=0 ; ipar<fit.Pars.size() ; ipar++) {
+                exporter.FitsCSV << result.Country << "," << LastDate << "," << series.NSmoothing << "," << ModelName << "," << fit.FullModel << ",";
+                exporter.FitsCSV << FitFrom << "," << FitTo << "," << fit.Status << "," << fit.Valid << "," << fit.Chi2 << "," << fit.Ndf << "," << fit.NCalls << ",";
+                exporter.FitsCSV << fit.ParNames.at(ipar) << "," << fit.Pars.at(ipar) << "," << fit.Errors.at(ipar) << endl;
+            }
+            size_t NPars = fit.Pars.size();
+            for(size_t i=0 ; i<NPars && fit.Covariance.size()==NPars*NPars ; i++) {
+                for(size_t j=0 ; j<NPars ; j++) {
+                    exporter.CovarianceCSV << result.Country << "," << ModelName << "," << fit.ParNames.at(i) << "," << fit.ParNames.at(j) << "," << fit.Covariance.at(i*NPars+j) << endl;
+                }
+            }
+            vector<Double_t> Curve, Curve_error;
+            SampleCurve(fit.Band,DateMin,NDays,Curve);
+            SampleCurve(fit.Band_error,DateMin,NDays,Curve_error);
+            for(int iday=0 ; iday<NDays ; iday++) {
+                exporter.CurvesCSV << result.Country << "," << ModelName << "," << Dates.at(iday) << "," << Data.at(iday) << "," << Data_error.at(iday) << ",";
+                exporter.CurvesCSV << Curve.at(iday) << "," << Curve_error.at(iday) << endl;
+            }
+        }
+        const RtEstimate &rt = result.Rt;
+        for(size_t i=0 ; i<rt.Bins.size() && exporter.RtCSV.is_open() ; i++) {
+            exporter.RtCSV << result.Country << "," << GetBinDate(rt.Bins.at(i)) << "," << rt.Mean.at(i) << "," << rt.Low.at(i) << "," << rt.High.at(i) << endl;
+        }
+        const InfectionCurves &infections = result.Infections;
+        if(infections.Valid && exporter.InfectionsCSV.is_open()) {
+            vector<Double_t> Curve;
+            for(int icurve=0 ; icurve<=(Int_t)infections.Fits.size() ; icurve++) {
+                TString Name = (icurve) ? fModelNames[result.Fits.at(icurve-1).Model] : "data";
+                SampleCurve((icurve) ? infections.Fits.at(icurve-1) : infections.Data,DateMin,NDays,Curve);
+                for(int iday=0 ; iday<NDays ; iday++) {
+                    exporter.InfectionsCSV << result.Country << "," << Name << "," << Dates.at(iday) << "," << Curve.at(iday) << "," << (DateMin+iday<=infections.LastReliableBin) << endl;
+                }
+            }
+        }
+        for(size_t ifit=0 ; ifit<result.Fits.size() && exporter.ForecastCSV.is_open() ; ifit++) {
+            Forecast forecast;
+            if(!GetForecast(result.Fits.at(ifit),series,forecast,fForecastDays,fForecastFinalDays)) continue;
+            for(size_t i=0 ; i<forecast.Bins.size() ; i++) {
+                exporter.ForecastCSV << result.Country << "," << fModelNames[forecast.Model] << "," << GetForecastDate(forecast.Bins.at(i)) << "," << forecast.Daily.at(i) << ",";
+                exporter.ForecastCSV << forecast.Daily_error.at(i) << "," << forecast.Cumulative.at(i) << "," << forecast.Cumulative_error.at(i) << endl;
+            }
+        }
+        exporter.FitsCSV.flush();
+        exporter.CovarianceCSV.flush();
+        exporter.CurvesCSV.flush();
+        if(exporter.RtCSV.is_open()) exporter.RtCSV.flush();
+        if(exporter.InfectionsCSV.is_open()) exporter.InfectionsCSV.flush();
+        if(exporter.ForecastCSV.is_open()) exporter.ForecastCSV.flush();
+    }
+
+    if(exporter.DoJSON) {
+        WriteResultJSON(exporter.JSON,result);
+        exporter.JSON << endl;
+    }
+
+    if(exporter.DoROOT && exporter.Tree) {
+        exporter.Country = result.Country.Data();
+        exporter.LastDate = LastDate.Data();
+        exporter.Smoothing = series.NSmoothing;
+        exporter.FitFrom = FitFrom.Data();
+        exporter.FitTo = FitTo.Data();
+        exporter.FirstBin = DateMin;
+        exporter.Data = Data;
+        exporter.Data_error = Data_error;
+        for(auto &fit : result.Fits) {
+            exporter.Model = fModelNames[fit.Model];
+            exporter.FullModel = fit.FullModel;
+            exporter.Status = fit.Status;
+            exporter.Valid = fit.Valid;
+            exporter.Chi2 = fit.Chi2;
+            exporter.Ndf = fit.Ndf;
+            exporter.NCalls = fit.NCalls;
+            exporter.ParNames.clear();
+            for(auto &name : fit.ParNames) exporter.ParNames.push_back(name.Data());
+            exporter.Pars = fit.Pars;
+            exporter.Errors = fit.Errors;
+            exporter.Covariance = fit.Covariance;
+            SampleCurve(fit.Band,DateMin,NDays,exporter.Fit);
+            SampleCurve(fit.Band_error,DateMin,NDays,exporter.Band_error);
+            exporter.Tree->Fill();
+        }
+    }
+}
+
+void CloseExporter(Exporter &exporter)
+{
+    if(exporter.DoCSV) {
+        exporter.FitsCSV.close();
+        exporter.CovarianceCSV.close();
+        exporter.CurvesCSV.close();
+        if(exporter.RtCSV.is_open()) exporter.RtCSV.close();
+        if(exporter.InfectionsCSV.is_open()) exporter.InfectionsCSV.close();
+        if(exporter.ForecastCSV.is_open()) exporter.ForecastCSV.close();
+    }
+    if(exporter.DoJSON) exporter.JSON.close();
+    if(exporter.File) {
+        exporter.File->cd();
+        exporter.Tree->Write();
+        exporter.File->Close();
+        // the tree is owned and deleted by the file
+        delete exporter.File;
+        exporter.File = nullptr;
+        exporter.Tree = nullptr;
+    }
+
+    INFO_MESS << "Results exported in " << exporter.FileName << ((exporter.DoCSV) ? " [csv]" : "") << ((exporter.DoJSON) ? " [json]" : "") << ((exporter.DoROOT) ? " [root]" : "") << ENDL;
+}
+
+void ExportResults(const vector<AnalysisResult> &Results, TString FileName, TString Format)
+{
+    Exporter exporter;
+    if(OpenExporter(exporter,FileName,Format) == false) return;
+    for(auto &result : Results) WriteResult(exporter,result);
+    CloseExporter(exporter);
+}
+
+Int_t Export(vector<TString> Countries, TString FileName, TString Format, Int_t NThreads)
+{
+    Exporter exporter;
+    if(OpenExporter(exporter,FileName,Format) == false) return 0;
+
+    // the countries are analysed in parallel without any graphics, the records are then written in the input order
+    vector<AnalysisResult> Results(Countries.size());
+    vector<Int_t> DataOk(Countries.size(),0);
+    RunParallel(Countries.size(),NThreads,[&](Int_t icountry) {
+        DataOk.at(icountry) = AnalyseData(Countries.at(icountry),Results.at(icountry));
+    });
+
+    vector<AnalysisResult> Saved;
+    Int_t NExported = 0;
+    for(size_t icountry=0 ; icountry<Countries.size() ; icountry++) {
+        if(DataOk.at(icountry)) {
+            WriteResult(exporter,Results.at(icountry));
+            NExported++;
+        }
+        else WARN_MESS << "No data for " << Countries.at(icountry) << ", not exported" << ENDL;
+        if(DataOk.at(icountry) && (fStateFile!="" || fTimingFile!="")) Saved.push_back(Results.at(icountry));
+    }
+
+    CloseExporter(exporter);
+
+    if(fStateFile!="") SaveState(Saved,fStateFile);
+    if(fTimingFile!="") WriteTimings(Saved,fTimingFile);
+
+    return NExported;
+}
+
+void SerializeResult(const AnalysisResult &result, string &buffer)
+{
+    buffer.clear();
+
+    const Series &series = result.Data;
+    WriteBuffer(buffer,result.Country);
+    WriteBuffer(buffer,result.XMin);
+    WriteBuffer(buffer,result.XMax);
+
+    // the prefix sums are not needed to plot a result, they are not sent
+    WriteBuffer(buffer,series.Country);
+    WriteBuffer(buffer,series.Cases);
+    WriteBuffer(buffer,series.Dates);
+    WriteBuffer(buffer,series.Bins);
+    WriteBuffer(buffer,series.Total_Deaths);
+    WriteBuffer(buffer,series.Raw_Daily_Deaths);
+    WriteBuffer(buffer,series.NSmoothing);
+    WriteBuffer(buffer,series.Weekly);
+    WriteBuffer(buffer,series.Weekday_Factors);
+    WriteBuffer(buffer,series.Daily_Deaths);
+    WriteBuffer(buffer,series.Daily_Deaths_error);
+    WriteBuffer(buffer,series.Waves);
+
+    WriteBuffer(buffer,(UInt_t)result.Fits.size());
+    for(auto &fit : result.Fits) {
+        WriteBuffer(buffer,fit.Model);
+        WriteBuffer(buffer,fit.FullModel);
+        WriteBuffer(buffer,fit.XMin);
+        WriteBuffer(buffer,fit.XMax);
+        WriteBuffer(buffer,fit.ParNames);
+        WriteBuffer(buffer,fit.Pars);
+        WriteBuffer(buffer,fit.Errors);
+        WriteBuffer(buffer,fit.Covariance);
+        WriteBuffer(buffer,fit.Chi2);
+        WriteBuffer(buffer,fit.Ndf);
+        WriteBuffer(buffer,fit.Status);
+        WriteBuffer(buffer,fit.Valid);
+        WriteBuffer(buffer,fit.NCalls);
+        WriteBuffer(buffer,fit.Band);
+        WriteBuffer(buffer,fit.Band_error);
+    }
+}
+
+bool DeserializeResult(const string &buffer, AnalysisResult &result)
+{
+    result = AnalysisResult();
+    size_t pos = 0;
+
+    Series &series = result.Data;
+    bool ok = ReadBuffer(buffer,pos,result.Country) && ReadBuffer(buffer,pos,result.XMin) && ReadBuffer(buffer,pos,result.XMax);
+    ok = ok && ReadBuffer(buffer,pos,series.Country) && ReadBuffer(buffer,pos,series.Cases) && ReadBuffer(buffer,pos,series.Dates) && ReadBuffer(buffer,pos,series.Bins);
+    ok = ok && ReadBuffer(buffer,pos,series.Total_Deaths) && ReadBuffer(buffer,pos,series.Raw_Daily_Deaths) && ReadBuffer(buffer,pos,series.NSmoothing);
+    ok = ok && ReadBuffer(buffer,pos,series.Weekly) && ReadBuffer(buffer,pos,series.Weekday_Factors);
+    ok = ok && ReadBuffer(buffer,pos,series.Daily_Deaths) && ReadBuffer(buffer,pos,series.Daily_Deaths_error) && ReadBuffer(buffer,pos,series.Waves);
+
+    UInt_t NFits = 0;
+    ok = ok && ReadBuffer(buffer,pos,NFits);
+    for(UInt_t ifit=0 ; ok && ifit<NFits ; ifit++) {
+        ModelFit fit;
+        ok = ReadBuffer(buffer,pos,fit.Model) && ReadBuffer(buffer,pos,fit.FullModel) && ReadBuffer(buffer,pos,fit.XMin) && ReadBuffer(buffer,pos,fit.XMax);
+        ok = ok && ReadBuffer(buffer,pos,fit.ParNames) && ReadBuffer(buffer,pos,fit.Pars) && ReadBuffer(buffer,pos,fit.Errors) && ReadBuffer(buffer,pos,fit.Covariance);
+        ok = ok && ReadBuffer(buffer,pos,fit.Chi2) && ReadBuffer(buffer,pos,fit.Ndf) && ReadBuffer(buffer,pos,fit.Status) && ReadBuffer(buffer,pos,fit.Valid);
+        ok = ok && ReadBuffer(buffer,pos,fit.NCalls) && ReadBuffer(buffer,pos,fit.Band) && ReadBuffer(buffer,pos,fit.Band_error);
+        ok = ok && fit.Model>=0 && fit.Model<kNModels;
+        if(ok) result.Fits.push_back(fit);
+    }
+
+    return ok;
+}
+
+bool WriteAll(int fd, const char *data, size_t size)
+{
+    while(size>0) {
+        ssize_t n = write(fd,data,size);
+        if(n<0 && errno==EINTR) continue;
+        if(n<=0) return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool ReadAll(int fd, char *data, size_t size)
+{
+    while(size>0) {
+        ssize_t n = read(fd,data,size);
+        if(n<0 && errno==EINTR) continue;
+        if(n<=0) return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+void RenderWorker(Int_t iworker, int input, int ready)
+{
+    // the plots are done in batch mode, the canvas being reused from one country to the other
+    gROOT->SetBatch(true);
+
+    // the drawing and picture times of the worker are printed when it stops
+    Timing timing;
+    Int_t NPlots = 0;
+
+    while(true) {
+        // the worker tells that it is idle, and waits for a result (the end of the input stops the worker)
+        if(!WriteAll(ready,(const char*)&iworker,sizeof(iworker))) break;
+
+        ULong64_t Size;
+        if(!ReadAll(input,(char*)&Size,sizeof(Size))) break;
+        string buffer(Size,'\0');
+        if(!ReadAll(input,&buffer[0],Size)) break;
+
+        AnalysisResult result;
+        if(DeserializeResult(buffer,result)) {
+            DrawResult(result,&timing);
+            NPlots++;
+        }
+        else ERR_MESS << "Render worker " << iworker << ": corrupted result received" << ENDL;
+    }
+
+    if(NPlots) INFO_MESS << Form("Render worker %d: %d plots, draw %.3f s, picture %.3f s",iworker,NPlots,
+                                 timing.RealTime[kStageDraw],timing.RealTime[kStagePicture]) << ENDL;
+}
+
+bool StartRenderQueue(RenderQueue &queue, Int_t NWorkers)
+{
+    if(NWorkers<=0) NWorkers = max(1u,thread::hardware_concurrency()/2);
+
+    // a worker that dies should not kill the main process when its pipe is written
+    signal(SIGPIPE,SIG_IGN);
+
+    int ready[2];
+    if(pipe(ready) != 0) {
+        ERR_MESS << "Cannot create the render queue pipes" << ENDL;
+        return false;
+    }
+
+    // the workers are forked before any thread is started, they inherit all the current options
+    cout.flush();
+    for(int iworker=0 ; iworker<NWorkers ; iworker++) {
+        int fd[2];
+        if(pipe(fd) != 0) break;
+
+        pid_t pid = fork();
+        if(pid < 0) {
+            close(fd[0]);
+            close(fd[1]);
+            break;
+        }
+        if(pid == 0) {
+            // the inputs of the other workers are closed in this process, so that they can see the end of their input
+            close(fd[1]);
+            close(ready[0]);
+            for(auto other : queue.Pipes) close(other);
+            RenderWorker(iworker,fd[0],ready[1]);
+            // the ROOT cleanup of the main process must not be run by the worker
+            cout.flush();
+            _exit(0);
+        }
+        close(fd[0]);
+        queue.Workers.push_back(pid);
+        queue.Pipes.push_back(fd[1]);
+    }
+    close(ready[1]);
+    queue.ReadyPipe = ready[0];
+
+    if(queue.Workers.empty()) {
+        ERR_MESS << "Cannot start the render workers" << ENDL;
+        close(queue.ReadyPipe);
+        return false;
+    }
+
+    // the queued results are sent one by one to the first idle worker, without blocking the fits
+    queue.Dispatcher = thread([&queue]() {
+        while(true) {
+            string message;
+            {
+                unique_lock<mutex> lock(queue.Mutex);
+                queue.Condition.wait(lock,[&queue]() {return queue.Stop || !queue.Queue.empty();});
+                if(queue.Queue.empty()) return;
+                message = move(queue.Queue.front());
+                queue.Queue.pop_front();
+            }
+
+            Int_t iworker;
+            if(!ReadAll(queue.ReadyPipe,(char*)&iworker,sizeof(iworker)) || iworker<0 || iworker>=(Int_t)queue.Pipes.size()) {
+                ERR_MESS << "No render worker available anymore, the remaining plots are not done" << ENDL;
+                return;
+            }
+            ULong64_t Size = message.size();
+            if(!WriteAll(queue.Pipes.at(iworker),(const char*)&Size,sizeof(Size)) || !WriteAll(queue.Pipes.at(iworker),message.data(),Size)) {
+                WARN_MESS << "Render worker " << iworker << " not reachable, plot lost" << ENDL;
+            }
+        }
+    });
+
+    INFO_MESS << queue.Workers.size() << " render workers started" << ENDL;
+
+    return true;
+}
+
+void QueueRender(RenderQueue &queue, const AnalysisResult &result)
+{
+    // the result is serialized in the calling thread, the dispatcher only sends it
+    string message;
+    SerializeResult(result,message);
+    {
+        lock_guard<mutex> lock(queue.Mutex);
+        queue.Queue.push_back(move(message));
+    }
+    queue.Condition.notify_one();
+}
+
+void StopRenderQueue(RenderQueue &queue)
+{
+    // the dispatcher stops when all the queued results have been sent
+    {
+        lock_guard<mutex> lock(queue.Mutex);
+        queue.Stop = true;
+    }
+    queue.Condition.notify_one();
+    if(queue.Dispatcher.joinable()) queue.Dispatcher.join();
+
+    // the end of their input stops the workers, once their last plot is done
+    for(auto fd : queue.Pipes) close(fd);
+    for(auto pid : queue.Workers) waitpid(pid,nullptr,0);
+    if(queue.ReadyPipe>=0) close(queue.ReadyPipe);
+
+    queue.Pipes.clear();
+    queue.Workers.clear();
+    queue.ReadyPipe = -1;
+}
+
+Int_t Analyse(vector<TString> Countries, Int_t NThreads, Int_t NRenderWorkers)
+{
+    // the render workers are started before the fitting threads, a process should not be forked while threads are running
+    RenderQueue queue;
+    Bool_t DoRender = (fHeadless == false) && StartRenderQueue(queue,NRenderWorkers);
+
+    // each result is queued for plotting as soon as its fits are done, and kept for the timing report
+    Double_t StartTime = GetRealTime();
+    atomic<Int_t> NAnalysed(0);
+    vector<AnalysisResult> Results(Countries.size());
+    RunParallel(Countries.size(),NThreads,[&](Int_t icountry) {
+        AnalysisResult result;
+        if(AnalyseData(Countries.at(icountry),result) == false) {
+            WARN_MESS << "No data for " << Countries.at(icountry) << ", skipped" << ENDL;
+            return;
+        }
+        NAnalysed++;
+        if(DoRender) {
+            QueueRender(queue,result);
+            if(!result.Cases.Dates.empty()) QueueRender(queue,GetCasesResult(result));
+        }
+        Results.at(icountry) = move(result);
+    });
+
+    if(DoRender) StopRenderQueue(queue);
+
+    vector<AnalysisResult> Analysed;
+    for(auto &result : Results) if(!result.Data.Dates.empty()) Analysed.push_back(move(result));
+
+    // the state of the whole batch is saved in one file, in the input order
+    if(fStateFile!="") SaveState(Analysed,fStateFile);
+
+    if(!fHeadless) {
+        if(fDoWeekly) for(auto &result : Analysed) PrintWeekdayFactors(result.Data);
+        for(auto &result : Analysed) PrintAnomalies(result);
+        if(fDoRt) for(auto &result : Analysed) PrintRt(result);
+        if(fDoDeconvolution) for(auto &result : Analysed) PrintInfections(result);
+        if(fDoForecast) for(auto &result : Analysed) PrintForecast(result);
+        PrintTimingSummary(Analysed,GetRealTime()-StartTime);
+    }
+    if(fTimingFile!="") WriteTimings(Analysed,fTimingFile);
+
+    INFO_MESS << NAnalysed << " countries analysed over " << Countries.size() << ENDL;
+
+    return NAnalysed;
+}
+
+void SetRegionTolerance(Double_t Tolerance)
+{
+    fRegionTolerance = Tolerance;
+
+    INFO_MESS << "Regional tolerance set to " << fRegionTolerance*100 << "%" << ENDL;
+}
+
+Int_t AnalyseRegions(TString WideFile, Int_t NThreads)
+{
+    Double_t StartTime = GetRealTime();
+
+    RegionalResult result;
+    if(AnalyseRegionsData(WideFile,result,NThreads) == false) return -1;
+
+    vector<AnalysisResult> Results = result.Regions;
+    Results.push_back(result.National);
+    if(fStateFile!="") SaveState(Results,fStateFile);
+
+    // the consistency checks are always printed, the inconsistencies being warnings
+    PrintRegions(result);
+    if(!fHeadless) {
+        DrawRegions(result);
+        PrintTimingSummary(Results,GetRealTime()-StartTime);
+    }
+    if(fTimingFile!="") WriteTimings(Results,fTimingFile);
+
+    Int_t NInconsistent = 0;
+    for(auto &check : result.Checks) if(!check.Consistent) NInconsistent++;
+    return NInconsistent;
+}
+
+Bool_t AnalyseRegionsData(TString WideFile, RegionalResult &result, Int_t NThreads)
+{
+    result = RegionalResult();
+    result.FileName = WideFile;
+
+    // all the columns are read at once
+    StageClock clock = StartStage();
+    WideData wide;
+    Long64_t BytesRead = 0;
+    if(!ReadWideData(GetDataFileName(WideFile),wide,&BytesRead)) return false;
+    Timing ReadTiming;
+    StopStage(ReadTiming,kStageRead,clock);
+
+    Int_t NationalColumn = -1;
+    for(size_t icol=0 ; icol<wide.Columns.size() ; icol++) {
+        if(wide.Columns.at(icol).EqualTo("total",TString::kIgnoreCase)) NationalColumn = icol;
+    }
+    if(NationalColumn == -1) {
+        ERR_MESS << "No total column in " << WideFile << ENDL;
+        return false;
+    }
+    result.NationalColumn = wide.Columns.at(NationalColumn);
+
+    // each column is read, differentiated and smoothed as a country
+    auto MakeResult = [&](Int_t icol, AnalysisResult &region) {
+        region = AnalysisResult();
+        region.Country = WideFile + ":" + wide.Columns.at(icol);
+        Series &series = region.Data;
+        series.Country = region.Country;
+        series.BytesRead = BytesRead;
+        GetWideColumn(wide,wide.Columns.at(icol),series.Dates,series.Total_Deaths);
+        TrimDataRange(series.Dates,series.Total_Deaths,fReadDataFrom,fReadDataTo);
+        if(!BuildSeries(series)) return false;
+        region.Timings = ReadTiming;
+
+        StageClock clock = StartStage();
+        SmoothSeries(series,fNSmoothing);
+        StopStage(region.Timings,kStageSmooth,clock);
+        return true;
+    };
+
+    if(!MakeResult(NationalColumn,result.National)) {
+        ERR_MESS << "No data in the " << result.NationalColumn << " column of " << WideFile << ENDL;
+        return false;
+    }
+    for(size_t icol=0 ; icol<wide.Columns.size() ; icol++) {
+        if((Int_t)icol == NationalColumn) continue;
+        AnalysisResult region;
+        if(MakeResult(icol,region)) result.Regions.push_back(move(region));
+        else if(!fHeadless) INFO_MESS << "No data for " << wide.Columns.at(icol) << ", not fitted" << ENDL;
+    }
+
+    // the fit range of the national total is used for all the regions, to compare the fits on the same dates
+    GetFitRange(result.National.Data,fFitRangeFrom,fFitRangeTo,result.XMin,result.XMax);
+
+    // one task per region (and national total) and per model, the fits being independent
+    vector<AnalysisResult*> All;
+    for(auto &region : result.Regions) All.push_back(&region);
+    All.push_back(&result.National);
+    vector<Int_t> Models = GetModels();
+    for(auto region : All) {
+        region->XMin = result.XMin;
+        region->XMax = result.XMax;
+        region->Fits.resize(Models.size());
+    }
+
+    RunParallel(All.size()*Models.size(),NThreads,[&](Int_t itask) {
+        AnalysisResult *region = All.at(itask/Models.size());
+        Int_t imodel = itask%Models.size();
+        FitModel(Models.at(imodel),region->Data,result.XMin,result.XMax,region->Fits.at(imodel),nullptr,true);
+    });
+    for(auto region : All) {
+        for(auto &fit : region->Fits) region->Timings.RealTime[kStageFit] += fit.RealTime;
+    }
+
+    // consistency of the data: sum of the regional totals compared with the national total, day by day
+    for(size_t iday=0 ; iday<wide.Bins.size() ; iday++) {
+        Double_t Sum = 0.;
+        for(size_t icol=0 ; icol<wide.Columns.size() ; icol++) if((Int_t)icol != NationalColumn) Sum += wide.Values.at(icol).at(iday);
+        Double_t Mismatch = fabs(Sum-wide.Values.at(NationalColumn).at(iday));
+        if(Mismatch > 0.5) result.NDataMismatches++;
+        result.MaxDataMismatch = max(result.MaxDataMismatch,Mismatch);
+    }
+
+    CheckRegions(result);
+
+    return true;
+}
+
+void CheckRegions(RegionalResult &result)
+{
+    result.Checks.clear();
+
+    // national smoothed data per histogram bin
+    Int_t NBins = GetDateBin("31-Dec-21");
+    const Series &national = result.National.Data;
+    vector<Double_t> NationalData(NBins+1,0.);
+    for(size_t i=0 ; i<national.Daily_Deaths.size() ; i++) {
+        if(national.Bins.at(i)>0) NationalData.at(national.Bins.at(i)) = national.Daily_Deaths.at(i);
+    }
+
+    for(size_t imodel=0 ; imodel<result.National.Fits.size() ; imodel++) {
+        const ModelFit &nationalfit = result.National.Fits.at(imodel);
+        RegionCheck check;
+        check.Model = nationalfit.Model;
+
+        // sum of the regional fits on each day of the fit range
+        vector<Double_t> Sum(NBins+1,0.);
+        for(auto &region : result.Regions) {
+            const ModelFit &fit = region.Fits.at(imodel);
+            check.NRegions++;
+            if(fit.Valid) check.NValid++;
+            if(fit.Band.size() != (size_t)NBins) continue;
+            for(int ibin=result.XMin ; ibin<=result.XMax ; ibin++) Sum.at(ibin) += fit.Band.at(ibin-1);
+        }
+
+        Double_t NationalMax = 0.;
+        for(int ibin=result.XMin ; ibin<=result.XMax && nationalfit.Band.size()==(size_t)NBins ; ibin++) {
+            Double_t National = nationalfit.Band.at(ibin-1);
+            check.SumRegions += Sum.at(ibin);
+            check.National += National;
+            check.NationalData += NationalData.at(ibin);
+            check.MaxDeviation = max(check.MaxDeviation,fabs(Sum.at(ibin)-National));
+            NationalMax = max(NationalMax,National);
+        }
+        if(check.National>0) check.FitDeviation = (check.SumRegions-check.National)/check.National;
+        if(check.NationalData>0) check.DataDeviation = (check.SumRegions-check.NationalData)/check.NationalData;
+        if(NationalMax>0) check.MaxDeviation /= NationalMax;
+
+        check.Consistent = nationalfit.Valid && check.NValid == check.NRegions && check.National>0 &&
+                           fabs(check.FitDeviation) <= fRegionTolerance && fabs(check.DataDeviation) <= fRegionTolerance;
+        result.Checks.push_back(check);
+    }
+}
+
+void PrintRegions(const RegionalResult &result)
+{
+    TITLE_MESS << "Regional analysis of " << result.FileName << ": " << result.Regions.size() << " regions, fit range "
+               << GetBinDate(result.XMin) << " to " << GetBinDate(result.XMax) << ENDL;
+
+    for(auto &region : result.Regions) {
+        TString Line = Form("  %-12s",TString(region.Country(region.Country.Last(':')+1,region.Country.Length())).Data());
+        for(auto &fit : region.Fits) {
+            Line += Form("  %-5s chi2/ndf = %7.2f%s",fModelNames[fit.Model],(fit.Ndf>0) ? fit.Chi2/fit.Ndf : 0.,(fit.Valid) ? "" : " (invalid)");
+        }
+        INFO_MESS << Line << ENDL;
+    }
+
+    if(result.NDataMismatches) {
+        WARN_MESS << "The sum of the regional totals differs from the " << result.NationalColumn << " column on " << result.NDataMismatches
+                  << " days (maximal difference: " << result.MaxDataMismatch << " deaths)" << ENDL;
+    }
+    else INFO_MESS << "The sum of the regional totals is equal to the " << result.NationalColumn << " column on all the days" << ENDL;
+
+    for(auto &check : result.Checks) {
+        TString Line = Form("%s: sum of the regions %.0f deaths, national fit %.0f (%+.1f%%), national data %.0f (%+.1f%%), maximal daily difference %.1f%%",
+                            fModelNames[check.Model],check.SumRegions,check.National,100*check.FitDeviation,check.NationalData,100*check.DataDeviation,100*check.MaxDeviation);
+        if(check.Consistent) INFO_MESS << Line << ENDL;
+        else {
+            WARN_MESS << Line << ENDL;
+            WARN_MESS << fModelNames[check.Model] << ": inconsistent regional fits (" << check.NValid << "/" << check.NRegions
+                      << " valid regional fits, tolerance " << 100*fRegionTolerance << "%)" << ENDL;
+        }
+    }
+}
+
+void DrawRegions(const RegionalResult &result)
+{
+    const Series &national = result.National.Data;
+    if(national.Dates.empty() || result.Checks.empty()) return;
+
+    gStyle->SetOptTitle(0);
+    gStyle->SetOptStat(0);
+
+    TCanvas *MyCanvas = (TCanvas*)gROOT->GetListOfCanvases()->FindObject("regions");
+    if(MyCanvas == nullptr) MyCanvas = new TCanvas("regions","regions",1600,600*result.Checks.size());
+    MyCanvas->Clear();
+    MyCanvas->Divide(1,result.Checks.size());
+
+    Int_t DateMin,DateMax;
+    GetAxisRange(national,DateMin,DateMax);
+    Int_t NBins = GetDateBin("31-Dec-21");
+    Int_t RegionColors[] = {kBlue,kRed,kGreen+2,kMagenta,kOrange+1,kCyan+1,kViolet,kPink+1,kTeal,kGray+1,kSpring,kAzure+7};
+    Int_t NColors = sizeof(RegionColors)/sizeof(Int_t);
+
+    // to build a graph of a curve given on all the histogram bins, in the axis range
+    auto MakeGraph = [&](const vector<Double_t> &curve) {
+        TGraph *graph = PadOwned(new TGraph);
+        for(int ibin=DateMin ; ibin<=DateMax && ibin<=(Int_t)curve.size() ; ibin++) graph->SetPoint(graph->GetN(),BinToX(ibin),curve.at(ibin-1));
+        return graph;
+    };
+
+    for(size_t icheck=0 ; icheck<result.Checks.size() ; icheck++) {
+        MyCanvas->cd(icheck+1);
+
+        // the national data are drawn in a date histogram, used as frame
+        TH1D *frame = PadOwned(BuildDateHistogram(Form("hRegions_%s",TString(fModelNames[result.Checks.at(icheck).Model]).ReplaceAll("'","").Data())));
+        frame->GetYaxis()->SetTitle("DEATHS / DAY");
+        for(size_t i=0 ; i<national.Daily_Deaths.size() ; i++) {
+            if(national.Bins.at(i)>0) frame->SetBinContent(national.Bins.at(i),national.Daily_Deaths.at(i));
+        }
+        frame->GetXaxis()->SetRange(DateMin,DateMax);
+        frame->GetYaxis()->SetRangeUser(0,frame->GetMaximum()*1.2);
+        Int_t Step = max(1,(DateMax-DateMin)/40);
+        for(int ibin=1 ; ibin<=frame->GetNbinsX() ; ibin++) if((ibin-1)%Step) frame->GetXaxis()->SetBinLabel(ibin,"");
+        frame->Draw("p");
+
+        TLegend *legend = PadOwned(new TLegend(0.80,0.35,0.995,0.99));
+        legend->SetTextFont(132);
+        legend->AddEntry(frame,Form("%s data",result.NationalColumn.Data()),"p");
+
+        vector<Double_t> Sum(NBins,0.);
+        for(size_t iregion=0 ; iregion<result.Regions.size() ; iregion++) {
+            const AnalysisResult &region = result.Regions.at(iregion);
+            const ModelFit &fit = region.Fits.at(icheck);
+            if(fit.Band.size() != (size_t)NBins) continue;
+            for(int ibin=0 ; ibin<NBins ; ibin++) Sum.at(ibin) += fit.Band.at(ibin);
+            TGraph *graph = MakeGraph(fit.Band);
+            graph->SetLineColor(RegionColors[iregion%NColors]);
+            graph->SetLineWidth(2);
+            graph->Draw("l");
+            legend->AddEntry(graph,TString(region.Country(region.Country.Last(':')+1,region.Country.Length())),"l");
+        }
+
+        const ModelFit &nationalfit = result.National.Fits.at(icheck);
+        if(nationalfit.Band.size() == (size_t)NBins) {
+            TGraph *graph = MakeGraph(nationalfit.Band);
+            graph->SetLineColor(kBlack);
+            graph->SetLineWidth(3);
+            graph->Draw("l");
+            legend->AddEntry(graph,Form("%s fit",result.NationalColumn.Data()),"l");
+        }
+        TGraph *graph = MakeGraph(Sum);
+        graph->SetLineColor(kBlack);
+        graph->SetLineStyle(kDashed);
+        graph->SetLineWidth(3);
+        graph->Draw("l");
+        legend->AddEntry(graph,"sum of the regions","l");
+        legend->Draw();
+
+        const RegionCheck &check = result.Checks.at(icheck);
+        gPad->Modified();
+        gPad->Update();
+        TLatex *text = PadOwned(new TLatex(gPad->GetFrame()->GetX1()*1.02,gPad->GetFrame()->GetY2()*0.9,
+                                           Form("%s model: sum/national fit %+.1f%%, sum/national data %+.1f%%",fModelNames[check.Model],100*check.FitDeviation,100*check.DataDeviation)));
+        text->SetTextFont(132);
+        text->SetTextSize(0.05);
+        text->SetTextColor((check.Consistent) ? kBlack : kRed);
+        text->Draw();
+    }
+
+    MyCanvas->cd();
+    MyCanvas->Modified();
+    MyCanvas->Update();
+
+    gSystem->mkdir("Pictures");
+    TString OutputFileName = Form("Pictures/covid19_regions_%s",gSystem->BaseName(result.FileName));
+    if(national.NSmoothing>1) OutputFileName.Append(Form("_%dDaysSmooth",national.NSmoothing));
+    OutputFileName.Append(Form("_%s.png",national.Dates.back().Data()));
+    MyCanvas->SaveAs(OutputFileName);
+}
+
+vector<TString> GetTimeScales(Int_t Model)
+{
+    if(Model == kModelD || Model == kModelESIR) return {"b"};
+    if(Model == kModelD2) return {"b1","b2"};
+    if(Model == kModelESIR2) return {"b","b'"};
+    if(IsCompartmental(Model)) return {"R0"};
+    return {};
+}
+
+Double_t JointChi2::SeriesChi2(size_t iseries, const double *x) const
+{
+    const vector<Int_t> &index = Index.at(iseries);
+    Double_t Pars[16];
+    for(size_t ipar=0 ; ipar<index.size() ; ipar++) Pars[ipar] = x[index.at(ipar)];
+
+    const vector<Double_t> &xs = X.at(iseries), &ys = Y.at(iseries), &es = E.at(iseries);
+    TF1 *func = Funcs.at(iseries).get();
+    Double_t Chi2 = 0.;
+    for(size_t i=0 ; i<xs.size() ; i++) {
+        Double_t Residual = (ys.at(i)-func->EvalPar(&xs.at(i),Pars))/es.at(i);
+        Chi2 += Residual*Residual;
+    }
+    return Chi2;
+}
+
+Double_t JointChi2::Penalty(const double *x) const
+{
+    // gaussian prior of relative width Pooling of each pooled parameter around its common value
+    Double_t Chi2 = 0.;
+    for(auto &pooled : Pooled) {
+        Double_t Common = x[pooled.second];
+        if(Common == 0.) continue;
+        Double_t Pull = (x[pooled.first]-Common)/(Pooling*Common);
+        Chi2 += Pull*Pull;
+    }
+    return Chi2;
+}
+
+double JointChi2::DoEval(const double *x) const
+{
+    Double_t Chi2 = Penalty(x);
+    for(size_t iseries=0 ; iseries<Funcs.size() ; iseries++) Chi2 += SeriesChi2(iseries,x);
+    return Chi2;
+}
+
+double JointChi2::DoDerivative(const double *x, unsigned int icoord) const
+{
+    if(Fixed.at(icoord)) return 0.;
+
+    // central difference, only on the series depending on this parameter
+    vector<Double_t> Shifted(x,x+NPars);
+    Double_t Step = (x[icoord] != 0.) ? 1e-4*fabs(x[icoord]) : 1e-8;
+    Double_t Up = 0., Down = 0.;
+    Shifted.at(icoord) = x[icoord]+Step;
+    for(auto iseries : Affected.at(icoord)) Up += SeriesChi2(iseries,Shifted.data());
+    if(!Pooled.empty()) Up += Penalty(Shifted.data());
+    Shifted.at(icoord) = x[icoord]-Step;
+    for(auto iseries : Affected.at(icoord)) Down += SeriesChi2(iseries,Shifted.data());
+    if(!Pooled.empty()) Down += Penalty(Shifted.data());
+
+    return (Up-Down)/(2*Step);
+}
+
+Bool_t FitJoint(JointResult &joint, Int_t Model, Bool_t FullModel, TString Shared, Double_t Pooling, Bool_t ComputeBand)
+{
+    StageClock clock = StartStage();
+
+    joint.Model = Model;
+    joint.FullModel = FullModel;
+    joint.Pooling = Pooling;
+    joint.SharedNames.clear();
+    joint.SharedPars.clear();
+    joint.SharedErrors.clear();
+    joint.Valid = false;
+    size_t NSeries = joint.Results.size();
+    if(NSeries == 0) return false;
+
+    if(Shared == "") joint.SharedNames = GetTimeScales(Model);
+    else {
+        TObjArray *arr = Shared.Tokenize(",");
+        for(int i=0 ; i<arr->GetEntries() ; i++) joint.SharedNames.push_back(arr->At(i)->GetName());
+        delete arr;
+    }
+
+    // one function per series, with its own initial parameters, and its fitted points
+    JointChi2 chi2;
+    chi2.Pooling = Pooling;
+    Int_t NPoints = 0;
+    for(auto &result : joint.Results) {
+        const Series &series = result.Data;
+        shared_ptr<TF1> func(InitModel(Model,FullModel,Form("Joint_%s_%s_%d_%d",fModelNames[Model],series.Country.Data(),joint.XMin,joint.XMax),joint.XMin,series));
+        if(func == nullptr) return false;
+        chi2.Funcs.push_back(func);
+
+        ROOT::Fit::BinData data;
+        FillFitData(series,joint.XMin,joint.XMax,data);
+        vector<Double_t> xs, ys, es;
+        for(unsigned int i=0 ; i<data.NPoints() ; i++) {
+            xs.push_back(data.Coords(i)[0]);
+            ys.push_back(data.Value(i));
+            es.push_back(data.Error(i));
+        }
+        NPoints += xs.size();
+        chi2.X.push_back(xs);
+        chi2.Y.push_back(ys);
+        chi2.E.push_back(es);
+    }
+
+    // layout of the joint parameters: the common values of the shared parameters first, then the parameters of each series
+    TF1 *first = chi2.Funcs.front().get();
+    Int_t NModelPars = first->GetNpar();
+    vector<Int_t> SharedIndex(NModelPars,-1);
+    vector<Double_t> Init, Min, Max;
+    vector<TString> Names;
+    for(auto &name : joint.SharedNames) {
+        Int_t ipar = first->GetParNumber(name);
+        if(ipar < 0 || ipar == NModelPars-1) {
+            ERR_MESS << "No parameter " << name << " to be shared in the " << fModelNames[Model] << " model" << ENDL;
+            return false;
+        }
+        SharedIndex.at(ipar) = Init.size();
+        // the common value starts at the mean of the initial values of the series
+        Double_t Mean = 0.;
+        for(auto &func : chi2.Funcs) Mean += func->GetParameter(ipar)/NSeries;
+        Double_t Low,High;
+        first->GetParLimits(ipar,Low,High);
+        Init.push_back(Mean);
+        Min.push_back(Low);
+        Max.push_back(High);
+        Names.push_back(name);
+        chi2.Affected.push_back({});
+    }
+    for(size_t iseries=0 ; iseries<NSeries ; iseries++) {
+        TF1 *func = chi2.Funcs.at(iseries).get();
+        vector<Int_t> index(NModelPars);
+        for(int ipar=0 ; ipar<NModelPars ; ipar++) {
+            Int_t ishared = SharedIndex.at(ipar);
+            if(ishared >= 0 && Pooling <= 0.) {
+                index.at(ipar) = ishared;
+                chi2.Affected.at(ishared).push_back(iseries);
+                continue;
+            }
+            index.at(ipar) = Init.size();
+            if(ishared >= 0) chi2.Pooled.push_back({(Int_t)Init.size(),ishared});
+            Double_t Low,High;
+            func->GetParLimits(ipar,Low,High);
+            Init.push_back(func->GetParameter(ipar));
+            Min.push_back(Low);
+            Max.push_back(High);
+            Names.push_back(Form("%s_%d",func->GetParName(ipar),(Int_t)iseries));
+            chi2.Affected.push_back({(Int_t)iseries});
+        }
+        chi2.Index.push_back(index);
+    }
+    chi2.NPars = Init.size();
+
+    ROOT::Fit::Fitter fitter;
+    ConfigureMinimizer(fitter);
+    fitter.Config().SetParamsSettings(chi2.NPars,Init.data());
+    for(size_t ipar=0 ; ipar<chi2.NPars ; ipar++) {
+        fitter.Config().ParSettings(ipar).SetName(Names.at(ipar).Data());
+        // same convention as TF1: equal limits mean a fixed parameter
+        Bool_t Fixed = (Min.at(ipar)*Max.at(ipar) != 0 && Min.at(ipar) >= Max.at(ipar));
+        if(Fixed) fitter.Config().ParSettings(ipar).Fix();
+        else if(Min.at(ipar) < Max.at(ipar)) fitter.Config().ParSettings(ipar).SetLimits(Min.at(ipar),Max.at(ipar));
+        chi2.Fixed.push_back(Fixed);
+    }
+
+    fitter.FitFCN(chi2,Init.data(),NPoints,true);
+
+    const ROOT::Fit::FitResult &result = fitter.Result();
+    if(result.IsEmpty()) return false;
+
+    const vector<Double_t> &Pars = result.Parameters();
+    joint.NPars = result.NFreeParameters();
+    joint.Chi2 = result.MinFcnValue();
+    joint.Ndf = NPoints-joint.NPars;
+    joint.Status = result.Status();
+    joint.Valid = result.IsValid();
+    joint.NCalls = result.NCalls();
+    for(size_t ishared=0 ; ishared<joint.SharedNames.size() ; ishared++) {
+        joint.SharedPars.push_back(Pars.at(ishared));
+        joint.SharedErrors.push_back(result.ParError(ishared));
+    }
+
+    Timing FitTiming;
+    StopStage(FitTiming,kStageFit,clock);
+    joint.RealTime = FitTiming.RealTime[kStageFit];
+
+    // each series gets its own fit, with the block of the joint covariance matrix of its parameters
+    Int_t NBins = GetDateBin("31-Dec-21");
+    Double_t Quantile = (joint.Ndf>0) ? TMath::StudentQuantile(0.975,joint.Ndf)*sqrt(joint.Chi2/joint.Ndf) : 0.;
+    for(size_t iseries=0 ; iseries<NSeries ; iseries++) {
+        AnalysisResult &analysis = joint.Results.at(iseries);
+        TF1 *func = chi2.Funcs.at(iseries).get();
+        const vector<Int_t> &index = chi2.Index.at(iseries);
+
+        analysis.XMin = joint.XMin;
+        analysis.XMax = joint.XMax;
+        analysis.Fits.assign(1,ModelFit());
+        ModelFit &fit = analysis.Fits.front();
+        fit.Model = Model;
+        fit.FullModel = FullModel;
+        fit.XMin = joint.XMin;
+        fit.XMax = joint.XMax;
+        fit.Covariance.assign(NModelPars*NModelPars,0.);
+        Int_t NFree = 0;
+        for(int ipar=0 ; ipar<NModelPars ; ipar++) {
+            fit.ParNames.push_back(func->GetParName(ipar));
+            fit.Pars.push_back(Pars.at(index.at(ipar)));
+            fit.Errors.push_back(result.ParError(index.at(ipar)));
+            for(int jpar=0 ; jpar<NModelPars ; jpar++) fit.Covariance.at(ipar*NModelPars+jpar) = result.CovMatrix(index.at(ipar),index.at(jpar));
+            if(!chi2.Fixed.at(index.at(ipar))) NFree++;
+        }
+        fit.Chi2 = chi2.SeriesChi2(iseries,Pars.data());
+        fit.Ndf = chi2.X.at(iseries).size()-NFree;
+        fit.Status = joint.Status;
+        fit.Valid = joint.Valid;
+        fit.NCalls = joint.NCalls;
+        if(fitter.GetMinimizer()) fit.NIterations = fitter.GetMinimizer()->NIterations();
+        fit.CovStatus = result.CovMatrixStatus();
+        fit.RealTime = joint.RealTime/NSeries;
+        analysis.Timings.RealTime[kStageFit] += fit.RealTime;
+        analysis.Timings.CpuTime[kStageFit] += FitTiming.CpuTime[kStageFit]/NSeries;
+
+        // the 95% confidence interval is propagated from the covariance block, with the normalisation of FitModel
+        if(!ComputeBand) continue;
+        clock = StartStage();
+        fit.Band.resize(NBins);
+        fit.Band_error.resize(NBins);
+        vector<Double_t> Shifted = fit.Pars, Gradient(NModelPars);
+        for(int ibin=1 ; ibin<=NBins ; ibin++) {
+            Double_t x = BinToX(ibin);
+            fit.Band.at(ibin-1) = func->EvalPar(&x,fit.Pars.data());
+            for(int ipar=0 ; ipar<NModelPars ; ipar++) {
+                Gradient.at(ipar) = 0.;
+                if(chi2.Fixed.at(index.at(ipar))) continue;
+                Double_t Step = (fit.Pars.at(ipar) != 0.) ? 1e-4*fabs(fit.Pars.at(ipar)) : 1e-8;
+                Shifted.at(ipar) = fit.Pars.at(ipar)+Step;
+                Double_t Up = func->EvalPar(&x,Shifted.data());
+                Shifted.at(ipar) = fit.Pars.at(ipar)-Step;
+                Double_t Down = func->EvalPar(&x,Shifted.data());
+                Shifted.at(ipar) = fit.Pars.at(ipar);
+                Gradient.at(ipar) = (Up-Down)/(2*Step);
+            }
+            Double_t Variance = 0.;
+            for(int ipar=0 ; ipar<NModelPars ; ipar++) {
+                for(int jpar=0 ; jpar<NModelPars ; jpar++) Variance += Gradient.at(ipar)*fit.Covariance.at(ipar*NModelPars+jpar)*Gradient.at(jpar);
+            }
+            fit.Band_error.at(ibin-1) = Quantile*sqrt(max(0.,Variance));
+        }
+        StopStage(analysis.Timings,kStageBand,clock);
+    }
+
+    return joint.Valid;
+}
+
+Bool_t AnalyseJointData(vector<TString> Countries, Int_t Model, TString Shared, Double_t Pooling, JointResult &joint)
+{
+    joint = JointResult();
+
+    vector<TString> Names;
+    for(auto &pattern : Countries) ExpandCountry(pattern,Names);
+
+    // each series is read and smoothed as in the analysis of a country
+    for(auto &name : Names) {
+        AnalysisResult result;
+        result.Country = name;
+        StageClock clock = StartStage();
+        if(!LoadSeries(name,result.Data)) {
+            if(!fHeadless) WARN_MESS << "No data for " << name << ", not fitted" << ENDL;
+            continue;
+        }
+        StopStage(result.Timings,kStageRead,clock);
+        clock = StartStage();
+        SmoothSeries(result.Data,fNSmoothing);
+        StopStage(result.Timings,kStageSmooth,clock);
+        joint.Results.push_back(move(result));
+    }
+    if(joint.Results.size() < 2) {
+        ERR_MESS << "A joint fit needs at least two series, " << joint.Results.size() << " available" << ENDL;
+        return false;
+    }
+
+    // the fit range of the first series is used for all of them, the shared time scales needing a common t0
+    GetFitRange(joint.Results.front().Data,fFitRangeFrom,fFitRangeTo,joint.XMin,joint.XMax);
+
+    FitJoint(joint,Model,fDoFullModel,Shared,Pooling);
+
+    return joint.Status >= 0;
+}
+
+Bool_t AnalyseJoint(vector<TString> Countries, Int_t Model, TString Shared, Double_t Pooling)
+{
+    Double_t StartTime = GetRealTime();
+
+    JointResult joint;
+    if(AnalyseJointData(Countries,Model,Shared,Pooling,joint) == false) return false;
+
+    if(fStateFile!="") SaveState(joint.Results,fStateFile);
+
+    PrintJoint(joint);
+    if(!fHeadless) {
+        DrawJoint(joint);
+        PrintTimingSummary(joint.Results,GetRealTime()-StartTime);
+    }
+    if(fTimingFile!="") WriteTimings(joint.Results,fTimingFile);
+
+    return joint.Valid;
+}
+
+void PrintJoint(const JointResult &joint)
+{
+    TITLE_MESS << "Joint " << fModelNames[joint.Model] << ((joint.FullModel && (joint.Model==kModelD2 || joint.Model==kModelESIR2)) ? " full model" : " model")
+               << " fit of " << joint.Results.size() << " series, fit range " << GetBinDate(joint.XMin) << " to " << GetBinDate(joint.XMax) << ENDL;
+
+    TString Line = Form("status %d%s, Chi2/ndf = %.2f, %d free parameters, %d calls in %.2f s",joint.Status,(joint.Valid) ? " (valid)" : " (NOT valid)",
+                        (joint.Ndf>0) ? joint.Chi2/joint.Ndf : 0.,joint.NPars,joint.NCalls,joint.RealTime);
+    if(joint.Valid) INFO_MESS << Line << ENDL;
+    else WARN_MESS << Line << ENDL;
+
+    for(size_t ishared=0 ; ishared<joint.SharedNames.size() ; ishared++) {
+        INFO_MESS << Form("%10s = %12.4g +/- %.4g",joint.SharedNames.at(ishared).Data(),joint.SharedPars.at(ishared),joint.SharedErrors.at(ishared))
+                  << ((joint.Pooling>0) ? Form(" (common value, %.0f%% pooling)",100*joint.Pooling) : " (shared)") << ENDL;
+    }
+
+    for(auto &result : joint.Results) {
+        if(result.Fits.empty()) continue;
+        const ModelFit &fit = result.Fits.front();
+        TString Pars = "";
+        for(size_t ipar=0 ; ipar<fit.Pars.size()-1 ; ipar++) Pars += Form("  %s = %.4g",fit.ParNames.at(ipar).Data(),fit.Pars.at(ipar));
+        INFO_MESS << Form("  %-30s chi2/ndf = %7.2f",result.Country.Data(),(fit.Ndf>0) ? fit.Chi2/fit.Ndf : 0.) << Pars << ENDL;
+    }
+}
+
+void DrawJoint(const JointResult &joint)
+{
+    if(joint.Results.empty()) return;
+
+    gStyle->SetOptTitle(0);
+    gStyle->SetOptStat(0);
+
+    // one pad per series, on a grid
+    Int_t NSeries = joint.Results.size();
+    Int_t NColumns = TMath::Ceil(sqrt((Double_t)NSeries));
+    Int_t NRows = (NSeries+NColumns-1)/NColumns;
+    TCanvas *MyCanvas = (TCanvas*)gROOT->GetListOfCanvases()->FindObject("joint");
+    if(MyCanvas == nullptr) MyCanvas = new TCanvas("joint","joint",500*NColumns,400*NRows);
+    MyCanvas->Clear();
+    MyCanvas->Divide(NColumns,NRows);
+
+    Int_t NBins = GetDateBin("31-Dec-21");
+    for(Int_t iseries=0 ; iseries<NSeries ; iseries++) {
+        const AnalysisResult &result = joint.Results.at(iseries);
+        const Series &series = result.Data;
+        MyCanvas->cd(iseries+1);
+
+        Int_t DateMin,DateMax;
+        GetAxisRange(series,DateMin,DateMax);
+        TH1D *frame = PadOwned(BuildDateHistogram(Form("hJoint_%d",iseries)));
+        frame->GetYaxis()->SetTitle("DEATHS / DAY");
+        for(size_t i=0 ; i<series.Daily_Deaths.size() ; i++) {
+            if(series.Bins.at(i)>0) frame->SetBinContent(series.Bins.at(i),series.Daily_Deaths.at(i));
+        }
+        frame->GetXaxis()->SetRange(DateMin,DateMax);
+        frame->GetYaxis()->SetRangeUser(0,frame->GetMaximum()*1.2);
+        Int_t Step = max(1,(DateMax-DateMin)/10);
+        for(int ibin=1 ; ibin<=frame->GetNbinsX() ; ibin++) if((ibin-1)%Step) frame->GetXaxis()->SetBinLabel(ibin,"");
+        frame->Draw("p");
+
+        if(!result.Fits.empty() && result.Fits.front().Band.size() == (size_t)NBins) {
+            const ModelFit &fit = result.Fits.front();
+            TGraphErrors *band = PadOwned(new TGraphErrors);
+            TGraph *graph = PadOwned(new TGraph);
+            for(int ibin=joint.XMin ; ibin<=DateMax ; ibin++) {
+                band->SetPoint(band->GetN(),BinToX(ibin),fit.Band.at(ibin-1));
+                band->SetPointError(band->GetN()-1,0.,fit.Band_error.at(ibin-1));
+                graph->SetPoint(graph->GetN(),BinToX(ibin),fit.Band.at(ibin-1));
+            }
+            band->SetFillColorAlpha(fColors[joint.Model],0.3);
+            band->Draw("3");
+            graph->SetLineColor(fColors[joint.Model]);
+            graph->SetLineWidth(2);
+            graph->Draw("l");
+        }
+
+        TLatex *text = PadOwned(new TLatex(0.15,0.85,Form("%s (#chi^{2}/ndf = %.2f)",result.Country.Data(),
+                                                         (!result.Fits.empty() && result.Fits.front().Ndf>0) ? result.Fits.front().Chi2/result.Fits.front().Ndf : 0.)));
+        text->SetNDC();
+        text->SetTextFont(132);
+        text->SetTextSize(0.05);
+        text->Draw();
+    }
+
+    MyCanvas->cd();
+    MyCanvas->Modified();
+    MyCanvas->Update();
+
+    gSystem->mkdir("Pictures");
+    const Series &first = joint.Results.front().Data;
+    TString OutputFileName = Form("Pictures/covid19_joint_%s_%s_%dSeries",TString(fModelNames[joint.Model]).ReplaceAll("'","").Data(),
+                                  TString(gSystem->BaseName(first.Country)).ReplaceAll(":","_").Data(),NSeries);
+    if(first.NSmoothing>1) OutputFileName.Append(Form("_%dDaysSmooth",first.NSmoothing));
+    OutputFileName.Append(Form("_%s.png",first.Dates.back().Data()));
+    MyCanvas->SaveAs(OutputFileName);
+}
+
+StageClock StartStage()
+{
+    StageClock clock;
+    clock.Real = GetRealTime();
+    clock.Cpu = GetThreadCpuTime();
+    return clock;
+}
+
+void StopStage(Timing &timing, Int_t Stage, const StageClock &start)
+{
+    timing.RealTime[Stage] += GetRealTime() - start.Real;
+    timing.CpuTime[Stage] += GetThreadCpuTime() - start.Cpu;
+}
+
+void PrintTiming(const AnalysisResult &result)
+{
+    const Timing &timing = result.Timings;
+
+    INFO_MESS << "Timing of " << result.Country << " (" << result.Data.BytesRead << " bytes read):" << ENDL;
+    Double_t TotReal = 0., TotCpu = 0.;
+    for(int istage=0 ; istage<kNStages ; istage++) {
+        INFO_MESS << Form("  %-13s %10.3f ms real %10.3f ms cpu",fStageNames[istage],1e3*timing.RealTime[istage],1e3*timing.CpuTime[istage]) << ENDL;
+        TotReal += timing.RealTime[istage];
+        TotCpu += timing.CpuTime[istage];
+    }
+    INFO_MESS << Form("  %-13s %10.3f ms real %10.3f ms cpu","total",1e3*TotReal,1e3*TotCpu) << ENDL;
+
+    for(auto &fit : result.Fits) {
+        INFO_MESS << Form("  %-6s status %d (%s), covariance status %d, %d FCN calls, %d iterations, %.3f ms",fModelNames[fit.Model],
+                          fit.Status,fit.Valid ? "valid" : "NOT VALID",fit.CovStatus,fit.NCalls,fit.NIterations,1e3*fit.RealTime) << ENDL;
+    }
+}
+
+void PrintTimingSummary(const vector<AnalysisResult> &Results, Double_t RealTime)
+{
+    if(Results.empty()) return;
+
+    INFO_MESS << Form("Timing of %zu countries: %.3f s, %.2f countries/s",Results.size(),RealTime,Results.size()/RealTime) << ENDL;
+
+    // total, mean and maximum of each stage over the countries (the plots done by the render workers are not included)
+    for(int istage=0 ; istage<kNStages ; istage++) {
+        Double_t TotReal = 0., TotCpu = 0., MaxReal = -1.;
+        TString MaxCountry = "";
+        for(auto &result : Results) {
+            TotReal += result.Timings.RealTime[istage];
+            TotCpu += result.Timings.CpuTime[istage];
+            if(result.Timings.RealTime[istage] > MaxReal) {
+                MaxReal = result.Timings.RealTime[istage];
+                MaxCountry = result.Country;
+            }
+        }
+        if(TotReal == 0.) continue;
+        INFO_MESS << Form("  %-13s total %10.3f ms real %10.3f ms cpu, mean %8.3f ms, max %8.3f ms (%s)",fStageNames[istage],1e3*TotReal,1e3*TotCpu,
+                          1e3*TotReal/Results.size(),1e3*MaxReal,MaxCountry.Data()) << ENDL;
+    }
+
+    // fitter counters, and the fits that did not converge
+    Long64_t BytesRead = 0, NCalls = 0, NIterations = 0;
+    Int_t NFits = 0;
+    Double_t MaxTime = -1.;
+    TString Slowest = "";
+    vector<TString> Invalid;
+    for(auto &result : Results) {
+        BytesRead += result.Data.BytesRead;
+        Double_t Time = 0.;
+        for(int istage=0 ; istage<kNStages ; istage++) Time += result.Timings.RealTime[istage];
+        if(Time > MaxTime) {
+            MaxTime = Time;
+            Slowest = result.Country;
+        }
+        for(auto &fit : result.Fits) {
+            NFits++;
+            NCalls += fit.NCalls;
+            NIterations += fit.NIterations;
+            if(!fit.Valid) Invalid.push_back(Form("%s %s (status %d)",result.Country.Data(),fModelNames[fit.Model],fit.Status));
+        }
+    }
+    INFO_MESS << Form("  %lld bytes read, %d fits, %lld FCN calls, %lld iterations, slowest country: %s (%.3f ms)",BytesRead,NFits,NCalls,NIterations,
+                      Slowest.Data(),1e3*MaxTime) << ENDL;
+    for(auto &fit : Invalid) WARN_MESS << "  fit not valid: " << fit << ENDL;
+}
+
+void WriteTimings(const vector<AnalysisResult> &Results, TString FileName)
+{
+    if(Results.empty()) return;
+
+    gSystem->mkdir(gSystem->DirName(FileName),true);
+    ofstream file(FileName.Data(),ios::app);
+    if(!file) {
+        ERR_MESS << "Cannot write the timing file " << FileName << ENDL;
+        return;
+    }
+
+    // one line per country, with the time of each stage and the counters of each fit
+    Timing Total;
+    Long64_t BytesRead = 0, NCalls = 0, NIterations = 0;
+    Int_t NFits = 0, NInvalid = 0;
+    for(auto &result : Results) {
+        file << "{\"country\":\"" << result.Country << "\",\"bytes_read\":" << result.Data.BytesRead << ",\"stages\":{";
+        for(int istage=0 ; istage<kNStages ; istage++) {
+            file << (istage ? "," : "") << TString::Format("\"%s\":{\"real\":%.6g,\"cpu\":%.6g}",fStageNames[istage],
+                                                           result.Timings.RealTime[istage],result.Timings.CpuTime[istage]);
+            Total.RealTime[istage] += result.Timings.RealTime[istage];
+            Total.CpuTime[istage] += result.Timings.CpuTime[istage];
+        }
+        file << "},\"fits\":[";
+        for(size_t ifit=0 ; ifit<result.Fits.size() ; ifit++) {
+            const ModelFit &fit = result.Fits.at(ifit);
+            file << (ifit ? "," : "") << TString::Format("{\"model\":\"%s\",\"status\":%d,\"valid\":%s,\"cov_status\":%d,\"ncalls\":%d,\"niterations\":%d,\"real_time\":%.6g}",
+                                                         fModelNames[fit.Model],fit.Status,fit.Valid ? "true" : "false",fit.CovStatus,fit.NCalls,fit.NIterations,fit.RealTime);
+            NFits++;
+            NCalls += fit.NCalls;
+            NIterations += fit.NIterations;
+            if(!fit.Valid) NInvalid++;
+        }
+        file << "]}" << endl;
+        BytesRead += result.Data.BytesRead;
+    }
+
+    // and one aggregate line for a batch
+    if(Results.size() == 1) return;
+    file << "{\"summary\":true,\"countries\":" << Results.size() << ",\"bytes_read\":" << BytesRead << ",\"stages\":{";
+    for(int istage=0 ; istage<kNStages ; istage++) {
+        file << (istage ? "," : "") << TString::Format("\"%s\":{\"real\":%.6g,\"cpu\":%.6g}",fStageNames[istage],Total.RealTime[istage],Total.CpuTime[istage]);
+    }
+    file << "},\"fits\":" << NFits << ",\"invalid_fits\":" << NInvalid << ",\"ncalls\":" << NCalls << ",\"niterations\":" << NIterations << "}" << endl;
+}
+
+bool SaveState(const vector<AnalysisResult> &Results, TString FileName)
+{
+    gSystem->mkdir(gSystem->DirName(FileName),true);
+    TFile file(FileName,"RECREATE");
+    if(file.IsZombie()) {
+        ERR_MESS << "Cannot create the state file " << FileName << ENDL;
+        return false;
+    }
+
+    // one entry per country, followed by one entry for its cases if they were analysed, the waves and the fits being
+    // stored as parallel vectors
+    string Country;
+    Int_t Cases=0, XMin=0, XMax=0, NSmoothing=0, Weekly=0;
+    Double_t Scale=1.;
+    Int_t Lag=0, LagValid=0;
+    Double_t LagRatio=0., LagCorrelation=0.;
+    vector<string> Dates;
+    vector<Int_t> Bins;
+    vector<Double_t> Total_Deaths, Raw_Daily_Deaths, Daily_Deaths, Daily_Deaths_error, Weekday_Factors;
+    vector<Int_t> Wave_Onset, Wave_Peak, Wave_End;
+    vector<Double_t> Wave_Height, Wave_Prominence, Wave_Area, Wave_RiseWidth;
+    vector<Int_t> Fit_Model, Fit_FullModel, Fit_XMin, Fit_XMax, Fit_Ndf, Fit_Status, Fit_Valid, Fit_NCalls, Fit_NPars, Fit_NBand;
+    vector<Double_t> Fit_Chi2;
+    // the parameters, covariances and bands of the successive fits are concatenated
+    vector<string> Fit_ParNames;
+    vector<Double_t> Fit_Pars, Fit_Errors, Fit_Covariance, Fit_Band, Fit_Band_error;
+
+    TTree *tree = new TTree("state","Analysis state, one entry per country");
+    tree->SetDirectory(&file);
+    tree->Branch("country",&Country);
+    tree->Branch("cases",&Cases);
+    tree->Branch("scale",&Scale);
+    tree->Branch("lag",&Lag);
+    tree->Branch("lag_ratio",&LagRatio);
+    tree->Branch("lag_correlation",&LagCorrelation);
+    tree->Branch("lag_valid",&LagValid);
+    tree->Branch("xmin",&XMin);
+    tree->Branch("xmax",&XMax);
+    tree->Branch("smoothing",&NSmoothing);
+    tree->Branch("weekly",&Weekly);
+    tree->Branch("weekday_factors",&Weekday_Factors);
+    tree->Branch("dates",&Dates);
+    tree->Branch("bins",&Bins);
+    tree->Branch("total_deaths",&Total_Deaths);
+    tree->Branch("raw_daily_deaths",&Raw_Daily_Deaths);
+    tree->Branch("daily_deaths",&Daily_Deaths);
+    tree->Branch("daily_deaths_error",&Daily_Deaths_error);
+    tree->Branch("wave_onset",&Wave_Onset);
+    tree->Branch("wave_peak",&Wave_Peak);
+    tree->Branch("wave_end",&Wave_End);
+    tree->Branch("wave_height",&Wave_Height);
+    tree->Branch("wave_prominence",&Wave_Prominence);
+    tree->Branch("wave_area",&Wave_Area);
+    tree->Branch("wave_rise_width",&Wave_RiseWidth);
+    tree->Branch("fit_model",&Fit_Model);
+    tree->Branch("fit_full_model",&Fit_FullModel);
+    tree->Branch("fit_xmin",&Fit_XMin);
+    tree->Branch("fit_xmax",&Fit_XMax);
+    tree->Branch("fit_chi2",&Fit_Chi2);
+    tree->Branch("fit_ndf",&Fit_Ndf);
+    tree->Branch("fit_status",&Fit_Status);
+    tree->Branch("fit_valid",&Fit_Valid);
+    tree->Branch("fit_ncalls",&Fit_NCalls);
+    tree->Branch("fit_npars",&Fit_NPars);
+    tree->Branch("fit_nband",&Fit_NBand);
+    tree->Branch("fit_par_names",&Fit_ParNames);
+    tree->Branch("fit_pars",&Fit_Pars);
+    tree->Branch("fit_errors",&Fit_Errors);
+    tree->Branch("fit_covariance",&Fit_Covariance);
+    tree->Branch("fit_band",&Fit_Band);
+    tree->Branch("fit_band_error",&Fit_Band_error);
+
+    auto Fill = [&](const AnalysisResult &result, const LagEstimate &lag) {
+        const Series &series = result.Data;
+        Country = result.Country.Data();
+        Cases = series.Cases;
+        Scale = series.Scale;
+        Lag = lag.Lag;
+        LagRatio = lag.Ratio;
+        LagCorrelation = lag.Correlation;
+        LagValid = lag.Valid;
+        XMin = result.XMin;
+        XMax = result.XMax;
+        NSmoothing = series.NSmoothing;
+        Weekly = series.Weekly;
+        Weekday_Factors = series.Weekday_Factors;
+        Dates.clear();
+        for(auto &date : series.Dates) Dates.push_back(date.Data());
+        Bins = series.Bins;
+        Total_Deaths = series.Total_Deaths;
+        Raw_Daily_Deaths = series.Raw_Daily_Deaths;
+        Daily_Deaths = series.Daily_Deaths;
+        Daily_Deaths_error = series.Daily_Deaths_error;
+
+        Wave_Onset.clear(); Wave_Peak.clear(); Wave_End.clear();
+        Wave_Height.clear(); Wave_Prominence.clear(); Wave_Area.clear(); Wave_RiseWidth.clear();
+        for(auto &wave : series.Waves) {
+            Wave_Onset.push_back(wave.Onset);
+            Wave_Peak.push_back(wave.Peak);
+            Wave_End.push_back(wave.End);
+            Wave_Height.push_back(wave.Height);
+            Wave_Prominence.push_back(wave.Prominence);
+            Wave_Area.push_back(wave.Area);
+            Wave_RiseWidth.push_back(wave.RiseWidth);
+        }
+
+        Fit_Model.clear(); Fit_FullModel.clear(); Fit_XMin.clear(); Fit_XMax.clear(); Fit_Ndf.clear(); Fit_Status.clear();
+        Fit_Valid.clear(); Fit_NCalls.clear(); Fit_NPars.clear(); Fit_NBand.clear(); Fit_Chi2.clear();
+        Fit_ParNames.clear(); Fit_Pars.clear(); Fit_Errors.clear(); Fit_Covariance.clear(); Fit_Band.clear(); Fit_Band_error.clear();
+        for(auto &fit : result.Fits) {
+            Fit_Model.push_back(fit.Model);
+            Fit_FullModel.push_back(fit.FullModel);
+            Fit_XMin.push_back(fit.XMin);
+            Fit_XMax.push_back(fit.XMax);
+            Fit_Chi2.push_back(fit.Chi2);
+            Fit_Ndf.push_back(fit.Ndf);
+            Fit_Status.push_back(fit.Status);
+            Fit_Valid.push_back(fit.Valid);
+            Fit_NCalls.push_back(fit.NCalls);
+            Fit_NPars.push_back(fit.Pars.size());
+            Fit_NBand.push_back(fit.Band.size());
+            for(auto &name : fit.ParNames) Fit_ParNames.push_back(name.Data());
+            Fit_Pars.insert(Fit_Pars.end(),fit.Pars.begin(),fit.Pars.end());
+            Fit_Errors.insert(Fit_Errors.end(),fit.Errors.begin(),fit.Errors.end());
+            // the covariance is always stored as a NPars x NPars matrix (zeros if the fit failed)
+            vector<Double_t> Covariance = fit.Covariance;
+            Covariance.resize(fit.Pars.size()*fit.Pars.size(),0.);
+            Fit_Covariance.insert(Fit_Covariance.end(),Covariance.begin(),Covariance.end());
+            Fit_Band.insert(Fit_Band.end(),fit.Band.begin(),fit.Band.end());
+            Fit_Band_error.insert(Fit_Band_error.end(),fit.Band_error.begin(),fit.Band_error.end());
+        }
+
+        tree->Fill();
+    };
+
+    for(auto &result : Results) {
+        Fill(result,result.Lag);
+        if(!result.Cases.Dates.empty()) Fill(GetCasesResult(result),result.Lag);
+    }
+
+    file.cd();
+    tree->Write();
+    file.Close();
+
+    INFO_MESS << "State of " << Results.size() << " countries saved in " << FileName << ENDL;
+
+    return true;
+}
+
+bool LoadState(TString FileName, vector<AnalysisResult> &Results)
+{
+    Results.clear();
+
+    unique_ptr<TFile> file(TFile::Open(FileName));
+    if(file == nullptr || file->IsZombie()) {
+        ERR_MESS << "Cannot open the state file " << FileName << ENDL;
+        return false;
+    }
+
+    TTreeReader reader("state",file.get());
+    if(reader.GetTree() == nullptr) {
+        ERR_MESS << "No analysis state found in " << FileName << ENDL;
+        return false;
+    }
+
+    TTreeReaderValue<string> Country(reader,"country");
+    TTreeReaderValue<Int_t> Cases(reader,"cases");
+    TTreeReaderValue<Double_t> Scale(reader,"scale");
+    TTreeReaderValue<Int_t> Lag(reader,"lag");
+    TTreeReaderValue<Double_t> LagRatio(reader,"lag_ratio");
+    TTreeReaderValue<Double_t> LagCorrelation(reader,"lag_correlation");
+    TTreeReaderValue<Int_t> LagValid(reader,"lag_valid");
+    TTreeReaderValue<Int_t> XMin(reader,"xmin");
+    TTreeReaderValue<Int_t> XMax(reader,"xmax");
+    TTreeReaderValue<Int_t> NSmoothing(reader,"smoothing");
+    TTreeReaderValue<Int_t> Weekly(reader,"weekly");
+    TTreeReaderValue< vector<Double_t> > Weekday_Factors(reader,"weekday_factors");
+    TTreeReaderValue< vector<string> > Dates(reader,"dates");
+    TTreeReaderValue< vector<Int_t> > Bins(reader,"bins");
+    TTreeReaderValue< vector<Double_t> > Total_Deaths(reader,"total_deaths");
+    TTreeReaderValue< vector<Double_t> > Raw_Daily_Deaths(reader,"raw_daily_deaths");
+    TTreeReaderValue< vector<Double_t> > Daily_Deaths(reader,"daily_deaths");
+    TTreeReaderValue< vector<Double_t> > Daily_Deaths_error(reader,"daily_deaths_error");
+    TTreeReaderValue< vector<Int_t> > Wave_Onset(reader,"wave_onset");
+    TTreeReaderValue< vector<Int_t> > Wave_Peak(reader,"wave_peak");
+    TTreeReaderValue< vector<Int_t> > Wave_End(reader,"wave_end");
+    TTreeReaderValue< vector<Double_t> > Wave_Height(reader,"wave_height");
+    TTreeReaderValue< vector<Double_t> > Wave_Prominence(reader,"wave_prominence");
+    TTreeReaderValue< vector<Double_t> > Wave_Area(reader,"wave_area");
+    TTreeReaderValue< vector<Double_t> > Wave_RiseWidth(reader,"wave_rise_width");
+    TTreeReaderValue< vector<Int_t> > Fit_Model(reader,"fit_model");
+    TTreeReaderValue< vector<Int_t> > Fit_FullModel(reader,"fit_full_model");
+    TTreeReaderValue< vector<Int_t> > Fit_XMin(reader,"fit_xmin");
+    TTreeReaderValue< vector<Int_t> > Fit_XMax(reader,"fit_xmax");
+    TTreeReaderValue< vector<Double_t> > Fit_Chi2(reader,"fit_chi2");
+    TTreeReaderValue< vector<Int_t> > Fit_Ndf(reader,"fit_ndf");
+    TTreeReaderValue< vector<Int_t> > Fit_Status(reader,"fit_status");
+    TTreeReaderValue< vector<Int_t> > Fit_Valid(reader,"fit_valid");
+    TTreeReaderValue< vector<Int_t> > Fit_NCalls(reader,"fit_ncalls");
+    TTreeReaderValue< vector<Int_t> > Fit_NPars(reader,"fit_npars");
+    TTreeReaderValue< vector<Int_t> > Fit_NBand(reader,"fit_nband");
+    TTreeReaderValue< vector<string> > Fit_ParNames(reader,"fit_par_names");
+    TTreeReaderValue< vector<Double_t> > Fit_Pars(reader,"fit_pars");
+    TTreeReaderValue< vector<Double_t> > Fit_Errors(reader,"fit_errors");
+    TTreeReaderValue< vector<Double_t> > Fit_Covariance(reader,"fit_covariance");
+    TTreeReaderValue< vector<Double_t> > Fit_Band(reader,"fit_band");
+    TTreeReaderValue< vector<Double_t> > Fit_Band_error(reader,"fit_band_error");
+
+    while(reader.Next()) {
+        AnalysisResult result;
+        Series &series = result.Data;
+        result.Country = Country->c_str();
+        result.XMin = *XMin;
+        result.XMax = *XMax;
+
+        result.Lag.Lag = *Lag;
+        result.Lag.Ratio = *LagRatio;
+        result.Lag.Correlation = *LagCorrelation;
+        result.Lag.Valid = *LagValid;
+
+        series.Country = result.Country;
+        series.Cases = *Cases;
+        series.Scale = *Scale;
+        for(auto &date : *Dates) series.Dates.push_back(date.c_str());
+        series.Bins = *Bins;
+        series.Total_Deaths = *Total_Deaths;
+        series.Raw_Daily_Deaths = *Raw_Daily_Deaths;
+        series.NSmoothing = *NSmoothing;
+        series.Weekly = *Weekly;
+        series.Weekday_Factors = *Weekday_Factors;
+        series.Daily_Deaths = *Daily_Deaths;
+        series.Daily_Deaths_error = *Daily_Deaths_error;
+        // the prefix sums are rebuilt, to be able to smooth again the data without reading the file, from the data corrected
+        // by the weekday factors if the weekly cycle was removed
+        if(series.Weekly && series.Weekday_Factors.size() == 7) {
+            Int_t FirstWeekday = GetFirstWeekday(series);
+            vector<Double_t> Adjusted(series.Raw_Daily_Deaths.size());
+            for(size_t i=0 ; i<Adjusted.size() ; i++) Adjusted.at(i) = series.Raw_Daily_Deaths.at(i)/series.Weekday_Factors.at((FirstWeekday+i)%7);
+            BuildPrefixSums(Adjusted,series.Prefix_Sum,series.Prefix_NPoints);
+        }
+        else BuildPrefixSums(series.Raw_Daily_Deaths,series.Prefix_Sum,series.Prefix_NPoints);
+
+        for(size_t iwave=0 ; iwave<Wave_Onset->size() ; iwave++) {
+            Wave wave;
+            wave.Onset = Wave_Onset->at(iwave);
+            wave.Peak = Wave_Peak->at(iwave);
+            wave.End = Wave_End->at(iwave);
+            wave.Height = Wave_Height->at(iwave);
+            wave.Prominence = Wave_Prominence->at(iwave);
+            wave.Area = Wave_Area->at(iwave);
+            wave.RiseWidth = Wave_RiseWidth->at(iwave);
+            series.Waves.push_back(wave);
+        }
+
+        size_t ParOffset=0, BandOffset=0, CovOffset=0;
+        for(size_t ifit=0 ; ifit<Fit_Model->size() ; ifit++) {
+            ModelFit fit;
+            fit.Model = Fit_Model->at(ifit);
+            fit.FullModel = Fit_FullModel->at(ifit);
+            fit.XMin = Fit_XMin->at(ifit);
+            fit.XMax = Fit_XMax->at(ifit);
+            fit.Chi2 = Fit_Chi2->at(ifit);
+            fit.Ndf = Fit_Ndf->at(ifit);
+            fit.Status = Fit_Status->at(ifit);
+            fit.Valid = Fit_Valid->at(ifit);
+            fit.NCalls = Fit_NCalls->at(ifit);
+
+            size_t NPars = Fit_NPars->at(ifit);
+            size_t NBand = Fit_NBand->at(ifit);
+            for(size_t ipar=0 ; ipar<NPars ; ipar++) fit.ParNames.push_back(Fit_ParNames->at(ParOffset+ipar).c_str());
+            fit.Pars.assign(Fit_Pars->begin()+ParOffset,Fit_Pars->begin()+ParOffset+NPars);
+            fit.Errors.assign(Fit_Errors->begin()+ParOffset,Fit_Errors->begin()+ParOffset+NPars);
+            fit.Covariance.assign(Fit_Covariance->begin()+CovOffset,Fit_Covariance->begin()+CovOffset+NPars*NPars);
+            fit.Band.assign(Fit_Band->begin()+BandOffset,Fit_Band->begin()+BandOffset+NBand);
+            fit.Band_error.assign(Fit_Band_error->begin()+BandOffset,Fit_Band_error->begin()+BandOffset+NBand);
+            ParOffset += NPars;
+            CovOffset += NPars*NPars;
+            BandOffset += NBand;
+
+            if(fit.Model>=0 && fit.Model<kNModels) result.Fits.push_back(fit);
+        }
+
+        // the cases are given back to the deaths of their country, saved just before them
+        if(series.Cases) {
+            if(Results.empty() || Results.back().Country != result.Country || !Results.back().Cases.Dates.empty()) {
+                WARN_MESS << "Cases of " << result.Country << " without their deaths in " << FileName << ", skipped" << ENDL;
+                continue;
+            }
+            AnalysisResult &deaths = Results.back();
+            deaths.Cases = move(result.Data);
+            deaths.CasesXMin = result.XMin;
+            deaths.CasesXMax = result.XMax;
+            deaths.CaseFits = move(result.Fits);
+            continue;
+        }
+
+        Results.push_back(result);
+    }
+
+    return true;
+}
+
+void Replot(TString FileName, vector<TString> Countries, Int_t NRenderWorkers)
+{
+    vector<AnalysisResult> Results;
+    if(LoadState(FileName,Results) == false) return;
+
+    // only the requested countries are plotted
+    if(!Countries.empty()) {
+        vector<AnalysisResult> Selected;
+        for(auto &country : Countries) {
+            Bool_t Found = false;
+            for(auto &result : Results) {
+                if(result.Country == country) {
+                    Selected.push_back(result);
+                    Found = true;
+                }
+            }
+            if(!Found) WARN_MESS << country << " not found in " << FileName << ENDL;
+        }
+        Results = Selected;
+    }
+
+    // one country is plotted in the current session, several ones by the render workers
+    RenderQueue queue;
+    if(Results.size()>1 && StartRenderQueue(queue,NRenderWorkers)) {
+        for(auto &result : Results) {
+            QueueRender(queue,result);
+            if(!result.Cases.Dates.empty()) QueueRender(queue,GetCasesResult(result));
+        }
+        StopRenderQueue(queue);
+    }
+    else {
+        for(auto &result : Results) {
+            DrawResult(result);
+            if(!result.Cases.Dates.empty()) DrawResult(GetCasesResult(result));
+        }
+    }
+
+    INFO_MESS << Results.size() << " countries plotted from " << FileName << ENDL;
+}
+
+Double_t FuncESIR2(Double_t*xx,Double_t*pp) {
+
+    Double_t a  = pp[0];
+    Double_t b  = pp[1];
+    Double_t c  = pp[2];
+    Double_t a2  = pp[3];
+    Double_t b2  = pp[4];
+
+    Double_t t0 = pp[5];
+    Double_t x   = xx[0] - t0;
+
+    Double_t r = a/(2*a + TMath::Exp(-x/b)) + a/(2*a + TMath::Exp(-x/c));
+
+    Double_t Daily = a2 * (1 - TMath::Exp(-r/b2) - r);
+
+    return Daily;
+}
+
+Double_t FuncESIR(Double_t*xx,Double_t*pp) {
+
+    Double_t a  = pp[0];
+    Double_t b  = pp[1];
+    Double_t c  = pp[2];
+
+    Double_t a2  = pp[3];
+    Double_t b2  = pp[4];
+
+    Double_t t0 = pp[5];
+    Double_t x   = xx[0] - t0;
+
+    Double_t r = a/(2*c + TMath::Exp(-x/b));
+
+    Double_t Daily = a2 * (1 - TMath::Exp(-r/b2) - r);
+
+    return Daily;
+}
+
+Double_t FuncESIR2Full(Double_t*xx,Double_t*pp) {
+
+    Double_t a  = pp[0];
+    Double_t b  = pp[1];
+    Double_t c  = pp[2];
+
+    Double_t ap  = pp[3];
+    Double_t bp  = pp[4];
+    Double_t cp  = pp[5];
+
+    Double_t a2  = pp[6];
+    Double_t b2  = pp[7];
+
+    Double_t t0 = pp[8];
+    Double_t x   = xx[0] - t0;
+
+    Double_t r = a/(2*c + TMath::Exp(-x/b)) + ap/(2*cp + TMath::Exp(-x/bp));
+
+    Double_t Daily = a2 * (1 - TMath::Exp(-r/b2) - r);
+
+    return Daily;
+}
+
+Double_t FuncD2(Double_t*xx,Double_t*pp) {
+
+    Double_t a1  = pp[0];
+    Double_t b1  = pp[1];
+    Double_t c1  = pp[2];
+    Double_t b2  = pp[3];
+
+    Double_t t0 = pp[4];
+    Double_t x   = xx[0] - t0;
+
+    Double_t D1 = a1*TMath::Exp(x/b1)/(b1*TMath::Power(1+c1*TMath::Exp(x/b1),2));
+    Double_t D2 = a1*TMath::Exp(x/b2)/(b2*TMath::Power(1+c1*TMath::Exp(x/b2),2));
+
+    Double_t Daily = D1+D2;
+
+    return Daily;
+}
+
+Double_t FuncD2Full(Double_t*xx,Double_t*pp) {
+
+    Double_t a1  = pp[0];
+    Double_t b1  = pp[1];
+    Double_t c1  = pp[2];
+
+    Double_t a2  = pp[3];
+    Double_t b2  = pp[4];
+    Double_t c2  = pp[5];
+
+    Double_t t0 = pp[6];
+    Double_t x   = xx[0] - t0;
+
+    Double_t D1 = a1*TMath::Exp(x/b1)/(b1*TMath::Power(1+c1*TMath::Exp(x/b1),2));
+    Double_t D2 = a2*TMath::Exp(x/b2)/(b2*TMath::Power(1+c2*TMath::Exp(x/b2),2));
+
+    Double_t Daily = D1+D2;
+
+    return Daily;
+}
+
+Double_t FuncD(Double_t*xx,Double_t*pp) {
+
+    Double_t a1  = pp[0];
+    Double_t b1  = pp[1];
+    Double_t c1  = pp[2];
+
+    Double_t t0 = pp[3];
+    Double_t x   = xx[0] - t0;
+
+    Double_t D1 = a1*TMath::Exp(x/b1)/(b1*TMath::Power(1+c1*TMath::Exp(x/b1),2));
+
+    Double_t Daily = D1;
+
+    return Daily;
+}
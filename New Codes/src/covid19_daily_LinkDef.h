@@ -0,0 +1,21 @@
+#ifdef __CLING__
+
+#pragma link off all globals;
+#pragma link off all classes;
+#pragma link off all functions;
+
+#pragma link C++ defined_in "covid19_daily.h";
+
+// the structures containing files, threads, processes, the memoised stages, the joint chi2 or the compartmental functions
+// are only used inside the library
+#pragma link off class Exporter;
+#pragma link off class RenderQueue;
+#pragma link off class Pipeline;
+#pragma link off class JointChi2;
+#pragma link off class CompartmentalFunction;
+#pragma link off class CompartmentalFunctor;
+
+#pragma link C++ class vector<AnalysisResult>+;
+#pragma link C++ class vector<RegionCheck>+;
+
+#endif
@@ -0,0 +1,484 @@
+#include "covid19_daily.h"
+
+#include "TError.h"
+
+#include <map>
+#include <sstream>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+///****************************************************************************************************************
+///                                  Resident server of the daily analysis
+///****************************************************************************************************************
+/// covid19_server [--socket PATH] [--jobs N] [--data-dir DIR] [--models LIST] [--simple-models] [--deaths-min N] [--no-waves] [--weekly]
+///                [--forecast N] [--final-days N]
+///             => the server listens on a Unix socket, the data of the countries, and the parameters of their last
+///                fits (used as starting point of the next fits) being kept in memory between the requests
+///             => a data file is read again only when it has been modified on disk, only the appended lines being then parsed
+///             => one request per line, as key=value words, one JSON object per line is sent back:
+///                  country=South_Africa models=D2,ESIR2 full=1 smoothing=7 read_from=1-Apr-20 read_to= fit_from=1-Apr-20 fit_to=1-Dec-20 band=1
+///                  country=South_Africa forecast=30 final_days=365
+///                  stats
+///                only the country is mandatory, the other keys take the values given on the server command line
+///             => with forecast=N, the projections of the fits over N days are added to the answer, the forecasts being
+///                cached per fit so that the same fit asked again is not projected again
+///             => the requests are processed by N threads (0: all the cores), each connection being served by one thread
+///             => ex: echo "country=South_Africa smoothing=7" | nc -U covid19_server.sock
+///****************************************************************************************************************
+
+// data of a country kept in memory, with the state of its file when it has been read
+struct CachedData {
+    Long_t ModTime = 0;
+    Long_t Size = 0;
+    DataFile File;                          // only the appended lines are parsed when the file grows
+    Long64_t BytesRead = 0;                 // bytes parsed at the last read
+};
+
+// options of an analysis request
+struct Request {
+    TString Country;
+    Bool_t DoModels[kNModels] = {};
+    Bool_t FullModel = true;
+    Int_t NSmoothing = 7;
+    TString ReadFrom, ReadTo, FitFrom, FitTo;
+    Bool_t ComputeBand = true;
+    Int_t ForecastDays = 0;                 // 0: no forecast
+    Int_t FinalDays = 365;
+};
+
+// server state, shared by the threads
+struct Server {
+    TString SocketPath;
+    int Socket = -1;
+    Request Defaults;                                   // options used when not given in a request
+
+    mutex DataMutex;
+    map<TString,shared_ptr<const CachedData>> Data;    // per country
+
+    mutex StartMutex;
+    map<TString,ModelFit> Starts;                       // last valid fit per country and model, used as warm start
+
+    atomic<Long64_t> NRequests{0};
+    atomic<Long64_t> NErrors{0};
+    atomic<Long64_t> NReads{0};                         // number of data files read (first read and reloads)
+    atomic<Bool_t> Stop{false};
+};
+
+Server fServer;
+
+// to stop the server on SIGINT and SIGTERM: the threads waiting in accept are woken up by the shutdown of the socket
+void StopServer(int)
+{
+    fServer.Stop = true;
+    if(fServer.Socket >= 0) shutdown(fServer.Socket,SHUT_RDWR);
+}
+
+// to print the command line options
+void PrintUsage(const char *Program)
+{
+    cout << "Usage: " << Program << " [options]" << endl;
+    cout << endl;
+    cout << "  --socket PATH          Unix socket where the requests are received (default: covid19_server.sock)" << endl;
+    cout << "  --jobs N               number of threads processing the requests, 0: all the cores (default: 0)" << endl;
+    cout << "  --data-dir DIR         folder of the data files (default: ./worldometers/)" << endl;
+    cout << "  --models LIST          default models, among D,D2,ESIR,ESIR2,SIR,SEIRD (default: D2,ESIR2)" << endl;
+    cout << "  --simple-models        fit the simple models by default instead of the full ones" << endl;
+    cout << "  --smoothing N          default number of days of the sliding window (default: 7)" << endl;
+    cout << "  --deaths-min N         minimal number of deaths to start to take the data into account (default: 10)" << endl;
+    cout << "  --no-waves             no waves detection" << endl;
+    cout << "  --weekly               remove the weekly reporting cycle (weekday factors) before a centred smoothing" << endl;
+    cout << "  --forecast N           default number of projected days after the last data, 0: no forecast (default: 0)" << endl;
+    cout << "  --final-days N         default number of days after the last data of the final toll (default: 365)" << endl;
+    cout << "  -h, --help             print this message" << endl;
+    cout << endl;
+    cout << "Requests, one per line: country=NAME [models=LIST] [full=0|1] [smoothing=N] [read_from=DATE] [read_to=DATE]" << endl;
+    cout << "                        [fit_from=DATE] [fit_to=DATE] [band=0|1] [forecast=N] [final_days=N], or stats" << endl;
+}
+
+// to read a list of models, returns false if a model is unknown
+Bool_t GetModelsOption(TString Value, Bool_t *DoModels, TString &Error)
+{
+    for(int imodel=0 ; imodel<kNModels ; imodel++) DoModels[imodel] = false;
+    TObjArray *arr = Value.Tokenize(",");
+    Bool_t Ok = true;
+    for(int i=0 ; i<arr->GetEntries() ; i++) {
+        TString Model = arr->At(i)->GetName();
+        Model.ToUpper();
+        if(Model == "D") DoModels[kModelD] = true;
+        else if(Model == "D2") DoModels[kModelD2] = true;
+        else if(Model == "ESIR") DoModels[kModelESIR] = true;
+        else if(Model == "ESIR2") DoModels[kModelESIR2] = true;
+        else if(Model == "SIR") DoModels[kModelSIR] = true;
+        else if(Model == "SEIRD") DoModels[kModelSEIRD] = true;
+        else {
+            Error = "unknown model '" + Model + "', the models are D,D2,ESIR,ESIR2,SIR,SEIRD";
+            Ok = false;
+        }
+    }
+    delete arr;
+    return Ok;
+}
+
+// to read a request line, returns false (with the reason in Error) if the request is not valid
+Bool_t ParseRequest(TString Line, Request &request, TString &Error)
+{
+    request = fServer.Defaults;
+
+    TObjArray *arr = Line.Tokenize(" \t");
+    Bool_t Ok = true;
+    for(int i=0 ; i<arr->GetEntries() && Ok ; i++) {
+        TString Word = arr->At(i)->GetName();
+        Int_t Pos = Word.Index("=");
+        if(Pos<0) {
+            Error = "'" + Word + "' is not a key=value word";
+            Ok = false;
+            break;
+        }
+        TString Key = Word(0,Pos);
+        TString Value = Word(Pos+1,Word.Length());
+
+        if(Key == "country") request.Country = Value;
+        else if(Key == "models") Ok = GetModelsOption(Value,request.DoModels,Error);
+        else if(Key == "full") request.FullModel = (Value != "0" && Value != "false");
+        else if(Key == "band") request.ComputeBand = (Value != "0" && Value != "false");
+        else if(Key == "smoothing") {
+            if(!Value.IsDigit() || Value.Atoi()<1) {
+                Error = "smoothing needs a positive integer, got '" + Value + "'";
+                Ok = false;
+            }
+            else request.NSmoothing = Value.Atoi();
+        }
+        else if(Key == "forecast" || Key == "final_days") {
+            if(!Value.IsDigit() || (Key == "final_days" && Value.Atoi()<1)) {
+                Error = Key + " needs a positive integer, got '" + Value + "'";
+                Ok = false;
+            }
+            else if(Key == "forecast") request.ForecastDays = Value.Atoi();
+            else request.FinalDays = Value.Atoi();
+        }
+        else if(Key == "read_from" || Key == "read_to" || Key == "fit_from" || Key == "fit_to") {
+            if(Value != "" && GetDateBin(Value) == -1) {
+                Error = Key + " needs a date between 1-Jan-20 and 31-Dec-21, got '" + Value + "'";
+                Ok = false;
+            }
+            else if(Key == "read_from") request.ReadFrom = Value;
+            else if(Key == "read_to") request.ReadTo = Value;
+            else if(Key == "fit_from") request.FitFrom = Value;
+            else request.FitTo = Value;
+        }
+        else {
+            Error = "unknown key '" + Key + "'";
+            Ok = false;
+        }
+    }
+    delete arr;
+
+    if(Ok && request.Country == "") {
+        Error = "no country given";
+        Ok = false;
+    }
+    // the country is a file name of the data folder, not a path
+    if(Ok && (request.Country.Contains("/") || request.Country.BeginsWith(".") || IsDataStream(request.Country))) {
+        Error = "'" + request.Country + "' is not a country";
+        Ok = false;
+    }
+    return Ok;
+}
+
+// to get the data of a country, read again only if the file has changed since the last read (nullptr if not available)
+shared_ptr<const CachedData> GetData(TString Country, Bool_t &Reloaded)
+{
+    Reloaded = false;
+    TString FileName = GetDataFileName(Country);
+
+    Long_t Id, Size, Flags, ModTime;
+    if(gSystem->GetPathInfo(GetSourceFile(FileName),&Id,&Size,&Flags,&ModTime) != 0) return nullptr;
+
+    shared_ptr<const CachedData> previous;
+    {
+        lock_guard<mutex> lock(fServer.DataMutex);
+        auto it = fServer.Data.find(Country);
+        if(it != fServer.Data.end()) {
+            if(it->second->ModTime == ModTime && it->second->Size == Size) return it->second;
+            previous = it->second;
+        }
+    }
+
+    // the file is read outside of the lock, two threads reading the same new file at the same time only do the work twice,
+    // the new data starting from a copy of the previous ones, still used by the running requests
+    auto data = make_shared<CachedData>();
+    if(previous) data->File = previous->File;
+    else data->File.FileName = FileName;
+    data->ModTime = ModTime;
+    data->Size = Size;
+    if(UpdateDataFile(data->File,&data->BytesRead) == kDataNotFound) return nullptr;
+    fServer.NReads++;
+    Reloaded = true;
+
+    lock_guard<mutex> lock(fServer.DataMutex);
+    fServer.Data[Country] = data;
+    return data;
+}
+
+// to analyse a country as asked in a request, the result being written as one JSON object
+Bool_t ProcessRequest(const Request &request, ostream &out, TString &Error)
+{
+    Double_t Start = GetRealTime();
+
+    AnalysisResult result;
+    result.Country = request.Country;
+
+    StageClock clock = StartStage();
+    Bool_t Reloaded = false;
+    shared_ptr<const CachedData> data = GetData(request.Country,Reloaded);
+    if(data == nullptr) {
+        Error = "no data for '" + request.Country + "'";
+        return false;
+    }
+
+    // the read range is applied on the data in memory, as done by ReadData on the file
+    Series &series = result.Data;
+    series.Country = request.Country;
+    series.BytesRead = data->BytesRead;
+    series.Dates = data->File.Dates;
+    series.Total_Deaths = data->File.Total_Deaths;
+    TrimDataRange(series.Dates,series.Total_Deaths,request.ReadFrom,request.ReadTo);
+    if(!BuildSeries(series)) {
+        Error = "empty data for '" + request.Country + "' in the read range";
+        return false;
+    }
+    StopStage(result.Timings,kStageRead,clock);
+
+    clock = StartStage();
+    SmoothSeries(series,request.NSmoothing);
+    StopStage(result.Timings,kStageSmooth,clock);
+
+    GetFitRange(series,request.FitFrom,request.FitTo,result.XMin,result.XMax);
+
+    // each model starts from the last valid fit of the same country, model, fit start and smoothing: the time parameters are
+    // relative to the start of the fit range and the amplitudes depend on the smoothing, a start from another range or
+    // smoothing being further from the minimum than the default starting values
+    for(int Model=0 ; Model<kNModels ; Model++) {
+        if(!request.DoModels[Model]) continue;
+        TString Key = Form("%s/%d/%d/%d/%d%s",request.Country.Data(),Model,request.FullModel,result.XMin,request.NSmoothing,GetCompartmentalKey(Model).Data());
+
+        ModelFit start;
+        Bool_t HasStart = false;
+        {
+            lock_guard<mutex> lock(fServer.StartMutex);
+            auto it = fServer.Starts.find(Key);
+            if(it != fServer.Starts.end()) {
+                start = it->second;
+                HasStart = true;
+            }
+        }
+
+        ModelFit fit;
+        FitModel(Model,request.FullModel,series,result.XMin,result.XMax,fit,(HasStart) ? &start : nullptr,request.ComputeBand,&result.Timings);
+
+        // only the parameters are needed for the next fits
+        if(fit.Valid) {
+            ModelFit last;
+            last.Model = fit.Model;
+            last.FullModel = fit.FullModel;
+            last.Pars = fit.Pars;
+            last.Valid = true;
+            lock_guard<mutex> lock(fServer.StartMutex);
+            fServer.Starts[Key] = last;
+        }
+        result.Fits.push_back(fit);
+    }
+
+    out << "{\"ok\":true,\"reloaded\":" << ((Reloaded) ? "true" : "false");
+    out << ",\"real_time\":" << TString::Format("%.6f",GetRealTime()-Start) << ",\"result\":";
+    WriteResultJSON(out,result);
+
+    // the forecasts are taken from the cache when the same fit has already been projected
+    if(request.ForecastDays>0) {
+        out << ",\"forecasts\":[";
+        for(size_t ifit=0 ; ifit<result.Fits.size() ; ifit++) {
+            Forecast forecast;
+            GetForecast(result.Fits.at(ifit),series,forecast,request.ForecastDays,request.FinalDays);
+            if(ifit) out << ",";
+            WriteForecastJSON(out,forecast);
+        }
+        out << "]";
+    }
+    out << "}";
+    return true;
+}
+
+// to write the counters of the server as one JSON object
+void WriteStats(ostream &out)
+{
+    size_t NCountries, NStarts;
+    {
+        lock_guard<mutex> lock(fServer.DataMutex);
+        NCountries = fServer.Data.size();
+    }
+    {
+        lock_guard<mutex> lock(fServer.StartMutex);
+        NStarts = fServer.Starts.size();
+    }
+    out << "{\"ok\":true,\"requests\":" << fServer.NRequests << ",\"errors\":" << fServer.NErrors << ",\"reads\":" << fServer.NReads;
+    out << ",\"countries\":" << NCountries << ",\"warm_starts\":" << NStarts << ",\"forecasts\":" << GetNForecasts() << "}";
+}
+
+// to answer all the requests of a connection, until the client closes it
+void ServeConnection(int client)
+{
+    string Pending;
+    char Buffer[4096];
+    while(true) {
+        ssize_t N = read(client,Buffer,sizeof(Buffer));
+        if(N < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) && !fServer.Stop) continue;
+        if(N <= 0) break;
+        Pending.append(Buffer,N);
+
+        size_t End;
+        while((End = Pending.find('\n')) != string::npos) {
+            TString Line(Pending.data(),End);
+            Line.ReplaceAll("\r","");
+            Line = Line.Strip(TString::kBoth);
+            Pending.erase(0,End+1);
+            if(Line == "") continue;
+
+            ostringstream out;
+            if(Line == "stats") WriteStats(out);
+            else {
+                fServer.NRequests++;
+                Request request;
+                TString Error;
+                if(!ParseRequest(Line,request,Error) || !ProcessRequest(request,out,Error)) {
+                    fServer.NErrors++;
+                    out.str("");
+                    out << "{\"ok\":false,\"error\":\"" << Error.ReplaceAll("\"","'") << "\"}";
+                }
+            }
+            out << "\n";
+            if(!WriteAll(client,out.str().data(),out.str().size())) {
+                close(client);
+                return;
+            }
+        }
+    }
+    close(client);
+}
+
+// main loop of a server thread: the threads wait together in accept, the kernel giving each connection to one of them
+void ServerThread()
+{
+    while(!fServer.Stop) {
+        int client = accept(fServer.Socket,nullptr,nullptr);
+        if(client < 0) {
+            if(errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        // the reads time out every second, for the connections to be closed when the server is stopped
+        timeval Timeout = {1,0};
+        setsockopt(client,SOL_SOCKET,SO_RCVTIMEO,&Timeout,sizeof(Timeout));
+        ServeConnection(client);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    // minimal ROOT initialisation: no application, no graphics window, only the warnings and errors are printed
+    gROOT->SetBatch(true);
+    gErrorIgnoreLevel = kWarning;
+    SetHeadless(true);
+
+    fServer.SocketPath = "covid19_server.sock";
+    Int_t NThreads = 0;
+    Bool_t DoWaves = fDoWaveDetection;
+    Bool_t DoWeekly = false;
+
+    Request &Defaults = fServer.Defaults;
+    Defaults.DoModels[kModelD2] = true;
+    Defaults.DoModels[kModelESIR2] = true;
+    Defaults.NSmoothing = fNSmoothing;
+
+    for(int iarg=1 ; iarg<argc ; iarg++) {
+        TString Option = argv[iarg];
+
+        if(Option == "-h" || Option == "--help") {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        if(Option == "--simple-models") {
+            Defaults.FullModel = false;
+            continue;
+        }
+        if(Option == "--no-waves") {
+            DoWaves = false;
+            continue;
+        }
+        if(Option == "--weekly") {
+            DoWeekly = true;
+            continue;
+        }
+        if(iarg+1 >= argc) {
+            ERR_MESS << Option << " needs a value, see " << argv[0] << " --help" << ENDL;
+            return 2;
+        }
+        TString Value = argv[++iarg];
+        TString Error;
+
+        if(Option == "--socket") fServer.SocketPath = Value;
+        else if(Option == "--data-dir") fDataFolder = Value;
+        else if(Option == "--jobs" && Value.IsDigit()) NThreads = Value.Atoi();
+        else if(Option == "--deaths-min" && Value.IsDigit()) DeathsMin = Value.Atoi();
+        else if(Option == "--smoothing" && Value.IsDigit() && Value.Atoi()>0) Defaults.NSmoothing = Value.Atoi();
+        else if(Option == "--forecast" && Value.IsDigit()) Defaults.ForecastDays = Value.Atoi();
+        else if(Option == "--final-days" && Value.IsDigit() && Value.Atoi()>0) Defaults.FinalDays = Value.Atoi();
+        else if(Option == "--models") {
+            if(!GetModelsOption(Value,Defaults.DoModels,Error)) {
+                ERR_MESS << Error << ENDL;
+                return 2;
+            }
+        }
+        else {
+            ERR_MESS << "Wrong option " << Option << " " << Value << ", see " << argv[0] << " --help" << ENDL;
+            return 2;
+        }
+    }
+    SetWaveDetection(DoWaves,fWaveMinProminence);
+    if(DoWeekly) SetWeeklyDecomposition(true,fWeeklyIterations);
+    if(NThreads<=0) NThreads = thread::hardware_concurrency();
+    NThreads = max(1,NThreads);
+
+    sockaddr_un Address;
+    memset(&Address,0,sizeof(Address));
+    Address.sun_family = AF_UNIX;
+    if(fServer.SocketPath.Length() >= (Int_t)sizeof(Address.sun_path)) {
+        ERR_MESS << "Socket path too long: " << fServer.SocketPath << ENDL;
+        return 2;
+    }
+    strncpy(Address.sun_path,fServer.SocketPath.Data(),sizeof(Address.sun_path)-1);
+
+    // a socket left by a previous server is removed
+    unlink(fServer.SocketPath);
+    fServer.Socket = socket(AF_UNIX,SOCK_STREAM,0);
+    if(fServer.Socket < 0 || bind(fServer.Socket,(sockaddr*)&Address,sizeof(Address)) != 0 || listen(fServer.Socket,64) != 0) {
+        ERR_MESS << "Cannot listen on " << fServer.SocketPath << ": " << strerror(errno) << ENDL;
+        return 1;
+    }
+
+    signal(SIGINT,StopServer);
+    signal(SIGTERM,StopServer);
+    signal(SIGPIPE,SIG_IGN);
+
+    INFO_MESS << "Server listening on " << fServer.SocketPath << " with " << NThreads << " threads, data folder: " << fDataFolder << ENDL;
+
+    ROOT::EnableThreadSafety();
+    vector<thread> Threads;
+    for(int ithread=0 ; ithread<NThreads ; ithread++) Threads.emplace_back(ServerThread);
+    for(auto &thr : Threads) thr.join();
+
+    close(fServer.Socket);
+    unlink(fServer.SocketPath);
+    INFO_MESS << "Server stopped after " << fServer.NRequests << " requests (" << fServer.NErrors << " errors, " << fServer.NReads << " files read)" << ENDL;
+
+    return 0;
+}
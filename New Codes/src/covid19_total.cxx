@@ -0,0 +1,613 @@
+#include "covid19_total.h"
+
+////////////////////////////////////
+/// Global parameters definition ///
+////////////////////////////////////
+
+Bool_t fDoFullModel = true;
+Bool_t fDoD = false;
+Bool_t fDoD2 = true;
+Bool_t fUseOffset = false;
+
+///////////////////////////////////
+/// Global variables definition ///
+///////////////////////////////////
+
+TH1D *hDummyHist = nullptr;
+TH1D *hTotal_Deaths = nullptr;
+
+Int_t fColors[4] = {kMagenta,kGreen,kBlue,kRed};
+
+vector<TString> vDates;
+vector<Double_t> vTotal_Deaths;
+vector<Double_t> vTotal_Deaths_error;
+
+// Main fonction that plots the data and process the fits
+void
+Analyse(TString theCountry) {
+
+    // histogram initialization
+    InitHistograms();
+
+    // to print the program's configuration in the terminal
+    if(!fHeadless) PrintParameters(theCountry);
+
+    // style parameters, to remove unsed default titles and stat
+    gStyle->SetOptTitle(0);
+    gStyle->SetOptStat(0);
+
+    TString FileName = GetDataFileName(theCountry);
+
+    // now, the data file is read using the ReadData function
+    bool data_ok = ReadData(FileName);
+    if(data_ok == false) return;
+
+    // if no data has been read, we exit
+    if(vTotal_Deaths.empty()) {
+        cout<<"OUPS, empty data"<<endl;
+        return;
+    }
+
+    // we remove the first possible data points that are bellow the defined threshold
+    while(vTotal_Deaths.front()<DeathsMin) {
+        vDates.erase(vDates.begin());
+        vTotal_Deaths.erase(vTotal_Deaths.begin());
+    }
+
+    // The fonction SmoothVector is then used to smooth the data on Smooth successive days
+    SmoothVector(fNSmoothing,vTotal_Deaths,vTotal_Deaths_error);
+
+    // for better printouts in the plots, we change the coutries names of US and UK
+    if(theCountry.EqualTo("US",TString::kIgnoreCase)) theCountry = "USA";
+    if(theCountry.EqualTo("UK",TString::kIgnoreCase)) theCountry = "United Kingdom";
+    theCountry.ReplaceAll("_"," ");
+
+    hTotal_Deaths->SetNameTitle(Form("TotalD_%s",theCountry.Data()),Form("TotalD_%s",theCountry.Data()));
+
+    // get the bins corresponding to the defined range
+    Int_t DateMin,DateMax;
+    if(fAxisRangeFrom=="") DateMin = max(1,hDummyHist->GetXaxis()->FindFixBin(vDates.front())-5);
+    else DateMin = hDummyHist->GetXaxis()->FindFixBin(fAxisRangeFrom);
+    if(fAxisRangeTo=="") DateMax = min(hDummyHist->GetNbinsX(),hDummyHist->GetXaxis()->FindFixBin(vDates.back())+5);
+    else DateMax = hDummyHist->GetXaxis()->FindFixBin(fAxisRangeTo);
+
+    // define the fit range
+    Int_t XMin, XMax;
+    if(fFitRangeFrom=="") XMin = DateMin;
+    else XMin = hDummyHist->GetXaxis()->FindFixBin(fFitRangeFrom);
+    if(fFitRangeTo=="") XMax = DateMax;
+    else XMax = hDummyHist->GetXaxis()->FindFixBin(fFitRangeTo);
+
+    // the LastDate string is used to plot the last date of the data
+    TString LastDate = vDates.back();
+    for(size_t i=0 ; i<vDates.size() ; i++) {
+        if(i<vTotal_Deaths.size() && vTotal_Deaths.at(i)) {
+            Int_t Bin = hTotal_Deaths->GetXaxis()->FindFixBin(vDates.at(i));
+            if(Bin>0) {
+                hTotal_Deaths->SetBinContent(Bin,vTotal_Deaths.at(i));
+                hTotal_Deaths->SetBinError(Bin,vTotal_Deaths_error.at(i));
+            }
+            LastDate = vDates.at(i);
+        }
+    }
+
+    // We create the Canvas and margins in which all will be ploted, except in headless mode, the canvas being reused from
+    // one analysis to the other: all the objects drawn in the canvas are owned by it, and deleted when it is cleared
+    TCanvas *MyCanvas = nullptr;
+    if(!fHeadless) {
+        MyCanvas = (TCanvas*)gROOT->GetListOfCanvases()->FindObject("Total");
+        if(MyCanvas == nullptr) {
+            MyCanvas = new TCanvas("Total","Total",1600,1200);
+            MyCanvas->SetLeftMargin(0.107635);
+            MyCanvas->SetRightMargin(0.00125156);
+            MyCanvas->SetBottomMargin(0.13619);
+            MyCanvas->SetTopMargin(0.00190476);
+        }
+        MyCanvas->Clear();
+        MyCanvas->cd();
+
+        // The Total deaths histogram is ploted
+        hTotal_Deaths->Draw("p");
+    }
+
+    // Chi2 definition
+    Double_t fChi2D, fChi2D2;
+    // functions definition, owned by the analysis (a copy is drawn in the canvas)
+    unique_ptr<TF1> fTotal_D, fTotal_D2;
+
+    // Minimizer definition
+    ROOT::Math::MinimizerOptions::SetDefaultMinimizer("Minuit2","Migrad");
+    ROOT::Math::MinimizerOptions::SetDefaultMaxFunctionCalls(kMaxInt);
+    ROOT::Math::MinimizerOptions::SetDefaultErrorDef(2);
+    //    ROOT::Math::MinimizerOptions::SetDefaultTolerance(1e-3);
+    //    ROOT::Math::MinimizerOptions::SetDefaultPrecision(1e-9);
+    if(fHeadless) ROOT::Math::MinimizerOptions::SetDefaultPrintLevel(-1);
+
+    // the fits are quiet in headless mode
+    TString FitOption = (fHeadless) ? "S0Q" : "S0";
+
+    // In the following, we define the different models, as a function of what has been asked in the Main fonctiuon parameters
+    // DModel
+    if(fDoD) {
+        // The function is defined using the FuncD function, defined at the end of the file
+        fTotal_D.reset(new TF1(Form("D_%s",hTotal_Deaths->GetName()),FuncD,hTotal_Deaths->GetXaxis()->GetXmin(),hTotal_Deaths->GetXaxis()->GetXmax(),5,1,TF1::EAddToList::kNo));
+        fTotal_D->SetLineColor(fColors[0]);
+        fTotal_D->SetNpx(1000);
+
+        const int NPars = fTotal_D->GetNpar();
+        vector<Double_t> Pars(NPars);
+
+        if(fUseOffset) {
+            fTotal_D->SetParameter(0,hTotal_Deaths->GetBinContent(hDummyHist->GetBinLowEdge(XMin)));
+            fTotal_D->SetParLimits(0,0,hTotal_Deaths->GetBinContent(hDummyHist->GetBinLowEdge(XMax)));
+        }
+        else
+            fTotal_D->FixParameter(0,0);
+
+        // parameters initialization
+        Pars[1] = 50;
+        Pars[2] = 4.;
+        Pars[3] = 1e-3;
+        Pars[4] = XMin;//hTotal_Deaths->GetXaxis()->GetBinLowEdge(hTotal_Deaths->FindFirstBinAbove(1));
+
+        fTotal_D->SetParameter(1,Pars[1]);
+        fTotal_D->SetParameter(2,Pars[2]);
+        fTotal_D->SetParameter(3,Pars[3]);
+        fTotal_D->FixParameter(4,Pars[4]);
+
+        fTotal_D->SetParLimits(1,0,1000);
+        fTotal_D->SetParLimits(2,1.,20.);
+        fTotal_D->SetParLimits(3,1e-6,1);
+
+        // Fit of the histogram
+        TFitResultPtr r = hTotal_Deaths->Fit(fTotal_D.get(),FitOption,"",XMin,XMax);
+        fChi2D = r->Chi2()/r->Ndf();
+
+        // the fit results and the function are not printed and drawn in headless mode
+        if(!fHeadless) {
+            r->Print("V");
+            fTotal_D->DrawCopy("same");
+
+            /*Create a histogram to hold the confidence intervals*/
+            auto *herrorD2 = PadOwned((TH1*)hTotal_Deaths->Clone());
+            herrorD2->Reset();
+            herrorD2->SetName(((TString)hTotal_Deaths->GetName()).Append("_errorD"));
+            (TVirtualFitter::GetFitter())->GetConfidenceIntervals(herrorD2);
+
+            //Now the "hint" histogram has the fitted function values as the
+            //bin contents and the confidence intervals as bin errors
+            herrorD2->SetStats(kFALSE);
+            herrorD2->SetFillColor(fTotal_D->GetLineColor());
+            herrorD2->SetFillStyle(3002);
+            herrorD2->SetFillColorAlpha(fTotal_D->GetLineColor(),0.5);
+            herrorD2->SetMarkerSize(0);
+            herrorD2->Draw("e3 same");
+        }
+    }
+
+    // D2Model
+    if(fDoD2){
+        if(fDoFullModel) {
+            fTotal_D2.reset(new TF1(Form("D2_%s",hTotal_Deaths->GetName()),FuncD2Full,hTotal_Deaths->GetXaxis()->GetXmin(),hTotal_Deaths->GetXaxis()->GetXmax(),8,1,TF1::EAddToList::kNo));
+        }
+        else {
+            fTotal_D2.reset(new TF1(Form("D2_%s",hTotal_Deaths->GetName()),FuncD2,hTotal_Deaths->GetXaxis()->GetXmin(),hTotal_Deaths->GetXaxis()->GetXmax(),6,1,TF1::EAddToList::kNo));
+        }
+        fTotal_D2->SetLineColor(fColors[1]);
+        fTotal_D2->SetNpx(1000);
+
+        const int NPars = fTotal_D2->GetNpar();
+        vector<Double_t> Pars(NPars);
+
+        if(fUseOffset) {
+            fTotal_D2->SetParameter(0,hTotal_Deaths->GetBinContent(hDummyHist->GetBinLowEdge(XMin)));
+            fTotal_D2->SetParLimits(0,0,hTotal_Deaths->GetBinContent(hDummyHist->GetBinLowEdge(XMax)));
+        }
+        else
+            fTotal_D2->FixParameter(0,0);
+
+        if(fDoFullModel) {
+            Pars[1] = 50;
+            Pars[2] = 4.;
+            Pars[3] = 1e-3;
+
+            Pars[4] = 50;
+            Pars[5] = 10.;
+            Pars[6] = 1e-3;
+
+            Pars[7] = XMin;//hTotal_Deaths->GetXaxis()->GetBinLowEdge(hTotal_Deaths->FindFirstBinAbove(1));
+
+            fTotal_D2->SetParameter(1,Pars[1]);
+            fTotal_D2->SetParameter(2,Pars[2]);
+            fTotal_D2->SetParameter(3,Pars[3]);
+            fTotal_D2->SetParameter(4,Pars[4]);
+            fTotal_D2->SetParameter(5,Pars[5]);
+            fTotal_D2->SetParameter(6,Pars[6]);
+            fTotal_D2->FixParameter(7,Pars[7]);
+
+            fTotal_D2->SetParLimits(1,1,1000);
+            fTotal_D2->SetParLimits(2,1.,50.);
+            fTotal_D2->SetParLimits(3,1e-6,1);
+            fTotal_D2->SetParLimits(4,0,1000);
+            fTotal_D2->SetParLimits(5,1.,50.);
+            fTotal_D2->SetParLimits(6,1e-6,1);
+        }
+        else {
+            Pars[1] = 50;
+            Pars[2] = 4.;
+            Pars[3] = 1e-3;
+            Pars[4] = 7;
+            Pars[5] = XMin;//hTotal_Deaths->GetXaxis()->GetBinLowEdge(hTotal_Deaths->FindFirstBinAbove(1));
+
+            fTotal_D2->SetParameter(1,Pars[1]);
+            fTotal_D2->SetParameter(2,Pars[2]);
+            fTotal_D2->SetParameter(3,Pars[3]);
+            fTotal_D2->SetParameter(4,Pars[4]);
+            fTotal_D2->FixParameter(5,Pars[5]);
+
+            fTotal_D2->SetParLimits(1,0,1000);
+            fTotal_D2->SetParLimits(2,1.,50.);
+            fTotal_D2->SetParLimits(3,1e-6,1);
+            fTotal_D2->SetParLimits(4,3,50);
+        }
+
+        TFitResultPtr r = hTotal_Deaths->Fit(fTotal_D2.get(),FitOption,"",XMin,XMax);
+        fChi2D2 = r->Chi2()/r->Ndf();
+
+        // the fit results and the function are not printed and drawn in headless mode
+        if(!fHeadless) {
+            r->Print("V");
+            fTotal_D2->DrawCopy("same");
+
+            /*Create a histogram to hold the confidence intervals*/
+            auto *herrorD2 = PadOwned((TH1*)hTotal_Deaths->Clone());
+            herrorD2->Reset();
+            herrorD2->SetName(((TString)hTotal_Deaths->GetName()).Append("_errorD2"));
+            (TVirtualFitter::GetFitter())->GetConfidenceIntervals(herrorD2);
+
+            //Now the "hint" histogram has the fitted function values as the
+            //bin contents and the confidence intervals as bin errors
+            herrorD2->SetStats(kFALSE);
+            herrorD2->SetFillColor(fTotal_D2->GetLineColor());
+            herrorD2->SetFillStyle(3002);
+            herrorD2->SetFillColorAlpha(fTotal_D2->GetLineColor(),0.5);
+            herrorD2->SetMarkerSize(0);
+            herrorD2->Draw("e3 same");
+
+            if(fDoFullModel) {
+                TF1 *f1 = PadOwned(new TF1(Form("D2_%s_1",hTotal_Deaths->GetName()),FuncD,hTotal_Deaths->GetXaxis()->GetXmin(),hTotal_Deaths->GetXaxis()->GetXmax(),5,1,TF1::EAddToList::kNo));
+                f1->SetParameters(fTotal_D2->GetParameter(0),fTotal_D2->GetParameter(1),fTotal_D2->GetParameter(2),fTotal_D2->GetParameter(3),fTotal_D2->GetParameter(7));
+                f1->SetLineColor(fTotal_D2->GetLineColor());
+                f1->SetLineStyle(kDashed);
+                f1->Draw("same");
+                TF1 *f2 = PadOwned(new TF1(Form("D2_%s_2",hTotal_Deaths->GetName()),FuncD,hTotal_Deaths->GetXaxis()->GetXmin(),hTotal_Deaths->GetXaxis()->GetXmax(),5,1,TF1::EAddToList::kNo));
+                f2->SetParameters(fTotal_D2->GetParameter(0),fTotal_D2->GetParameter(4),fTotal_D2->GetParameter(5),fTotal_D2->GetParameter(6),fTotal_D2->GetParameter(7));
+                f2->SetLineColor(fTotal_D2->GetLineColor());
+                f2->SetLineStyle(kDashed);
+                f2->Draw("same");
+            }
+            else {
+                TF1 *f1 = PadOwned(new TF1(Form("D2_%s_1",hTotal_Deaths->GetName()),FuncD,hTotal_Deaths->GetXaxis()->GetXmin(),hTotal_Deaths->GetXaxis()->GetXmax(),5,1,TF1::EAddToList::kNo));
+                f1->SetParameters(fTotal_D2->GetParameter(0),fTotal_D2->GetParameter(1),fTotal_D2->GetParameter(2),fTotal_D2->GetParameter(3),fTotal_D2->GetParameter(5));
+                f1->SetLineColor(fTotal_D2->GetLineColor());
+                f1->SetLineStyle(kDashed);
+                f1->Draw("same");
+                TF1 *f2 = PadOwned(new TF1(Form("D2_%s_2",hTotal_Deaths->GetName()),FuncD,hTotal_Deaths->GetXaxis()->GetXmin(),hTotal_Deaths->GetXaxis()->GetXmax(),5,1,TF1::EAddToList::kNo));
+                f2->SetParameters(fTotal_D2->GetParameter(0),fTotal_D2->GetParameter(1),fTotal_D2->GetParameter(4),fTotal_D2->GetParameter(3),fTotal_D2->GetParameter(5));
+                f2->SetLineColor(fTotal_D2->GetLineColor());
+                f2->SetLineStyle(kDashed);
+                f2->Draw("same");
+            }
+        }
+    }
+
+    // in headless mode, only the fits are performed
+    if(fHeadless) return;
+
+    Double_t MaxY = hTotal_Deaths->GetMaximum() * 1.2;
+    hTotal_Deaths->GetYaxis()->SetRangeUser(0,MaxY);
+    hTotal_Deaths->GetXaxis()->SetRange(DateMin,DateMax);
+
+    // Here, we remove some of the labels, in order to not have more than 40 labels on the graph
+
+    Int_t NBinsInRange = DateMax-DateMin;
+    Int_t Step = NBinsInRange/40;
+    for(int i=1 ; i<=hTotal_Deaths->GetNbinsX() ; i+=Step) {
+        for(int ii=1 ; ii<Step ; ii++) {
+            if((i+ii) <= hTotal_Deaths->GetNbinsX()) {
+                hTotal_Deaths->GetXaxis()->SetBinLabel(i+ii,"");
+            }
+        }
+    }
+
+    // We update the plot and we print all the fit parameters and Chi2 values
+    MyCanvas->cd();
+    MyCanvas->Modified();
+    MyCanvas->Update();
+
+    Float_t XVal = gPad->GetFrame()->GetX1()*1.02;
+    Float_t YVal = gPad->GetFrame()->GetY2()*0.96;
+
+    TLatex *text = PadOwned(new TLatex(XVal,YVal,Form("%s: %s",theCountry.Data(),LastDate.Data())));
+    text->SetTextColor(kBlack);text->Draw();
+    text->SetTextSize(0.05);
+    text->SetTextFont(132);
+    text->Draw();
+
+    YVal = gPad->GetFrame()->GetY1() + (gPad->GetFrame()->GetY2()-gPad->GetFrame()->GetY1()) * 0.9;
+    XVal = gPad->GetFrame()->GetX1() + (gPad->GetFrame()->GetX2()-gPad->GetFrame()->GetX1()) * 0.01;
+    Int_t NDY=0;
+
+    Int_t NFuncs = (fDoD+fDoD2);
+    Float_t DY = gPad->GetFrame()->GetY2()*0.05;
+    Float_t TextSize = 0.04;
+
+    if(NFuncs>2) {
+        TextSize = 0.02;
+        DY = gPad->GetFrame()->GetY2()*0.03;
+    }
+    else {
+        TextSize = 0.03;
+        DY = gPad->GetFrame()->GetY2()*0.04;
+    }
+
+    // Print D
+    if(fDoD) {
+        TLatex *text = PadOwned(new TLatex(XVal,YVal-DY*NDY,"D model"));
+        text->SetTextColor(fTotal_D->GetLineColor());text->Draw();
+        text->SetTextFont(132);
+        text->SetTextSize(TextSize+0.01);
+        NDY++;
+
+        if(fUseOffset) {
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("Off = %.2f #pm %.2f",fTotal_D->GetParameter(0),fTotal_D->GetParError(0))));
+            text->SetTextColor(fTotal_D->GetLineColor());text->Draw();
+            text->SetTextFont(132);
+            text->SetTextSize(TextSize);
+            NDY++;
+        }
+        text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("a = %.2f #pm %.2f",fTotal_D->GetParameter(1),fTotal_D->GetParError(1))));
+        text->SetTextColor(fTotal_D->GetLineColor());text->Draw();
+        text->SetTextFont(132);
+        text->SetTextSize(TextSize);
+        NDY++;
+        text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b = %.2f #pm %.2f",fTotal_D->GetParameter(2),fTotal_D->GetParError(2))));
+        text->SetTextColor(fTotal_D->GetLineColor());text->Draw();
+        text->SetTextSize(TextSize);
+        text->SetTextFont(132);
+        NDY++;
+        text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("c = %.2e #pm %.2e",fTotal_D->GetParameter(3),fTotal_D->GetParError(3))));
+        text->SetTextColor(fTotal_D->GetLineColor());text->Draw();
+        text->SetTextSize(TextSize);
+        text->SetTextFont(132);
+        NDY++;
+
+        text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("Chi2/ndf = %.2f",fChi2D)));
+        text->SetTextColor(fTotal_D->GetLineColor());text->Draw();
+        text->SetTextSize(TextSize);
+        text->SetTextFont(132);
+        NDY++;
+        NDY++;
+    }
+
+    // Print D2
+    if(fDoD2) {
+        if(fDoFullModel) {
+
+            TLatex *text = PadOwned(new TLatex(XVal,YVal-DY*NDY,"D2 full model"));
+            text->SetTextColor(fTotal_D2->GetLineColor());text->Draw();
+            text->SetTextFont(132);
+            text->SetTextSize(TextSize+0.01);
+            NDY++;
+
+            if(fUseOffset) {
+                text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("Off = %.2f #pm %.2f",fTotal_D2->GetParameter(0),fTotal_D2->GetParError(0))));
+                text->SetTextColor(fTotal_D2->GetLineColor());text->Draw();
+                text->SetTextFont(132);
+                text->SetTextSize(TextSize);
+                NDY++;
+            }
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("a1 = %.2f #pm %.2f",fTotal_D2->GetParameter(1),fTotal_D2->GetParError(1))));
+            text->SetTextColor(fTotal_D2->GetLineColor());text->Draw();
+            text->SetTextFont(132);
+            text->SetTextSize(TextSize);
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b1 = %.2f #pm %.2f",fTotal_D2->GetParameter(2),fTotal_D2->GetParError(2))));
+            text->SetTextColor(fTotal_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("c1 = %.2e #pm %.2e",fTotal_D2->GetParameter(3),fTotal_D2->GetParError(3))));
+            text->SetTextColor(fTotal_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("a2 = %.2f #pm %.2f",fTotal_D2->GetParameter(4),fTotal_D2->GetParError(4))));
+            text->SetTextColor(fTotal_D2->GetLineColor());text->Draw();
+            text->SetTextFont(132);
+            text->SetTextSize(TextSize);
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b2 = %.2f #pm %.2f",fTotal_D2->GetParameter(5),fTotal_D2->GetParError(5))));
+            text->SetTextColor(fTotal_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("c2 = %.2e #pm %.2e",fTotal_D2->GetParameter(6),fTotal_D2->GetParError(6))));
+            text->SetTextColor(fTotal_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("Chi2/ndf = %.2f",fChi2D2)));
+            text->SetTextColor(fTotal_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+            NDY++;
+        }
+        else {
+            TLatex *text = PadOwned(new TLatex(XVal,YVal-DY*NDY,"D2 model"));
+            text->SetTextColor(fTotal_D2->GetLineColor());text->Draw();
+            text->SetTextFont(132);
+            text->SetTextSize(TextSize+0.01);
+            NDY++;
+
+            if(fUseOffset) {
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("Off = %.2f #pm %.2f",fTotal_D2->GetParameter(0),fTotal_D2->GetParError(0))));
+            text->SetTextColor(fTotal_D2->GetLineColor());text->Draw();
+            text->SetTextFont(132);
+            text->SetTextSize(TextSize);
+            NDY++;
+            }
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("a = %.2f #pm %.2f",fTotal_D2->GetParameter(1),fTotal_D2->GetParError(1))));
+            text->SetTextColor(fTotal_D2->GetLineColor());text->Draw();
+            text->SetTextFont(132);
+            text->SetTextSize(TextSize);
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b1 = %.2f #pm %.2f",fTotal_D2->GetParameter(2),fTotal_D2->GetParError(3))));
+            text->SetTextColor(fTotal_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("b2 = %.2f #pm %.2f",fTotal_D2->GetParameter(4),fTotal_D2->GetParError(4))));
+            text->SetTextColor(fTotal_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("c = %.2e #pm %.2e",fTotal_D2->GetParameter(3),fTotal_D2->GetParError(3))));
+            text->SetTextColor(fTotal_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+            text = PadOwned(new TLatex(XVal,YVal-DY*NDY,Form("Chi2/ndf = %.2f",fChi2D2)));
+            text->SetTextColor(fTotal_D2->GetLineColor());text->Draw();
+            text->SetTextSize(TextSize);
+            text->SetTextFont(132);
+            NDY++;
+            NDY++;
+        }
+    }
+
+    gSystem->mkdir("Pictures");
+    TString OutputFileName = Form("Pictures/covid19_Total_deaths_%s",theCountry.Data());
+    if(fNSmoothing>1) OutputFileName.Append(Form("_%dDaysSmooth",fNSmoothing));
+    OutputFileName.Append(Form("_%s.png",vDates.at(vTotal_Deaths.size()-1).Data()));
+    gPad->GetCanvas()->SaveAs(OutputFileName);
+}
+
+void InitHistograms() {
+
+    delete hTotal_Deaths;
+    delete hDummyHist;
+
+    // the total deaths histogram has one bin per day, labeled with the dates, for the years 2020 and 2021
+    hTotal_Deaths = BuildDateHistogram("hTotal_Deaths");
+    hTotal_Deaths->GetYaxis()->SetTitle("DEATHS / DAY");
+    hDummyHist = BuildDateHistogram("dummy_hist");
+
+    // These points is used force the function to start and ends at 0.
+    hTotal_Deaths->SetBinContent(1,0.001);
+    hTotal_Deaths->SetBinContent(hTotal_Deaths->GetNbinsX(),0.001);
+}
+
+void SetModels(Bool_t DoD, Bool_t DoD2, Bool_t FullModel, Bool_t UseOffset) {
+    fDoFullModel = FullModel;
+    fDoD = DoD;
+    fDoD2 = DoD2;
+    fUseOffset = UseOffset;
+
+    INFO_MESS << "Models parameters: ";
+    if(fDoD) cout << " D': On ";
+    if(fDoD2) cout << " D2': On ";
+    if(fDoFullModel) cout << " ==> Full parameters mode activated";
+    if(fUseOffset) cout << " ==> With offset";
+    cout << ENDL;
+}
+
+void PrintParameters(TString country_name) {
+
+    INFO_MESS << "Analyse data from: " << country_name << ENDL << ENDL;
+
+    INFO_MESS << "Models parameters: ";
+    if(fDoD) cout << " D': On ";
+    if(fDoD2) cout << " D2': On ";
+    if(fDoFullModel) cout << " ==> Full parameters mode activated";
+    cout << ENDL;
+
+    PrintRanges();
+
+    if(fHeadless) return;
+
+    INFO_MESS << "Press a key to continue"<< ENDL;
+    cin.get();
+}
+
+bool ReadData(TString filename)
+{
+    // The vectors containing data are cleared from previous use
+    vTotal_Deaths_error.clear();
+
+    return ReadData(filename,vDates,vTotal_Deaths);
+}
+
+Double_t FuncD(Double_t*xx,Double_t*pp) {
+
+    Double_t offset  = pp[0];
+
+    Double_t a1  = pp[1];
+    Double_t b1  = pp[2];
+    Double_t c1  = pp[3];
+
+    Double_t t0 = pp[4];
+    Double_t x   = xx[0] - t0;
+
+    Double_t D1 = a1*TMath::Exp(x/b1)/(1+c1*TMath::Exp(x/b1));
+
+    Double_t Total = offset+D1;
+
+    return Total;
+}
+
+Double_t FuncD2(Double_t*xx,Double_t*pp) {
+
+    Double_t offset  = pp[0];
+
+    Double_t a1  = pp[1];
+    Double_t b1  = pp[2];
+    Double_t c1  = pp[3];
+    Double_t b2  = pp[4];
+
+    Double_t t0 = pp[5];
+    Double_t x   = xx[0] - t0;
+
+    Double_t D1 = a1*TMath::Exp(x/b1)/(1+c1*TMath::Exp(x/b1));
+    Double_t D2 = a1*TMath::Exp(x/b2)/(1+c1*TMath::Exp(x/b2));
+
+    Double_t Total = offset+D1+D2;
+
+    return Total;
+}
+
+Double_t FuncD2Full(Double_t*xx,Double_t*pp) {
+
+    Double_t offset  = pp[0];
+
+    Double_t a1  = pp[1];
+    Double_t b1  = pp[2];
+    Double_t c1  = pp[3];
+
+    Double_t a2  = pp[4];
+    Double_t b2  = pp[5];
+    Double_t c2  = pp[6];
+
+    Double_t t0 = pp[7];
+    Double_t x   = xx[0] - t0;
+
+    Double_t D1 = a1*TMath::Exp(x/b1)/(1+c1*TMath::Exp(x/b1));
+    Double_t D2 = a2*TMath::Exp(x/b2)/(1+c2*TMath::Exp(x/b2));
+
+    Double_t Total = offset+D1+D2;
+
+    return Total;
+}
@@ -0,0 +1,9 @@
+#ifdef __CLING__
+
+#pragma link off all globals;
+#pragma link off all classes;
+#pragma link off all functions;
+
+#pragma link C++ defined_in "covid19_total.h";
+
+#endif
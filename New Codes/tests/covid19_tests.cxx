@@ -0,0 +1,806 @@
+#include "covid19_daily.h"
+
+#include "TError.h"
+
+///****************************************************************************************************************
+///                                  Unit tests of the analyses
+///****************************************************************************************************************
+/// covid19_tests [NAME ...]
+///             => runs the tests given by name (all of them without argument), exit code 1 if a check fails
+///             => each test is registered in ctest under its name (see CMakeLists.txt): ctest --test-dir build
+///             => the data fixtures are read from tests/data (COVID19_TESTS_DATA, set by CMake)
+///****************************************************************************************************************
+
+#ifndef COVID19_TESTS_DATA
+#define COVID19_TESTS_DATA "tests/data/"
+#endif
+
+// number of failed checks of the running test
+Int_t fNFailures = 0;
+
+// to check a condition, and the agreement of a value with its expectation within an absolute tolerance
+#define CHECK(condition) Check((condition),#condition,__LINE__)
+#define CHECK_CLOSE(value,expected,tolerance) CheckClose((value),(expected),(tolerance),#value,__LINE__)
+
+void Check(Bool_t Ok, const char *Text, Int_t Line)
+{
+    if(Ok) return;
+    ERR_MESS << "line " << Line << ": " << Text << " is false" << ENDL;
+    fNFailures++;
+}
+
+void CheckClose(Double_t Value, Double_t Expected, Double_t Tolerance, const char *Text, Int_t Line)
+{
+    if(fabs(Value-Expected) <= Tolerance) return;
+    ERR_MESS << "line " << Line << ": " << Text << Form(" = %.10g, expected %.10g +/- %.3g",Value,Expected,Tolerance) << ENDL;
+    fNFailures++;
+}
+
+// calendar: each bin of 2020 and 2021 gives back its date, and the dates out of the two years are rejected
+void TestDates()
+{
+    CHECK(GetDateBin("1-Jan-20") == 1);
+    CHECK(GetDateBin("29-Feb-20") == 60);
+    CHECK(GetDateBin("31-Dec-20") == 366);
+    CHECK(GetDateBin("1-Mar-21") == 426);
+    CHECK(GetDateBin("31-Dec-21") == 731);
+    CHECK(GetDateBin("29-Feb-21") == -1);
+    CHECK(GetDateBin("1-Jan-22") == -1);
+    CHECK(GetDateBin("31-Dec-19") == -1);
+    CHECK(GetDateBin("1-Foo-20") == -1);
+    CHECK(GetDateBin("") == -1);
+
+    for(int bin=1 ; bin<=731 ; bin++) {
+        TString Date = GetBinDate(bin);
+        if(GetDateBin(Date) != bin) {
+            CHECK(GetDateBin(Date) == bin);
+            break;
+        }
+    }
+    CHECK(GetBinDate(0) == "");
+    CHECK(GetBinDate(732) == "");
+    CHECK_CLOSE(BinToX(1),0.5,0.);
+}
+
+// parsing of the lines of the worldometers files, separated by commas or semicolons
+void TestParseDataLine()
+{
+    Int_t Year = 20, Deaths = -1, Cases = -1;
+    TString Date;
+    CHECK(ParseDataLine("11,Dec 31$ 2020,980,55",Year,Date,Deaths,Cases));
+    CHECK(Date == "31-Dec-20");
+    CHECK(Deaths == 55);
+    CHECK(Cases == 980);
+    CHECK(Year == 21);
+
+    CHECK(ParseDataLine("12;Jan 01$ 2021;1120;66",Year,Date,Deaths));
+    CHECK(Date == "1-Jan-21");
+    CHECK(Deaths == 66);
+    CHECK(Year == 21);
+
+    // an empty field is read as 0
+    CHECK(ParseDataLine("13,Jan 02$ 2021,1270,",Year,Date,Deaths,Cases));
+    CHECK(Deaths == 0);
+    CHECK(Cases == 1270);
+
+    CHECK(!ParseDataLine("no separator",Year,Date,Deaths));
+}
+
+// reading of a data file: the days without death are skipped, the cases kept, and the year changes after the 31-Dec
+void TestReadData()
+{
+    TString FileName = COVID19_TESTS_DATA "Fixture.csv";
+    vector<TString> Dates, CaseDates;
+    vector<Double_t> Deaths, Cases;
+    Long64_t BytesRead = 0;
+    CHECK(ReadData(FileName,"","",Dates,Deaths,CaseDates,Cases,&BytesRead));
+
+    CHECK(Dates.size() == 14);
+    CHECK(CaseDates.size() == 16);
+    if(Dates.size() != 14 || CaseDates.size() != 16) return;
+    CHECK(Dates.front() == "22-Dec-20");
+    CHECK(Dates.back() == "4-Jan-21");
+    CHECK(CaseDates.front() == "20-Dec-20");
+    for(size_t i=0 ; i<Dates.size() ; i++) {
+        // one more death each day: total = n(n+1)/2
+        CHECK_CLOSE(Deaths.at(i),(i+1)*(i+2)/2.,0.);
+        CHECK(GetDateBin(Dates.at(i)) == GetDateBin("22-Dec-20")+(Int_t)i);
+    }
+    CHECK_CLOSE(Cases.back(),1600.,0.);
+
+    Long_t Id, Size, Flags, ModTime;
+    gSystem->GetPathInfo(FileName,&Id,&Size,&Flags,&ModTime);
+    CHECK(BytesRead == Size);
+
+    // range of dates
+    CHECK(ReadData(FileName,"25-Dec-20","2-Jan-21",Dates,Deaths));
+    CHECK(Dates.size() == 9);
+    if(Dates.size() == 9) {
+        CHECK(Dates.front() == "25-Dec-20");
+        CHECK(Dates.back() == "2-Jan-21");
+        CHECK_CLOSE(Deaths.front(),10.,0.);
+    }
+
+    // the range is compared on the bins: other spellings of the dates, and a start before the first line of the file
+    CHECK(ReadData(FileName,"01-Dec-20","02-Jan-21",Dates,Deaths,CaseDates,Cases));
+    CHECK(Dates.size() == 12);
+    CHECK(CaseDates.size() == 14);
+    if(Dates.size() == 12 && CaseDates.size() == 14) {
+        CHECK(Dates.front() == "22-Dec-20");
+        CHECK(Dates.back() == "2-Jan-21");
+        CHECK(CaseDates.front() == "20-Dec-20");
+    }
+
+    // same result as the range applied on the data in memory
+    vector<TString> AllDates;
+    vector<Double_t> AllDeaths;
+    ReadData(FileName,"","",AllDates,AllDeaths);
+    TrimDataRange(AllDates,AllDeaths,"01-Dec-20","02-Jan-21");
+    CHECK(AllDates == Dates);
+    CHECK(AllDeaths == Deaths);
+
+    CHECK(!ReadData(COVID19_TESTS_DATA "Missing.csv","","",Dates,Deaths));
+}
+
+// incremental parsing of a data file: the appended complete lines only, a partial last line held back until it is complete,
+// the year carried from one call to the next, and a full parse after a revision or a truncation, always giving the same
+// data as ReadData
+void TestDataFile()
+{
+    vector<string> Lines;
+    ifstream fixture(COVID19_TESTS_DATA "Fixture.csv");
+    for(string line ; getline(fixture,line) ; ) Lines.push_back(line+"\n");
+    CHECK(Lines.size() == 17);
+    if(Lines.size() != 17) return;
+
+    TString FileName = Form("%s/covid19_tests_data_file_%d.csv",gSystem->TempDirectory(),gSystem->GetPid());
+    auto Write = [&](const string &text, Bool_t Append) {
+        ofstream file(FileName.Data(),ios::binary | ((Append) ? ios::app : ios::trunc));
+        file << text;
+    };
+    auto Join = [&](size_t First, size_t Last) {
+        string text;
+        for(size_t i=First ; i<Last ; i++) text += Lines.at(i);
+        return text;
+    };
+    auto SameAsReadData = [&](const DataFile &data) {
+        vector<TString> Dates, CaseDates;
+        vector<Double_t> Deaths, Cases;
+        ReadData(FileName,"","",Dates,Deaths,CaseDates,Cases);
+        return Dates == data.Dates && Deaths == data.Total_Deaths && CaseDates == data.Case_Dates && Cases == data.Total_Cases;
+    };
+
+    // header and the days up to 30-Dec-20
+    DataFile data;
+    data.FileName = FileName;
+    string Text = Join(0,12);
+    Write(Text,false);
+    Long64_t BytesParsed = 0;
+    CHECK(UpdateDataFile(data,&BytesParsed) == kDataRead);
+    CHECK(data.Offset == (Long64_t)Text.size() && BytesParsed == data.Offset);
+    CHECK(data.Year == 20 && data.Dates.size() == 9);
+    CHECK(SameAsReadData(data));
+    CHECK(UpdateDataFile(data,&BytesParsed) == kDataUnchanged);
+    CHECK(data.Offset == (Long64_t)Text.size() && BytesParsed == data.Offset);
+
+    // 31-Dec-20 and 1-Jan-21, and the beginning of the next line: the year changes between the two calls
+    string Appended = Join(12,14);
+    Write(Appended+Lines.at(14).substr(0,8),true);
+    BytesParsed = 0;
+    CHECK(UpdateDataFile(data,&BytesParsed) == kDataAppended);
+    CHECK(BytesParsed == (Long64_t)Appended.size());
+    CHECK(data.Offset == (Long64_t)(Text.size()+Appended.size()));
+    CHECK(data.Year == 21 && data.Dates.size() == 11);
+    if(data.Dates.size() == 11) CHECK(data.Dates.back() == "1-Jan-21");
+    CHECK(UpdateDataFile(data) == kDataUnchanged);
+    CHECK(data.Dates.size() == 11);
+
+    // the end of the partial line and the last days: the file is now the fixture
+    Write(Lines.at(14).substr(8)+Join(15,17),true);
+    CHECK(UpdateDataFile(data) == kDataAppended);
+    Text = Join(0,17);
+    CHECK(data.Offset == (Long64_t)Text.size());
+    CHECK(data.Dates.size() == 14);
+    if(data.Dates.size() == 14) CHECK(data.Dates.back() == "4-Jan-21");
+    CHECK(SameAsReadData(data));
+
+    // revision of an earlier day, same size of the file: the checksum of the parsed lines changes
+    string Revised = Lines.at(6);
+    Revised.replace(Revised.rfind(",10"),3,",11");
+    Write(Join(0,6)+Revised+Join(7,17),false);
+    CHECK(UpdateDataFile(data) == kDataRead);
+    CHECK(data.Offset == (Long64_t)Text.size());
+    CHECK(data.Dates.size() == 14);
+    if(data.Dates.size() == 14) CHECK(data.Dates.at(3) == "25-Dec-20" && data.Total_Deaths.at(3) == 11.);
+    CHECK(SameAsReadData(data));
+
+    // truncated file
+    Text = Join(0,10);
+    Write(Text,false);
+    CHECK(UpdateDataFile(data) == kDataRead);
+    CHECK(data.Offset == (Long64_t)Text.size() && data.Year == 20);
+    CHECK(SameAsReadData(data));
+
+    gSystem->Unlink(FileName);
+    CHECK(UpdateDataFile(data) == kDataNotFound);
+}
+
+// wide data file (dd-mm-yyyy dates, trailing commas): the missing 29-Mar-20 filled by a linear interpolation of the totals,
+// an empty cell keeping the value of the previous day, and the columns read as the files of the countries
+void TestWideData()
+{
+    TString FileName = COVID19_TESTS_DATA "Wide.csv";
+    WideData data;
+    Long64_t BytesRead = 0;
+    CHECK(ReadWideData(FileName,data,&BytesRead));
+    Long_t Id, Size, Flags, ModTime;
+    gSystem->GetPathInfo(FileName,&Id,&Size,&Flags,&ModTime);
+    CHECK(BytesRead == Size);
+
+    CHECK(data.Columns == vector<TString>({"EC","FS","GP","total"}));
+    CHECK(data.Dates.size() == 7 && data.Bins.size() == 7 && data.Filled.size() == 7);
+    if(data.Columns.size() != 4 || data.Dates.size() != 7 || data.Bins.size() != 7 || data.Filled.size() != 7) return;
+    for(size_t iday=0 ; iday<7 ; iday++) {
+        CHECK(data.Bins.at(iday) == GetDateBin("25-Mar-20")+(Int_t)iday);
+        CHECK(GetDateBin(data.Dates.at(iday)) == data.Bins.at(iday));
+        CHECK(data.Filled.at(iday) == (iday == 4));
+        CHECK(data.Values.at(3).at(iday) == data.Values.at(0).at(iday)+data.Values.at(1).at(iday)+data.Values.at(2).at(iday));
+    }
+    CHECK(data.Dates.at(4) == "29-Mar-20");
+
+    // halfway between the 28th and the 30th, and the empty GP cell of the 27th
+    const Double_t Filled[4] = {6.,2.,5.,13.};
+    for(int icol=0 ; icol<4 ; icol++) CHECK_CLOSE(data.Values.at(icol).at(4),Filled[icol],1e-12);
+    CHECK_CLOSE(data.Values.at(2).at(2),2.,0.);
+    CHECK_CLOSE(data.Values.at(3).back(),20.,0.);
+
+    // the days without deaths are not used, as in the country files
+    vector<TString> Dates;
+    vector<Double_t> Deaths;
+    CHECK(GetWideColumn(data,"FS",Dates,Deaths));
+    CHECK(Dates.size() == 5);
+    if(Dates.size() == 5) CHECK(Dates.front() == "27-Mar-20" && Deaths.at(2) == 2.);
+    CHECK(!GetWideColumn(data,"KZN",Dates,Deaths));
+
+    // same column read as a source "File:Column"
+    CHECK(GetWideColumn(data,"total",Dates,Deaths));
+    vector<TString> SourceDates;
+    vector<Double_t> SourceDeaths;
+    CHECK(ReadData(FileName+":total","","",SourceDates,SourceDeaths));
+    CHECK(SourceDates == Dates && SourceDeaths == Deaths);
+    CHECK(Dates.size() == 6);
+}
+
+// smoothing from the prefix sums: same values as the original loop on the N last days, and centred window
+void TestSmoothing()
+{
+    vector<Double_t> Data;
+    for(int i=0 ; i<60 ; i++) Data.push_back((i%11 == 5) ? 0. : ((i%17 == 3) ? -4. : 20.+10.*sin(0.3*i)+i));
+
+    for(Int_t N : {1,3,7,14}) {
+        // original implementation: average of the positive values of the N last days, 0 for the first N days
+        vector<Double_t> Expected(Data.size(),0.), Expected_err(Data.size(),0.);
+        for(size_t i=N ; i<Data.size() ; i++) {
+            Double_t Tot = 0., NPoints = 0.;
+            for(int ii=0 ; ii<N ; ii++) {
+                if(Data.at(i-ii)>0) {
+                    Tot += Data.at(i-ii);
+                    NPoints++;
+                }
+            }
+            if(NPoints>0 && Tot>0.) {
+                Expected.at(i) = Tot/NPoints;
+                Expected_err.at(i) = sqrt(2*Tot)/NPoints;
+            }
+        }
+
+        vector<Double_t> Smooth = Data, Smooth_err;
+        SmoothVector(N,Smooth,Smooth_err);
+        CHECK(Smooth.size() == Data.size() && Smooth_err.size() == Data.size());
+        for(size_t i=0 ; i<Data.size() && i<Smooth.size() && i<Smooth_err.size() ; i++) {
+            CHECK_CLOSE(Smooth.at(i),Expected.at(i),1e-9);
+            CHECK_CLOSE(Smooth_err.at(i),Expected_err.at(i),1e-9);
+        }
+
+        // centred window, cut at the edges
+        vector<Double_t> Sum, NPoints, Centred, Centred_err;
+        BuildPrefixSums(Data,Sum,NPoints);
+        SmoothFromPrefixSums(N,Sum,NPoints,Centred,Centred_err,true);
+        for(int i=0 ; i<(Int_t)Data.size() ; i++) {
+            Double_t Tot = 0., N_i = 0.;
+            for(int j=max(0,i-(N-1)/2) ; j<=min((Int_t)Data.size()-1,i+N/2) ; j++) {
+                if(Data.at(j)>0) {
+                    Tot += Data.at(j);
+                    N_i++;
+                }
+            }
+            CHECK_CLOSE(Centred.at(i),(N_i>0) ? Tot/N_i : 0.,1e-9);
+        }
+    }
+}
+
+// gaussian daily deaths (amplitude, mean, width), to test the joint fits on an analytic model
+Double_t TestGaussian(Double_t *xx, Double_t *pp)
+{
+    return pp[0]*exp(-0.5*pow((xx[0]-pp[1])/pp[2],2));
+}
+
+// joint chi2 of two series with a common width, laid out as in FitJoint: the common width first, then the amplitude and the
+// mean of each series, and their own width with pooling
+void BuildTestJointChi2(JointChi2 &chi2, Double_t Pooling)
+{
+    chi2.Pooling = Pooling;
+    chi2.Affected.push_back({});
+    for(int iseries=0 ; iseries<2 ; iseries++) {
+        chi2.Funcs.push_back(make_shared<TF1>(Form("gaussian_%d",iseries),TestGaussian,0.,100.,3,1,TF1::EAddToList::kNo));
+        chi2.X.emplace_back();
+        chi2.Y.emplace_back();
+        chi2.E.emplace_back();
+        for(int bin=1 ; bin<=60 ; bin++) {
+            Double_t Value = 100.*(1+iseries)*exp(-0.5*pow((BinToX(bin)-30.-5.*iseries)/8.,2)) + 3.*sin(bin);
+            chi2.X.back().push_back(BinToX(bin));
+            chi2.Y.back().push_back(Value);
+            chi2.E.back().push_back(sqrt(fabs(Value))+1.);
+        }
+
+        vector<Int_t> index;
+        for(int ipar=0 ; ipar<3 ; ipar++) {
+            if(ipar == 2 && Pooling <= 0.) {
+                index.push_back(0);
+                chi2.Affected.at(0).push_back(iseries);
+                continue;
+            }
+            if(ipar == 2) chi2.Pooled.push_back({(Int_t)chi2.Affected.size(),0});
+            index.push_back(chi2.Affected.size());
+            chi2.Affected.push_back({iseries});
+        }
+        chi2.Index.push_back(index);
+    }
+    chi2.NPars = chi2.Affected.size();
+    chi2.Fixed.assign(chi2.NPars,false);
+}
+
+// joint chi2: the derivative of each parameter, computed on the series depending on it only, is the finite difference of
+// the full chi2, with a shared parameter and with a pooled one
+void TestJointChi2()
+{
+    for(Double_t Pooling : {0.,0.2}) {
+        JointChi2 chi2;
+        BuildTestJointChi2(chi2,Pooling);
+        CHECK(chi2.NPars == ((Pooling>0.) ? 7u : 5u));
+        CHECK(chi2.Pooled.size() == ((Pooling>0.) ? 2u : 0u));
+
+        vector<Double_t> x = (Pooling>0.) ? vector<Double_t>{8.,90.,28.,7.,210.,36.,9.} : vector<Double_t>{7.5,90.,28.,210.,36.};
+        for(UInt_t ipar=0 ; ipar<chi2.NPars ; ipar++) {
+            vector<Double_t> Shifted = x;
+            Double_t Step = 1e-5*fabs(x.at(ipar));
+            Shifted.at(ipar) = x.at(ipar)+Step;
+            Double_t Up = chi2(Shifted.data());
+            Shifted.at(ipar) = x.at(ipar)-Step;
+            Double_t Down = chi2(Shifted.data());
+            Double_t Expected = (Up-Down)/(2*Step);
+            CHECK_CLOSE(chi2.Derivative(x.data(),ipar),Expected,1e-4*max(1.,fabs(Expected)));
+        }
+
+        // the fixed parameters have no derivative
+        chi2.Fixed.at(1) = true;
+        CHECK_CLOSE(chi2.Derivative(x.data(),1),0.,0.);
+    }
+}
+
+// lag between the cases and the deaths: two waves of cases, and deaths imposed as 2% of the cases 18 days later
+void TestEstimateLag()
+{
+    const Int_t ImposedLag = 18;
+    const Double_t ImposedRatio = 0.02;
+    Series cases, deaths;
+    for(int bin=40 ; bin<=500 ; bin++) {
+        Double_t Cases = 5000.*exp(-0.5*pow((bin-120)/20.,2)) + 12000.*exp(-0.5*pow((bin-330)/35.,2));
+        cases.Bins.push_back(bin);
+        cases.Daily_Deaths.push_back(Cases);
+        deaths.Bins.push_back(bin+ImposedLag);
+        deaths.Daily_Deaths.push_back(ImposedRatio*Cases);
+    }
+
+    LagEstimate lag;
+    CHECK(EstimateLag(cases,deaths,lag));
+    CHECK(lag.Valid);
+    CHECK(lag.Lag == ImposedLag);
+    CHECK_CLOSE(lag.Ratio,ImposedRatio,1e-6);
+    CHECK(lag.Correlation > 0.9);
+
+    // the deaths before the cases give a negative lag, and a lag beyond MaxLag is not found
+    CHECK(EstimateLag(deaths,cases,lag));
+    CHECK(lag.Lag == -ImposedLag);
+    CHECK_CLOSE(lag.Ratio,1./ImposedRatio,1e-3);
+    EstimateLag(cases,deaths,lag,10);
+    CHECK(lag.Lag <= 10);
+}
+
+// effective reproduction number: an incidence growing at a constant rate r with a known generation interval w has
+// R = 1/sum_k w[k]*exp(-r*k) (renewal equation), with daily weights and with the default gamma interval
+void TestRt()
+{
+    vector<Double_t> SavedGeneration = fRtGeneration;
+    Int_t SavedWindow = fRtWindow;
+    fRtWindow = 7;
+
+    for(auto Weights : {vector<Double_t>{0.2,0.5,0.3},vector<Double_t>{}}) {
+        fRtGeneration = Weights;
+        vector<Double_t> Generation = GetGenerationInterval();
+        CHECK_CLOSE(Generation.front(),0.,0.);
+
+        for(Double_t Rate : {0.05,0.,-0.03}) {
+            vector<Double_t> Incidence;
+            // large enough for the gamma prior to be negligible at the end of the decreasing incidence
+            for(int t=0 ; t<120 ; t++) Incidence.push_back(1e5*exp(Rate*t));
+            Double_t Sum = 0.;
+            for(size_t k=0 ; k<Generation.size() ; k++) Sum += Generation.at(k)*exp(-Rate*k);
+
+            RtEstimate rt;
+            CHECK(EstimateRt(Incidence,1,0,rt));
+            if(!rt.Valid) continue;
+            // the last estimate, far from the start of the incidence where the infection pressure is truncated
+            CHECK(rt.Bins.back() == 120);
+            CHECK_CLOSE(rt.Mean.back(),1./Sum,1e-3/Sum);
+            CHECK(rt.Low.back() < rt.Mean.back() && rt.Mean.back() < rt.High.back());
+            CHECK(rt.Low.back() < 1./Sum && 1./Sum < rt.High.back());
+        }
+    }
+
+    fRtGeneration = SavedGeneration;
+    fRtWindow = SavedWindow;
+}
+
+// FFT: inverse of the transform, and same transform as the direct DFT. Convolve: same result as the direct sum
+void TestFFTConvolve()
+{
+    vector<complex<Double_t>> Data(16), Transform;
+    for(size_t i=0 ; i<Data.size() ; i++) Data.at(i) = complex<Double_t>(sin(0.7*i)+0.1*i,cos(1.3*i));
+    Transform = Data;
+    FFT(Transform);
+    for(size_t k=0 ; k<Data.size() ; k++) {
+        complex<Double_t> Expected = 0.;
+        for(size_t i=0 ; i<Data.size() ; i++) Expected += Data.at(i)*polar(1.,-2*TMath::Pi()*i*k/Data.size());
+        CHECK_CLOSE(abs(Transform.at(k)-Expected),0.,1e-9);
+    }
+    FFT(Transform,true);
+    for(size_t i=0 ; i<Data.size() ; i++) CHECK_CLOSE(abs(Transform.at(i)-Data.at(i)),0.,1e-12);
+
+    CHECK(NextPowerOfTwo(1) == 1);
+    CHECK(NextPowerOfTwo(17) == 32);
+    CHECK(NextPowerOfTwo(64) == 64);
+
+    for(size_t Size : {1,5,40}) {
+        vector<Double_t> a, b, result;
+        for(size_t i=0 ; i<100 ; i++) a.push_back(50.+30.*sin(0.2*i));
+        for(size_t i=0 ; i<Size ; i++) b.push_back(1./(1.+i));
+        Convolve(a,b,result);
+        CHECK(result.size() == a.size()+b.size()-1);
+        for(size_t t=0 ; t<result.size() ; t++) {
+            Double_t Expected = 0.;
+            for(size_t k=0 ; k<a.size() ; k++) if(t>=k && t-k<b.size()) Expected += a.at(k)*b.at(t-k);
+            CHECK_CLOSE(result.at(t),Expected,1e-9*max(1.,fabs(Expected)));
+        }
+    }
+}
+
+// deconvolution: a known curve of infections, still growing at the end of the data, is convolved with a gamma delay and
+// recovered by Richardson-Lucy and Tikhonov, except on the last days which are not yet seen in the data
+void TestDeconvolution()
+{
+    vector<Double_t> Kernel = DiscretiseGamma(12.,6.,1);
+    Double_t Sum = 0.;
+    for(auto weight : Kernel) Sum += weight;
+    CHECK_CLOSE(Sum,1.,2e-3);
+
+    const size_t N = 200, K = Kernel.size();
+    vector<Double_t> Curve(N+K-1), Data(N,0.);
+    for(size_t j=0 ; j<Curve.size() ; j++) Curve.at(j) = 100.*exp(-0.5*pow((j-110.)/25.,2)) + 50.*exp(-0.5*pow((j-(Double_t)Curve.size())/20.,2));
+    for(size_t t=0 ; t<N ; t++) for(size_t d=0 ; d<K ; d++) Data.at(t) += Kernel.at(d)/Sum*Curve.at(t+K-1-d);
+
+    Deconvolver deconvolver;
+    InitDeconvolver(deconvolver,Kernel,N);
+    CHECK(deconvolver.Size >= N+2*K-2);
+
+    // the curve is constrained by the data on the days of the data but the last kernel length (the days before the data
+    // being seen by a few data only); the tolerance is 2% of its maximum, the Tikhonov filter ringing over 6% without the
+    // mirrored edges
+    auto CheckRecovered = [&](const vector<Double_t> &result) {
+        CHECK(result.size() == Curve.size());
+        if(result.size() != Curve.size()) return;
+        Double_t MaxError = 0., MaxValue = 0.;
+        for(size_t j=K-1 ; j+K<result.size() ; j++) MaxError = max(MaxError,fabs(result.at(j)-Curve.at(j)));
+        for(auto value : result) MaxValue = max(MaxValue,value);
+        CHECK_CLOSE(MaxError,0.,2.);
+        CHECK(MaxValue < 200.);
+    };
+
+    vector<Double_t> Result;
+    DeconvolveRichardsonLucy(deconvolver,Data,100,Result);
+    CheckRecovered(Result);
+    DeconvolveTikhonov(deconvolver,Data,1e-4,Result);
+    CheckRecovered(Result);
+}
+
+// weekly cycle: a smooth trend times known weekday factors, starting on the 1-Jan-20 (a Wednesday), gives back both
+void TestDecomposeWeekly()
+{
+    CHECK(GetBinWeekday(GetDateBin("1-Jan-20")) == 2);
+    CHECK(GetBinWeekday(GetDateBin("6-Jan-20")) == 0);
+    CHECK(GetBinWeekday(GetDateBin("1-Jan-21")) == 4);
+    CHECK(GetBinWeekday(GetDateBin("31-Dec-21")) == 4);
+
+    // Monday first, mean of 1
+    const Double_t Factors[7] = {0.8,1.1,1.2,1.1,1.0,0.9,0.9};
+    Int_t FirstWeekday = GetBinWeekday(1);
+    vector<Double_t> Trend, Data;
+    for(int i=0 ; i<200 ; i++) {
+        Trend.push_back(100.+0.5*i+20.*sin(2*TMath::Pi()*i/90.));
+        Data.push_back(Trend.back()*Factors[(FirstWeekday+i)%7]);
+    }
+
+    vector<Double_t> factors, trend, adjusted;
+    DecomposeWeekly(Data,FirstWeekday,3,factors,trend,adjusted);
+    CHECK(factors.size() == 7);
+    CHECK(trend.size() == Data.size() && adjusted.size() == Data.size());
+    if(factors.size() != 7 || trend.size() != Data.size() || adjusted.size() != Data.size()) return;
+    for(int day=0 ; day<7 ; day++) CHECK_CLOSE(factors.at(day),Factors[day],5e-3);
+
+    // the centred trend is complete from the 4th day to the 4th last day
+    for(size_t i=3 ; i+3<Data.size() ; i++) {
+        CHECK_CLOSE(trend.at(i),Trend.at(i),5e-3*Trend.at(i));
+        CHECK_CLOSE(adjusted.at(i),Trend.at(i),5e-3*Trend.at(i));
+    }
+}
+
+// redistribution of the anomalies: the total of the daily data is conserved, a deficit larger than the deaths of the window
+// being absorbed by the earlier days, and only a deficit larger than all the previous days being left unabsorbed
+void TestAnomalies()
+{
+    vector<Double_t> Data;
+    for(int i=0 ; i<80 ; i++) Data.push_back(20.+5.*sin(0.4*i));
+    Data.at(60) = 900.;
+    Data.at(70) = -700.;
+
+    vector<Anomaly> anomalies;
+    DetectAnomalies(Data,21,6.,anomalies);
+    CHECK(anomalies.size() == 2);
+    if(anomalies.size() != 2) return;
+    CHECK(anomalies.at(0).Index == 60 && anomalies.at(0).Type == kAnomalySpike);
+    CHECK(anomalies.at(1).Index == 70 && anomalies.at(1).Type == kAnomalyNegative);
+
+    // the deficit of 700 is larger than the deaths of the 7 or 21 previous days (about 20 per day once the spike is
+    // redistributed), the window has to be widened
+    for(Int_t Days : {21,7}) {
+        vector<Double_t> Corrected = Data;
+        vector<Anomaly> corrected = anomalies;
+        CorrectAnomalies(Corrected,corrected,kAnomalyRedistribute,Days);
+        Double_t Total = 0., CorrectedTotal = 0.;
+        for(size_t i=0 ; i<Data.size() ; i++) {
+            Total += Data.at(i);
+            CorrectedTotal += Corrected.at(i);
+            CHECK(Corrected.at(i) >= 0.);
+        }
+        CHECK_CLOSE(CorrectedTotal,Total,1e-9*Total);
+        CHECK_CLOSE(Corrected.at(70),0.,0.);
+        for(auto &anomaly : corrected) {
+            CHECK(anomaly.Mode == kAnomalyRedistribute);
+            CHECK_CLOSE(anomaly.Unabsorbed,0.,0.);
+        }
+    }
+
+    // a deficit larger than all the previous days: everything before it is removed, and the rest recorded as unabsorbed
+    vector<Double_t> Short = {10.,12.,11.,-100.};
+    vector<Anomaly> shortanomalies(1);
+    shortanomalies.at(0).Index = 3;
+    shortanomalies.at(0).Type = kAnomalyNegative;
+    CorrectAnomalies(Short,shortanomalies,kAnomalyRedistribute,2);
+    for(auto value : Short) CHECK_CLOSE(value,0.,1e-12);
+    CHECK_CLOSE(shortanomalies.at(0).Unabsorbed,-67.,1e-9);
+}
+
+// compartmental models: exact gradient against central differences, the fit instance giving the same values as the extended
+// one on its grid and 0 after it, and the final size of an epidemic without reduction, ln(s0/s_inf) = R0*(1-s_inf)
+void TestCompartmental()
+{
+    Double_t SavedTolerance = fODETolerance;
+    fODETolerance = 1e-10;
+
+    for(Int_t Model : {kModelSIR,kModelSEIRD}) {
+        // a, R0, m, tm, i0, t0
+        const Double_t Pars[kNCompartmentalPars] = {1e5,2.5,0.5,40.,1e-4,10.};
+        CompartmentalFunction Fit(Model,200.), Extended(Model,200.,true);
+
+        for(Double_t x : {20.5,60.5,150.5}) {
+            Double_t Value = Fit(&x,Pars);
+            CHECK(Value > 0.);
+            CHECK_CLOSE(Value,Extended(&x,Pars),1e-12*Value);
+
+            Double_t Gradient[kNCompartmentalPars];
+            Fit.ParameterGradient(&x,Pars,Gradient);
+            for(int ipar=0 ; ipar<kNCompartmentalPars ; ipar++) {
+                Double_t Shifted[kNCompartmentalPars];
+                copy(Pars,Pars+kNCompartmentalPars,Shifted);
+                Double_t Step = 1e-4*Pars[ipar];
+                Shifted[ipar] = Pars[ipar]+Step;
+                Double_t Up = Fit(&x,Shifted);
+                Shifted[ipar] = Pars[ipar]-Step;
+                Double_t Down = Fit(&x,Shifted);
+                Double_t Expected = (Up-Down)/(2*Step);
+                // the derivative with respect to t0 is exact, the difference being taken on the interpolation of the grid
+                Double_t Tolerance = ((ipar == 5) ? 1e-2 : 1e-4)*fabs(Expected)+1e-6*Value;
+                CHECK_CLOSE(Gradient[ipar],Expected,Tolerance);
+            }
+        }
+
+        Double_t Dummy = 1000.;
+        CHECK_CLOSE(Fit(&Dummy,Pars),0.,0.);
+        CHECK(Extended(&Dummy,Pars) >= 0.);
+
+        // final size, the deaths a*gamma*i(t) summing to a*(1-s_inf): trapezoids on the half days of the grid
+        const Double_t NoReduction[kNCompartmentalPars] = {1e5,2.,0.,40.,1e-4,0.};
+        Double_t s0 = 1.-((Model == kModelSEIRD) ? 2 : 1)*NoReduction[4], sInf = 0.;
+        for(int iteration=0 ; iteration<200 ; iteration++) sInf = s0*exp(-NoReduction[1]*(1.-sInf));
+        CompartmentalFunction Long(Model,2000.,true);
+        Double_t Total = 0.;
+        for(int k=0 ; k<=4000 ; k++) {
+            Double_t x = 0.5*k;
+            Total += ((k == 0 || k == 4000) ? 0.25 : 0.5)*Long(&x,NoReduction);
+        }
+        CHECK_CLOSE(Total,NoReduction[0]*(1.-sInf),1e-4*NoReduction[0]);
+    }
+
+    fODETolerance = SavedTolerance;
+}
+
+// forecast of a D fit: peak at t0+b*ln(1/c) and final toll from the primitive -a/(c*(1+c*exp((x-t0)/b))) of the curve, the
+// errors scaling with the amplitude alone, and the cache returning the same forecast until its least recent use evicts it
+void TestForecast()
+{
+    // a, b, c, t0: peak 89.8 days after the start of the fit, 50 days after the last data
+    const Double_t t0 = BinToX(10), Amplitude = 100., Width = 10., Shape = exp(-8.03);
+    const Int_t LastBin = 60, NDays = 30, FinalDays = 365;
+    Double_t Pars[4] = {Amplitude,Width,Shape,t0};
+    auto Primitive = [&](Double_t x) { return -Amplitude/(Shape*(1.+Shape*exp((x-t0)/Width))); };
+
+    Series series;
+    series.Country = "Testland";
+    Double_t Total = 0.;
+    for(int bin=1 ; bin<=LastBin ; bin++) {
+        Double_t x = BinToX(bin);
+        Total += FuncD(&x,Pars);
+        series.Bins.push_back(bin);
+        series.Total_Deaths.push_back(Total);
+    }
+
+    // only the amplitude is free, the daily curve being proportional to it
+    const Double_t Sigma = 2.;
+    ModelFit fit;
+    fit.Model = kModelD;
+    fit.XMin = 10;
+    fit.XMax = LastBin;
+    fit.Pars.assign(Pars,Pars+4);
+    fit.Covariance.assign(16,0.);
+    fit.Covariance.at(0) = Sigma*Sigma;
+    fit.Chi2 = 50.;
+    fit.Ndf = 50;
+    Double_t Quantile = TMath::StudentQuantile(0.975,fit.Ndf);
+
+    Forecast forecast;
+    CHECK(ComputeForecast(fit,series,NDays,FinalDays,forecast));
+    CHECK(forecast.LastBin == LastBin);
+    CHECK(forecast.Bins.size() == (size_t)NDays && forecast.Bins.front() == LastBin+1);
+    Double_t Cumulative = Total;
+    for(int iday=0 ; iday<NDays ; iday++) {
+        Double_t x = BinToX(LastBin+1+iday);
+        Double_t Daily = FuncD(&x,Pars);
+        Cumulative += Daily;
+        CHECK_CLOSE(forecast.Daily.at(iday),Daily,1e-12*Daily);
+        CHECK_CLOSE(forecast.Cumulative.at(iday),Cumulative,1e-12*Cumulative);
+        CHECK_CLOSE(forecast.Daily_error.at(iday),Quantile*Sigma*Daily/Amplitude,1e-6*Daily);
+    }
+
+    // the days are the midpoints of the integration of the curve, and the parabola refines the peak between two days
+    Double_t x = t0+Width*log(1./Shape);
+    CHECK_CLOSE(forecast.PeakX,x,0.05);
+    CHECK_CLOSE(forecast.PeakHeight,FuncD(&x,Pars),1e-4*FuncD(&x,Pars));
+    CHECK_CLOSE(forecast.PeakX_error,0.,1e-9);
+    Double_t FinalToll = Total+Primitive(LastBin+FinalDays)-Primitive(LastBin);
+    CHECK_CLOSE(forecast.FinalToll,FinalToll,1e-3*(FinalToll-Total));
+    CHECK_CLOSE(forecast.FinalToll_error,Quantile*Sigma*(forecast.FinalToll-Total)/Amplitude,1e-6*FinalToll);
+
+    // the cache: a second call does not compute the forecast again. The covariance is not part of the key, so that a
+    // forecast asked with a wider covariance keeps its errors if it is cached, and gets wider ones if it is computed
+    ClearForecasts();
+    SetForecastCacheSize(2);
+    Forecast cached;
+    CHECK(GetForecast(fit,series,cached,NDays,FinalDays));
+    CHECK(GetNForecasts() == 1);
+    CHECK(GetForecast(fit,series,cached,NDays,FinalDays));
+    CHECK(GetNForecasts() == 1);
+    CHECK_CLOSE(cached.PeakX,forecast.PeakX,0.);
+    CHECK_CLOSE(cached.FinalToll,forecast.FinalToll,0.);
+    CHECK_CLOSE(cached.FinalToll_error,forecast.FinalToll_error,0.);
+
+    ModelFit Other = fit, Third = fit;
+    Other.Pars.at(0) *= 1.01;
+    Third.Pars.at(0) *= 1.02;
+    auto IsCached = [&](ModelFit probe) {
+        for(auto &value : probe.Covariance) value *= 4.;
+        Forecast result;
+        GetForecast(probe,series,result,NDays,FinalDays);
+        Forecast computed;
+        ComputeForecast(probe,series,NDays,FinalDays,computed);
+        return fabs(result.FinalToll_error-computed.FinalToll_error) > 0.1*computed.FinalToll_error;
+    };
+
+    // the first fit, used again after the other one was added, is kept when the third one evicts the least recently used
+    CHECK(GetForecast(Other,series,cached,NDays,FinalDays));
+    CHECK(GetNForecasts() == 2);
+    CHECK(IsCached(fit));
+    CHECK(GetForecast(Third,series,cached,NDays,FinalDays));
+    CHECK(GetNForecasts() == 2);
+    CHECK(IsCached(fit));
+    CHECK(IsCached(Third));
+    CHECK(!IsCached(Other));
+    CHECK(GetNForecasts() == 2);
+
+    SetForecastCacheSize(1);
+    CHECK(GetNForecasts() == 1);
+    SetForecastCacheSize();
+    ClearForecasts();
+    CHECK(GetNForecasts() == 0);
+}
+
+// structure containing a test and its name, given to ctest
+struct UnitTest {
+    TString Name;
+    function<void()> Body;
+};
+
+vector<UnitTest> fTests = {
+    {"dates",TestDates},
+    {"parse_data_line",TestParseDataLine},
+    {"read_data",TestReadData},
+    {"data_file",TestDataFile},
+    {"wide_data",TestWideData},
+    {"smoothing",TestSmoothing},
+    {"joint_chi2",TestJointChi2},
+    {"estimate_lag",TestEstimateLag},
+    {"rt",TestRt},
+    {"fft_convolve",TestFFTConvolve},
+    {"deconvolution",TestDeconvolution},
+    {"decompose_weekly",TestDecomposeWeekly},
+    {"anomalies",TestAnomalies},
+    {"compartmental",TestCompartmental},
+    {"forecast",TestForecast},
+};
+
+int main(int argc, char **argv)
+{
+    gErrorIgnoreLevel = kWarning;
+
+    vector<TString> Names;
+    for(int iarg=1 ; iarg<argc ; iarg++) Names.push_back(argv[iarg]);
+    for(auto &Name : Names) {
+        if(find_if(fTests.begin(),fTests.end(),[&](const UnitTest &test) { return test.Name == Name; }) == fTests.end()) {
+            ERR_MESS << "Unknown test " << Name << ENDL;
+            return 2;
+        }
+    }
+
+    Int_t NFailed = 0;
+    for(auto &test : fTests) {
+        if(!Names.empty() && find(Names.begin(),Names.end(),test.Name) == Names.end()) continue;
+        fNFailures = 0;
+        test.Body();
+        if(fNFailures) {
+            ERR_MESS << test.Name << ": " << fNFailures << " failed checks" << ENDL;
+            NFailed++;
+        }
+        else INFO_MESS << test.Name << ": passed" << ENDL;
+    }
+
+    return (NFailed) ? 1 : 0;
+}
@@ -0,0 +1,47 @@
+#include "covid19_total.h"
+
+#include "TError.h"
+
+///****************************************************************************************************************
+///                                  Memory check of the total analysis
+///****************************************************************************************************************
+/// covid19_total_memcheck N COUNTRY [DATA_DIR]
+///             => analyses and plots the country N times with the total analysis (batch mode), and fails (exit code 1)
+///                if the resident memory grows by more than 0.25 kB per analysis (ctest: memory_check_total)
+///             => the analysis is not headless, so that the fitted functions and their copies drawn in the canvas are
+///                created and deleted at each analysis, the "Press a key" prompts being answered by /dev/null
+///****************************************************************************************************************
+
+int main(int argc, char **argv)
+{
+    if(argc<3) {
+        cout << "Usage: " << argv[0] << " N COUNTRY [DATA_DIR]" << endl;
+        return 2;
+    }
+
+    gROOT->SetBatch(true);
+    gErrorIgnoreLevel = kWarning;
+
+    Int_t NAnalyses = atoi(argv[1]);
+    TString Country = argv[2];
+    if(argc>3) fDataFolder = argv[3];
+
+    if(freopen("/dev/null","r",stdin) == nullptr) {
+        ERR_MESS << "Cannot read the prompts from /dev/null" << ENDL;
+        return 2;
+    }
+
+    // the first analyses are not taken into account: canvas, histograms and ROOT internal caches are created there
+    const Int_t NWarmUp = 10;
+    for(int i=0 ; i<NWarmUp ; i++) Analyse(Country);
+    if(vTotal_Deaths.empty()) {
+        ERR_MESS << "No data for " << Country << " in " << fDataFolder << ENDL;
+        return 2;
+    }
+
+    Long_t Start = GetResidentMemory();
+    for(int i=0 ; i<NAnalyses ; i++) Analyse(Country);
+    Long_t End = GetResidentMemory();
+
+    return CheckMemoryGrowth(Country,NAnalyses,Start,End) ? 0 : 1;
+}